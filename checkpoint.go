@@ -7,7 +7,9 @@ import (
 	"fmt"
 	"net"
 	"os"
+	"path/filepath"
 	"strconv"
+	"time"
 
 	criu "github.com/checkpoint-restore/go-criu/v4/rpc"
 	"github.com/opencontainers/runc/libcontainer"
@@ -39,6 +41,7 @@ checkpointed.`,
 		cli.StringFlag{Name: "page-server", Value: "", Usage: "ADDRESS:PORT of the page server"},
 		cli.BoolFlag{Name: "file-locks", Usage: "handle file locks, for safety"},
 		cli.BoolFlag{Name: "pre-dump", Usage: "dump container's memory information only, leave the container running after this"},
+		cli.IntFlag{Name: "pre-dump-iterations", Value: 0, Usage: "number of pre-dumps of the container's memory (while it runs) before the dump"},
 		cli.StringFlag{Name: "manage-cgroups-mode", Value: "", Usage: "cgroups mode: 'soft' (default), 'full' and 'strict'"},
 		cli.StringSliceFlag{Name: "empty-ns", Usage: "create a namespace, but don't restore its properties"},
 		cli.BoolFlag{Name: "auto-dedup", Usage: "enable auto deduplication of memory images"},
@@ -74,10 +77,49 @@ checkpointed.`,
 		if err := setEmptyNsMask(context, options); err != nil {
 			return err
 		}
+		if n := context.Int("pre-dump-iterations"); n > 0 {
+			if options.PreDump {
+				return errors.New("--pre-dump-iterations and --pre-dump are mutually exclusive")
+			}
+			if options.PageServer.Address != "" || options.LazyPages {
+				return errors.New("--pre-dump-iterations requires dumping to the image directory (no --page-server or --lazy-pages)")
+			}
+			if err := preDump(container, options, n); err != nil {
+				return err
+			}
+		}
 		return container.Checkpoint(options)
 	},
 }
 
+// sysbox-runc: preDump does n iterations of pre-dump of the container's memory
+// while it keeps running, each into a pre-dump.<i> directory of the image
+// directory and tracking the memory changed since the one before, and then
+// sets options for the dump to be based on the last one. That way, only the
+// memory changed since then is dumped while the container is frozen.
+func preDump(container libcontainer.Container, options *libcontainer.CriuOpts, n int) error {
+	parent := options.ParentImage
+	if parent != "" && !filepath.IsAbs(parent) {
+		// The parent of a pre-dump is relative to its image directory.
+		parent = filepath.Join("..", parent)
+	}
+	for i := 1; i <= n; i++ {
+		dir := fmt.Sprintf("pre-dump.%d", i)
+		opts := *options
+		opts.PreDump = true
+		opts.ImagesDirectory = filepath.Join(options.ImagesDirectory, dir)
+		opts.ParentImage = parent
+		start := time.Now()
+		if err := container.Checkpoint(&opts); err != nil {
+			return fmt.Errorf("pre-dump %d: %w", i, err)
+		}
+		logrus.Debugf("pre-dump %d into %s: %v", i, opts.ImagesDirectory, time.Since(start))
+		parent = filepath.Join("..", dir)
+	}
+	options.ParentImage = fmt.Sprintf("pre-dump.%d", n)
+	return nil
+}
+
 func getCheckpointImagePath(context *cli.Context) string {
 	imagePath := context.String("image-path")
 	if imagePath == "" {
@@ -0,0 +1,269 @@
+//
+// Copyright 2019-2020 Nestybox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+package main
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strings"
+	"sync"
+	"time"
+)
+
+// The operations of a container's lifecycle, in the order they are done. The
+// latency of "kill" includes waiting for the container to stop.
+var ops = []string{"create", "start", "exec", "kill", "delete"}
+
+// recorder collects the latencies of the operations, and of the phases the
+// runtime reports in its debug log.
+type recorder struct {
+	mu     sync.Mutex
+	ops    map[string][]time.Duration
+	errors map[string]int
+	phases map[string][]time.Duration
+}
+
+func newRecorder() *recorder {
+	return &recorder{
+		ops:    make(map[string][]time.Duration),
+		errors: make(map[string]int),
+		phases: make(map[string][]time.Duration),
+	}
+}
+
+func (r *recorder) op(name string, d time.Duration, err error) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if err != nil {
+		r.errors[name]++
+		return
+	}
+	r.ops[name] = append(r.ops[name], d)
+}
+
+func (r *recorder) phase(name string, d time.Duration) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.phases[name] = append(r.phases[name], d)
+}
+
+func (r *recorder) opStats() map[string]*stats {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	res := make(map[string]*stats, len(ops))
+	for _, name := range ops {
+		res[name] = newStats(r.ops[name], r.errors[name])
+	}
+	return res
+}
+
+func (r *recorder) phaseStats() map[string]*stats {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	res := make(map[string]*stats, len(r.phases))
+	for name, ds := range r.phases {
+		res[name] = newStats(ds, 0)
+	}
+	return res
+}
+
+// runtimeCmd returns the command running the runtime with args, logging (at
+// debug level, as JSON) to the log of the operation (i.e., the subcommand, in
+// args[0]) on container id.
+func runtimeCmd(cfg *config, id string, args ...string) *exec.Cmd {
+	global := []string{"--debug", "--log-format", "json", "--log", logPath(cfg, id, args[0])}
+	if cfg.Root != "" {
+		global = append(global, "--root", cfg.Root)
+	}
+	return exec.Command(cfg.Runtime, append(global, args...)...)
+}
+
+// logPath returns the path of the runtime log of operation op on container
+// id. Each operation has its own, so that the phases of (say) the create and
+// exec bootstraps, which have the same names, can be told apart.
+func logPath(cfg *config, id, op string) string {
+	return filepath.Join(cfg.workdir, id+"."+op+".log")
+}
+
+// timed runs cmd, and returns how long it took.
+func timed(cmd *exec.Cmd) (time.Duration, error) {
+	var out bytes.Buffer
+	if cmd.Stdout == nil && cmd.Stderr == nil {
+		cmd.Stdout = &out
+		cmd.Stderr = &out
+	}
+	start := time.Now()
+	err := cmd.Run()
+	d := time.Since(start)
+	if err != nil {
+		return d, fmt.Errorf("%s: %v: %s", strings.Join(cmd.Args, " "), err, bytes.TrimSpace(out.Bytes()))
+	}
+	return d, nil
+}
+
+// lifecycle runs container id through its lifecycle, recording the latency of
+// each operation. On error the container is deleted (forcibly), and the
+// remaining operations are skipped.
+func lifecycle(cfg *config, tmpl *bundleTemplate, rec *recorder, id string) {
+	bundle, err := tmpl.makeBundle(cfg, id)
+	if err != nil {
+		rec.op("create", 0, err)
+		fmt.Fprintf(os.Stderr, "[loadgen] %s: %v\n", id, err)
+		return
+	}
+	defer os.RemoveAll(bundle)
+	defer func() {
+		for _, op := range ops {
+			readLogPhases(logPath(cfg, id, op), op, rec)
+		}
+	}()
+
+	// A detached container inherits the stdio of create, which therefore must
+	// not be pipes (that the container would hold open).
+	var stdio *os.File
+	if stdio, err = os.OpenFile(os.DevNull, os.O_RDWR, 0); err != nil {
+		rec.op("create", 0, err)
+		return
+	}
+	defer stdio.Close()
+
+	step := func(op string, cmd *exec.Cmd) bool {
+		d, err := timed(cmd)
+		rec.op(op, d, err)
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "[loadgen] %s: %s: %v\n", id, op, err)
+			runtimeCmd(cfg, id, "delete", "--force", id).Run()
+		}
+		return err == nil
+	}
+
+	create := runtimeCmd(cfg, id, "create", "--bundle", bundle, id)
+	create.Stdin, create.Stdout, create.Stderr = stdio, stdio, stdio
+	if !step("create", create) {
+		return
+	}
+	if !step("start", runtimeCmd(cfg, id, "start", id)) {
+		return
+	}
+	for i := 0; i < cfg.Execs; i++ {
+		if !step("exec", runtimeCmd(cfg, id, append([]string{"exec", id}, cfg.ExecArgs...)...)) {
+			return
+		}
+	}
+
+	start := time.Now()
+	_, err = timed(runtimeCmd(cfg, id, "kill", id, "KILL"))
+	if err == nil {
+		err = waitStopped(cfg, id)
+	}
+	rec.op("kill", time.Since(start), err)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "[loadgen] %s: kill: %v\n", id, err)
+		runtimeCmd(cfg, id, "delete", "--force", id).Run()
+		return
+	}
+
+	step("delete", runtimeCmd(cfg, id, "delete", id))
+}
+
+// waitStopped waits for container id to stop.
+func waitStopped(cfg *config, id string) error {
+	deadline := time.Now().Add(cfg.StopTimeout)
+	for {
+		out, err := runtimeCmd(cfg, id, "state", id).Output()
+		if err != nil {
+			return err
+		}
+		var state struct {
+			Status string `json:"status"`
+		}
+		if err := json.Unmarshal(out, &state); err != nil {
+			return err
+		}
+		if state.Status == "stopped" {
+			return nil
+		}
+		if time.Now().After(deadline) {
+			return fmt.Errorf("still %s after %v", state.Status, cfg.StopTimeout)
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+}
+
+// The debug log entries of the runtime with the timings of the phases of an
+// operation: the nsexec bootstrap (whose fields are nsexec.<stage>.<phase>, in
+// nanoseconds) and the host-side setup of the init (setup.<step>, as
+// "<duration> (at <offset>)"). They're recorded as <op>.<field>, e.g.,
+// create.nsexec.0.clone_child.
+var phaseEntries = map[string]bool{
+	"nsexec timings":     true,
+	"host setup timings": true,
+}
+
+// readLogPhases records the phase timings in the runtime log of operation op
+// at path.
+func readLogPhases(path, op string, rec *recorder) {
+	f, err := os.Open(path)
+	if err != nil {
+		return
+	}
+	defer f.Close()
+
+	s := bufio.NewScanner(f)
+	s.Buffer(make([]byte, 64*1024), 1024*1024)
+	for s.Scan() {
+		line := s.Bytes()
+		if !bytes.Contains(line, []byte(" timings")) {
+			continue
+		}
+		entry := make(map[string]interface{})
+		if err := json.Unmarshal(line, &entry); err != nil {
+			continue
+		}
+		if msg, _ := entry["msg"].(string); !phaseEntries[msg] {
+			continue
+		}
+		for k, v := range entry {
+			if !strings.HasPrefix(k, "nsexec.") && !strings.HasPrefix(k, "setup.") {
+				continue
+			}
+			if d, ok := parsePhase(v); ok {
+				rec.phase(op+"."+k, d)
+			}
+		}
+	}
+}
+
+func parsePhase(v interface{}) (time.Duration, bool) {
+	switch v := v.(type) {
+	case float64:
+		return time.Duration(v), true
+	case string:
+		fields := strings.Fields(v)
+		if len(fields) == 0 {
+			return 0, false
+		}
+		d, err := time.ParseDuration(fields[0])
+		return d, err == nil
+	}
+	return 0, false
+}
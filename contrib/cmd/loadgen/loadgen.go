@@ -0,0 +1,364 @@
+//
+// Copyright 2019-2020 Nestybox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"io/ioutil"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/urfave/cli"
+)
+
+// version will be populated by the Makefile, read from
+// VERSION file of the source code.
+var version = ""
+
+// gitCommit will be the hash that the binary was built from
+// and will be populated by the Makefile
+var gitCommit = ""
+
+const (
+	usage = `sysbox-runc contrib/cmd/loadgen
+
+loadgen drives the lifecycle of system containers (create, start, exec, kill,
+delete) through the runtime at a given concurrency and rate, and writes a JSON
+report with the latency percentiles of each operation, of each phase of the
+nsexec bootstrap and of the host-side setup (from the runtime's debug log), and
+the CPU utilization and mount lock contention of the node meanwhile.
+
+The containers are created from a bundle whose rootfs they all share (unless
+--copy-rootfs is given) and whose process is replaced by a long-running one:
+
+    # loadgen --bundle /path/to/bundle --containers 200 --concurrency 50 > new.json
+
+Given the report of a previous run, loadgen also lists the operations and
+phases whose latency regressed, and exits with status 2 if any did:
+
+    # loadgen --bundle /path/to/bundle --baseline old.json > new.json
+
+It must run as root, as the runtime does.
+
+loadgen is experimental: its parsing of the bootstrap phases, its sampling of
+the mount lock contention and its stopping of the containers have yet to be
+validated against a real run, so its reports (and its exit status) must not be
+used as a regression gate yet (see README.md).`
+)
+
+func bail(err error) {
+	fmt.Fprintf(os.Stderr, "[loadgen] fatal error: %v\n", err)
+	os.Exit(1)
+}
+
+// config is the configuration of a run.
+type config struct {
+	Runtime     string        `json:"runtime"`
+	Root        string        `json:"root,omitempty"`
+	Bundle      string        `json:"bundle"`
+	Containers  int           `json:"containers"`
+	Concurrency int           `json:"concurrency"`
+	Rate        float64       `json:"rate"`
+	Execs       int           `json:"execs"`
+	Process     []string      `json:"process"`
+	ExecArgs    []string      `json:"exec_args"`
+	CopyRootfs  bool          `json:"copy_rootfs"`
+	StopTimeout time.Duration `json:"stop_timeout"`
+
+	workdir string
+}
+
+// run runs the load, and returns its report.
+func run(cfg *config) (*report, error) {
+	tmpl, err := loadBundle(cfg)
+	if err != nil {
+		return nil, err
+	}
+
+	rec := newRecorder()
+	node := startNodeSampler(time.Second)
+
+	// Containers are started at the given rate (if any), by at most
+	// cfg.Concurrency workers at a time.
+	ids := make(chan string)
+	go func() {
+		defer close(ids)
+		var tick *time.Ticker
+		if cfg.Rate > 0 {
+			tick = time.NewTicker(time.Duration(float64(time.Second) / cfg.Rate))
+			defer tick.Stop()
+		}
+		for i := 0; i < cfg.Containers; i++ {
+			if tick != nil && i > 0 {
+				<-tick.C
+			}
+			ids <- fmt.Sprintf("loadgen-%d-%d", os.Getpid(), i)
+		}
+	}()
+
+	start := time.Now()
+	var wg sync.WaitGroup
+	for w := 0; w < cfg.Concurrency; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for id := range ids {
+				lifecycle(cfg, tmpl, rec, id)
+			}
+		}()
+	}
+	wg.Wait()
+	elapsed := time.Since(start)
+
+	return &report{
+		Config:     cfg,
+		Started:    start,
+		Duration:   elapsed,
+		Throughput: float64(cfg.Containers) / elapsed.Seconds(),
+		Ops:        rec.opStats(),
+		Phases:     rec.phaseStats(),
+		Node:       node.stop(),
+	}, nil
+}
+
+// bundleTemplate is the config of the bundle the containers are created from.
+type bundleTemplate struct {
+	spec   map[string]interface{}
+	rootfs string
+}
+
+func loadBundle(cfg *config) (*bundleTemplate, error) {
+	data, err := ioutil.ReadFile(filepath.Join(cfg.Bundle, "config.json"))
+	if err != nil {
+		return nil, err
+	}
+	spec := make(map[string]interface{})
+	if err := json.Unmarshal(data, &spec); err != nil {
+		return nil, fmt.Errorf("parsing the bundle's config.json: %v", err)
+	}
+	root, ok := spec["root"].(map[string]interface{})
+	if !ok {
+		return nil, fmt.Errorf("the bundle's config.json has no root")
+	}
+	rootfs, _ := root["path"].(string)
+	if !filepath.IsAbs(rootfs) {
+		rootfs = filepath.Join(cfg.Bundle, rootfs)
+	}
+
+	process, ok := spec["process"].(map[string]interface{})
+	if !ok {
+		return nil, fmt.Errorf("the bundle's config.json has no process")
+	}
+	process["args"] = cfg.Process
+	process["terminal"] = false
+
+	return &bundleTemplate{spec: spec, rootfs: rootfs}, nil
+}
+
+// makeBundle creates the bundle of container id in the work dir.
+func (t *bundleTemplate) makeBundle(cfg *config, id string) (string, error) {
+	dir := filepath.Join(cfg.workdir, id)
+	if err := os.Mkdir(dir, 0700); err != nil {
+		return "", err
+	}
+
+	rootfs := t.rootfs
+	if cfg.CopyRootfs {
+		rootfs = filepath.Join(dir, "rootfs")
+		if out, err := exec.Command("cp", "-a", t.rootfs, rootfs).CombinedOutput(); err != nil {
+			return "", fmt.Errorf("copying the rootfs: %v: %s", err, out)
+		}
+	}
+
+	// Only the root of the spec differs between containers.
+	spec := make(map[string]interface{}, len(t.spec))
+	for k, v := range t.spec {
+		spec[k] = v
+	}
+	root := make(map[string]interface{})
+	for k, v := range t.spec["root"].(map[string]interface{}) {
+		root[k] = v
+	}
+	root["path"] = rootfs
+	spec["root"] = root
+
+	data, err := json.Marshal(spec)
+	if err != nil {
+		return "", err
+	}
+	return dir, ioutil.WriteFile(filepath.Join(dir, "config.json"), data, 0600)
+}
+
+func main() {
+	app := cli.NewApp()
+	app.Name = "loadgen"
+	app.Usage = usage
+
+	// Set version to be the same as runC.
+	var v []string
+	if version != "" {
+		v = append(v, version)
+	}
+	if gitCommit != "" {
+		v = append(v, "commit: "+gitCommit)
+	}
+	app.Version = strings.Join(v, "\n")
+
+	// Set the flags.
+	app.Flags = []cli.Flag{
+		cli.StringFlag{
+			Name:  "runtime",
+			Value: "sysbox-runc",
+			Usage: "the runtime to drive",
+		},
+		cli.StringFlag{
+			Name:  "root",
+			Usage: "root directory of the runtime's containers state (default: the runtime's)",
+		},
+		cli.StringFlag{
+			Name:  "bundle, b",
+			Usage: "bundle to create the containers from",
+		},
+		cli.IntFlag{
+			Name:  "containers, n",
+			Value: 100,
+			Usage: "number of containers to run through their lifecycle",
+		},
+		cli.IntFlag{
+			Name:  "concurrency, c",
+			Value: 10,
+			Usage: "number of containers in their lifecycle at the same time",
+		},
+		cli.Float64Flag{
+			Name:  "rate",
+			Usage: "containers to create per second (0 for as fast as the concurrency allows)",
+		},
+		cli.IntFlag{
+			Name:  "execs",
+			Value: 1,
+			Usage: "number of processes to exec in each container",
+		},
+		cli.StringFlag{
+			Name:  "process",
+			Value: "sleep 86400",
+			Usage: "the process of the containers (must not exit by itself)",
+		},
+		cli.StringFlag{
+			Name:  "exec",
+			Value: "true",
+			Usage: "the process to exec in the containers",
+		},
+		cli.BoolFlag{
+			Name:  "copy-rootfs",
+			Usage: "give each container its own copy of the bundle's rootfs",
+		},
+		cli.DurationFlag{
+			Name:  "stop-timeout",
+			Value: 30 * time.Second,
+			Usage: "how long to wait for a killed container to stop",
+		},
+		cli.StringFlag{
+			Name:  "workdir",
+			Usage: "directory for the containers' bundles and logs (default: a temporary one, removed at exit)",
+		},
+		cli.StringFlag{
+			Name:  "baseline",
+			Usage: "report of a previous run to compare against",
+		},
+		cli.Float64Flag{
+			Name:  "threshold",
+			Value: 10,
+			Usage: "how much slower (in percent) than the baseline a latency must be to be a regression",
+		},
+		cli.DurationFlag{
+			Name:  "min-delta",
+			Value: 100 * time.Microsecond,
+			Usage: "how much slower than the baseline a latency must be to be a regression",
+		},
+	}
+
+	app.Action = func(ctx *cli.Context) error {
+		if os.Geteuid() != 0 {
+			return fmt.Errorf("loadgen must be run as root")
+		}
+		cfg := &config{
+			Runtime:     ctx.String("runtime"),
+			Root:        ctx.String("root"),
+			Bundle:      ctx.String("bundle"),
+			Containers:  ctx.Int("containers"),
+			Concurrency: ctx.Int("concurrency"),
+			Rate:        ctx.Float64("rate"),
+			Execs:       ctx.Int("execs"),
+			Process:     strings.Fields(ctx.String("process")),
+			ExecArgs:    strings.Fields(ctx.String("exec")),
+			CopyRootfs:  ctx.Bool("copy-rootfs"),
+			StopTimeout: ctx.Duration("stop-timeout"),
+			workdir:     ctx.String("workdir"),
+		}
+		if cfg.Bundle == "" {
+			return fmt.Errorf("a bundle must be given")
+		}
+		if cfg.Containers < 1 || cfg.Concurrency < 1 || len(cfg.Process) == 0 || len(cfg.ExecArgs) == 0 {
+			return fmt.Errorf("invalid load: --containers, --concurrency, --process and --exec must not be empty")
+		}
+		if cfg.workdir == "" {
+			dir, err := ioutil.TempDir("", "loadgen")
+			if err != nil {
+				return err
+			}
+			defer os.RemoveAll(dir)
+			cfg.workdir = dir
+		}
+
+		var base *report
+		if path := ctx.String("baseline"); path != "" {
+			var err error
+			if base, err = loadReport(path); err != nil {
+				return fmt.Errorf("reading the baseline: %v", err)
+			}
+		}
+
+		r, err := run(cfg)
+		if err != nil {
+			return err
+		}
+		if base != nil {
+			r.Regressions = compare(base, r, ctx.Float64("threshold"), ctx.Duration("min-delta"))
+		}
+
+		enc := json.NewEncoder(os.Stdout)
+		enc.SetIndent("", "  ")
+		if err := enc.Encode(r); err != nil {
+			return err
+		}
+		if len(r.Regressions) > 0 {
+			for _, reg := range r.Regressions {
+				fmt.Fprintf(os.Stderr, "[loadgen] regression: %s\n", reg)
+			}
+			return cli.NewExitError(fmt.Sprintf("[loadgen] %d regressions against the baseline", len(r.Regressions)), 2)
+		}
+		return nil
+	}
+	if err := app.Run(os.Args); err != nil {
+		bail(err)
+	}
+}
@@ -0,0 +1,206 @@
+//
+// Copyright 2019-2020 Nestybox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+package main
+
+import (
+	"bufio"
+	"os"
+	"runtime"
+	"strconv"
+	"strings"
+	"time"
+)
+
+// nodeStats are the CPU utilization and mount lock contention of the node
+// during a run.
+type nodeStats struct {
+	CPUs int `json:"cpus"`
+	// Utilization of all the CPUs (0 to 1), over the whole run and at its
+	// busiest sampling interval.
+	CPUMean float64 `json:"cpu_mean"`
+	CPUMax  float64 `json:"cpu_max"`
+	// Contention on the locks serializing mounts (namespace_sem and
+	// mount_lock), from /proc/lock_stat. Only available on kernels built with
+	// CONFIG_LOCK_STAT, and with /proc/sys/kernel/lock_stat set.
+	MountLocks map[string]*lockStat `json:"mount_locks,omitempty"`
+}
+
+// lockStat is the contention on a lock (or rather, lock class).
+type lockStat struct {
+	Contentions uint64        `json:"contentions"`
+	WaitTime    time.Duration `json:"wait_ns"`
+}
+
+// mountLocks are the lock classes behind mount(2) and friends.
+var mountLocks = []string{"namespace_sem", "mount_lock"}
+
+type nodeSampler struct {
+	done  chan struct{}
+	stats chan *nodeStats
+}
+
+// startNodeSampler starts sampling the CPU utilization of the node every
+// interval, until stop() is called.
+func startNodeSampler(interval time.Duration) *nodeSampler {
+	ns := &nodeSampler{
+		done:  make(chan struct{}),
+		stats: make(chan *nodeStats, 1),
+	}
+	locks := readLockStat()
+	go func() {
+		st := &nodeStats{CPUs: runtime.NumCPU()}
+		first, _ := readCPUTimes()
+		prev := first
+
+		tick := time.NewTicker(interval)
+		defer tick.Stop()
+		for {
+			select {
+			case <-tick.C:
+				cur, err := readCPUTimes()
+				if err != nil {
+					continue
+				}
+				if u := cur.utilization(prev); u > st.CPUMax {
+					st.CPUMax = u
+				}
+				prev = cur
+			case <-ns.done:
+				if cur, err := readCPUTimes(); err == nil {
+					st.CPUMean = cur.utilization(first)
+					if u := cur.utilization(prev); u > st.CPUMax {
+						st.CPUMax = u
+					}
+				}
+				st.MountLocks = lockStatDelta(locks, readLockStat())
+				ns.stats <- st
+				return
+			}
+		}
+	}()
+	return ns
+}
+
+func (ns *nodeSampler) stop() *nodeStats {
+	close(ns.done)
+	return <-ns.stats
+}
+
+// cpuTimes are the busy and total times of all the CPUs, in clock ticks.
+type cpuTimes struct {
+	busy, total uint64
+}
+
+func readCPUTimes() (cpuTimes, error) {
+	f, err := os.Open("/proc/stat")
+	if err != nil {
+		return cpuTimes{}, err
+	}
+	defer f.Close()
+	s := bufio.NewScanner(f)
+	for s.Scan() {
+		// cpu  user nice system idle iowait irq softirq steal guest guest_nice
+		fields := strings.Fields(s.Text())
+		if len(fields) < 5 || fields[0] != "cpu" {
+			continue
+		}
+		var t cpuTimes
+		// guest and guest_nice are already part of user and nice.
+		for i, field := range fields[1:] {
+			if i >= 8 {
+				break
+			}
+			v, _ := strconv.ParseUint(field, 10, 64)
+			t.total += v
+			if i != 3 && i != 4 {
+				t.busy += v
+			}
+		}
+		return t, nil
+	}
+	return cpuTimes{}, s.Err()
+}
+
+func (t cpuTimes) utilization(since cpuTimes) float64 {
+	if t.total <= since.total {
+		return 0
+	}
+	return float64(t.busy-since.busy) / float64(t.total-since.total)
+}
+
+// readLockStat returns the contention on the mount locks so far, or nil if
+// /proc/lock_stat is not available.
+func readLockStat() map[string]*lockStat {
+	f, err := os.Open("/proc/lock_stat")
+	if err != nil {
+		return nil
+	}
+	defer f.Close()
+
+	res := make(map[string]*lockStat)
+	s := bufio.NewScanner(f)
+	for s.Scan() {
+		// <class name>: con-bounces contentions waittime-min waittime-max
+		// waittime-total ... (times in microseconds), once per class, followed
+		// by the call sites of the contentions (which we skip).
+		line := s.Text()
+		i := strings.LastIndex(line, ":")
+		if i < 0 {
+			continue
+		}
+		fields := strings.Fields(line[i+1:])
+		if len(fields) < 5 {
+			continue
+		}
+		name := strings.TrimSpace(line[:i])
+		var lock string
+		for _, l := range mountLocks {
+			if strings.Contains(name, l) {
+				lock = l
+			}
+		}
+		if lock == "" {
+			continue
+		}
+		contentions, err1 := strconv.ParseUint(fields[1], 10, 64)
+		wait, err2 := strconv.ParseFloat(fields[4], 64)
+		if err1 != nil || err2 != nil {
+			continue
+		}
+		st, ok := res[lock]
+		if !ok {
+			st = &lockStat{}
+			res[lock] = st
+		}
+		st.Contentions += contentions
+		st.WaitTime += time.Duration(wait * float64(time.Microsecond))
+	}
+	return res
+}
+
+func lockStatDelta(before, after map[string]*lockStat) map[string]*lockStat {
+	if before == nil || after == nil {
+		return nil
+	}
+	for lock, st := range after {
+		if b, ok := before[lock]; ok {
+			st.Contentions -= b.Contentions
+			st.WaitTime -= b.WaitTime
+		}
+	}
+	return after
+}
@@ -0,0 +1,138 @@
+//
+// Copyright 2019-2020 Nestybox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"io/ioutil"
+	"sort"
+	"time"
+)
+
+// report is the result of a run. All the durations are in nanoseconds.
+type report struct {
+	Config      *config           `json:"config"`
+	Started     time.Time         `json:"started"`
+	Duration    time.Duration     `json:"duration_ns"`
+	Throughput  float64           `json:"containers_per_sec"`
+	Ops         map[string]*stats `json:"ops"`
+	Phases      map[string]*stats `json:"phases"`
+	Node        *nodeStats        `json:"node"`
+	Regressions []regression      `json:"regressions,omitempty"`
+}
+
+// stats are the latency percentiles of an operation or phase.
+type stats struct {
+	Count  int           `json:"count"`
+	Errors int           `json:"errors,omitempty"`
+	Mean   time.Duration `json:"mean_ns"`
+	P50    time.Duration `json:"p50_ns"`
+	P95    time.Duration `json:"p95_ns"`
+	P99    time.Duration `json:"p99_ns"`
+	Max    time.Duration `json:"max_ns"`
+}
+
+func newStats(ds []time.Duration, errors int) *stats {
+	s := &stats{Count: len(ds), Errors: errors}
+	if len(ds) == 0 {
+		return s
+	}
+	sorted := append([]time.Duration(nil), ds...)
+	sort.Slice(sorted, func(i, j int) bool { return sorted[i] < sorted[j] })
+
+	var total time.Duration
+	for _, d := range sorted {
+		total += d
+	}
+	s.Mean = total / time.Duration(len(sorted))
+	s.P50 = percentile(sorted, 50)
+	s.P95 = percentile(sorted, 95)
+	s.P99 = percentile(sorted, 99)
+	s.Max = sorted[len(sorted)-1]
+	return s
+}
+
+// percentile returns the p-th percentile (nearest rank) of the sorted ds.
+func percentile(sorted []time.Duration, p int) time.Duration {
+	rank := (p*len(sorted) + 99) / 100
+	if rank < 1 {
+		rank = 1
+	}
+	return sorted[rank-1]
+}
+
+// regression is a latency percentile that got worse than in the baseline.
+type regression struct {
+	Name       string        `json:"name"`
+	Percentile string        `json:"percentile"`
+	Baseline   time.Duration `json:"baseline_ns"`
+	Current    time.Duration `json:"current_ns"`
+}
+
+func (r regression) String() string {
+	return fmt.Sprintf("%s %s: %v -> %v (%+.1f%%)", r.Name, r.Percentile, r.Baseline, r.Current,
+		100*float64(r.Current-r.Baseline)/float64(r.Baseline))
+}
+
+func loadReport(path string) (*report, error) {
+	data, err := ioutil.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+	r := &report{}
+	if err := json.Unmarshal(data, r); err != nil {
+		return nil, err
+	}
+	return r, nil
+}
+
+// compare returns the p50, p95 and p99 latencies of the operations and phases
+// of cur that are over threshold percent (and minDelta) slower than in base.
+func compare(base, cur *report, threshold float64, minDelta time.Duration) []regression {
+	var regs []regression
+	check := func(kind string, base, cur map[string]*stats) {
+		names := make([]string, 0, len(cur))
+		for name := range cur {
+			names = append(names, name)
+		}
+		sort.Strings(names)
+		for _, name := range names {
+			b, ok := base[name]
+			c := cur[name]
+			if !ok || b.Count == 0 || c.Count == 0 {
+				continue
+			}
+			for _, p := range []struct {
+				name      string
+				base, cur time.Duration
+			}{
+				{"p50", b.P50, c.P50},
+				{"p95", b.P95, c.P95},
+				{"p99", b.P99, c.P99},
+			} {
+				delta := p.cur - p.base
+				if delta > minDelta && float64(delta) > float64(p.base)*threshold/100 {
+					regs = append(regs, regression{kind + "." + name, p.name, p.base, p.cur})
+				}
+			}
+		}
+	}
+	check("op", base.Ops, cur.Ops)
+	check("phase", base.Phases, cur.Phases)
+	return regs
+}
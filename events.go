@@ -3,6 +3,7 @@
 package main
 
 import (
+	"bytes"
 	"encoding/json"
 	"errors"
 	"fmt"
@@ -26,10 +27,17 @@ var eventsCommand = cli.Command{
 
 Where "<container-id>" is the name for the instance of the container.`,
 	Description: `The events command displays information about the container. By default the
-information is displayed once every 5 seconds.`,
+information is displayed once every 5 seconds.
+
+With --notify (cgroup v2 only), the stats are also collected each time the
+container is frozen or thawed or hits its memory or pids limits, and they are
+only displayed when they change: the first stats event holds all of the
+stats, and each one after it only the sections (cpu, memory, pids, ...) that
+changed since the previous one.`,
 	Flags: []cli.Flag{
 		cli.DurationFlag{Name: "interval", Value: 5 * time.Second, Usage: "set the stats collection interval"},
 		cli.BoolFlag{Name: "stats", Usage: "display the container's stats then exit"},
+		cli.BoolFlag{Name: "notify", Usage: "collect the stats on cgroup v2 notifications too, and only display their changes"},
 	},
 	Action: func(context *cli.Context) error {
 		if err := checkArgs(context, 1, exactArgs); err != nil {
@@ -51,7 +59,8 @@ information is displayed once every 5 seconds.`,
 			return fmt.Errorf("container with id %s is not running", container.ID())
 		}
 		var (
-			stats  = make(chan *libcontainer.Stats, 1)
+			stats  <-chan *libcontainer.Stats
+			delta  *statsDelta
 			events = make(chan *types.Event, 1024)
 			group  = &sync.WaitGroup{}
 		)
@@ -75,16 +84,27 @@ information is displayed once every 5 seconds.`,
 			group.Wait()
 			return nil
 		}
-		go func() {
-			for range time.Tick(context.Duration("interval")) {
-				s, err := container.Stats()
-				if err != nil {
-					logrus.Error(err)
-					continue
-				}
-				stats <- s
+		if context.Bool("notify") {
+			// sysbox-runc: sample the stats on cgroup notifications, through
+			// cgroup files kept open, and send their changes only.
+			if stats, err = container.NotifyStats(duration); err != nil {
+				return err
 			}
-		}()
+			delta = &statsDelta{}
+		} else {
+			ch := make(chan *libcontainer.Stats, 1)
+			go func() {
+				for range time.Tick(duration) {
+					s, err := container.Stats()
+					if err != nil {
+						logrus.Error(err)
+						continue
+					}
+					ch <- s
+				}
+			}()
+			stats = ch
+		}
 		n, err := container.NotifyOOM()
 		if err != nil {
 			return err
@@ -100,8 +120,17 @@ information is displayed once every 5 seconds.`,
 				} else {
 					n = nil
 				}
-			case s := <-stats:
-				events <- &types.Event{Type: "stats", ID: container.ID(), Data: convertLibcontainerStats(s)}
+			case s, ok := <-stats:
+				if !ok {
+					// The container's cgroup has no more processes.
+					stats = nil
+					break
+				}
+				if delta == nil {
+					events <- &types.Event{Type: "stats", ID: container.ID(), Data: convertLibcontainerStats(s)}
+				} else if changed := delta.update(convertLibcontainerStats(s)); changed != nil {
+					events <- &types.Event{Type: "stats", ID: container.ID(), Data: changed}
+				}
 			}
 			if n == nil {
 				close(events)
@@ -113,6 +142,38 @@ information is displayed once every 5 seconds.`,
 	},
 }
 
+// sysbox-runc: statsDelta holds the stats last displayed by "events --notify",
+// by section (the top level JSON fields of types.Stats).
+type statsDelta struct {
+	last map[string]json.RawMessage
+}
+
+// update returns the sections of s that changed since the previous call, or
+// nil if none did.
+func (d *statsDelta) update(s *types.Stats) map[string]json.RawMessage {
+	data, err := json.Marshal(s)
+	if err != nil {
+		logrus.Error(err)
+		return nil
+	}
+	var sections map[string]json.RawMessage
+	if err := json.Unmarshal(data, &sections); err != nil {
+		logrus.Error(err)
+		return nil
+	}
+	changed := make(map[string]json.RawMessage)
+	for k, v := range sections {
+		if prev, ok := d.last[k]; !ok || !bytes.Equal(prev, v) {
+			changed[k] = v
+		}
+	}
+	d.last = sections
+	if len(changed) == 0 {
+		return nil
+	}
+	return changed
+}
+
 func convertLibcontainerStats(ls *libcontainer.Stats) *types.Stats {
 	cg := ls.CgroupStats
 	if cg == nil {
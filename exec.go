@@ -16,12 +16,14 @@ import (
 
 	"github.com/opencontainers/runtime-spec/specs-go"
 	"github.com/urfave/cli"
+	"golang.org/x/sys/unix"
 )
 
 var execCommand = cli.Command{
 	Name:  "exec",
 	Usage: "execute new process inside the system container",
 	ArgsUsage: `<container-id> <command> [command options]  || -p process.json <container-id>
+    || --batch processes.json <container-id>
 
 Where "<container-id>" is the name for the instance of the container and
 "<command>" is the command to be executed in the container.
@@ -31,7 +33,12 @@ EXAMPLE:
 For example, if the container is configured to run the linux ps command the
 following will output a list of processes running in the container:
 
-       # sysbox-runc exec <container-id> ps`,
+       # sysbox-runc exec <container-id> ps
+
+With "--batch", the processes in the given JSON array of process specs are all
+started at once (they share the stdout and stderr of sysbox-runc, and their
+stdin is /dev/null). The exit status is that of the first process that fails,
+or 0 if they all succeed.`,
 	Flags: []cli.Flag{
 		cli.StringFlag{
 			Name:  "console-socket",
@@ -61,6 +68,10 @@ following will output a list of processes running in the container:
 			Name:  "process, p",
 			Usage: "path to the process.json",
 		},
+		cli.StringFlag{
+			Name:  "batch",
+			Usage: "path to a JSON array of processes to start at once",
+		},
 		cli.BoolFlag{
 			Name:  "detach,d",
 			Usage: "detach from the container's process",
@@ -126,7 +137,7 @@ func execProcess(context *cli.Context) (int, error) {
 		return -1, fmt.Errorf("cannot exec a container that has stopped")
 	}
 	path := context.String("process")
-	if path == "" && len(context.Args()) == 1 {
+	if path == "" && context.String("batch") == "" && len(context.Args()) == 1 {
 		return -1, fmt.Errorf("process args cannot be empty")
 	}
 	detach := context.Bool("detach")
@@ -135,17 +146,21 @@ func execProcess(context *cli.Context) (int, error) {
 		return -1, err
 	}
 
+	logLevel := "info"
+	if context.GlobalBool("debug") {
+		logLevel = "debug"
+	}
+
+	if context.String("batch") != "" {
+		return execBatch(context, container, &state.SysMgr, logLevel)
+	}
+
 	bundle := utils.SearchLabels(state.Config.Labels, "bundle")
 	p, err := getProcess(context, bundle, &state.SysMgr)
 	if err != nil {
 		return -1, err
 	}
 
-	logLevel := "info"
-	if context.GlobalBool("debug") {
-		logLevel = "debug"
-	}
-
 	r := &runner{
 		enableSubreaper: false,
 		shouldDestroy:   false,
@@ -161,6 +176,76 @@ func execProcess(context *cli.Context) (int, error) {
 	return r.run(p)
 }
 
+// sysbox-runc: execBatch starts the processes of a batch exec (see
+// Container.StartBatch()) and waits for them, unless detaching.
+func execBatch(context *cli.Context, container libcontainer.Container, sysMgr *sysbox.Mgr, logLevel string) (int, error) {
+	if context.String("process") != "" || len(context.Args()) > 1 {
+		return -1, fmt.Errorf("--batch can't be used along with a process")
+	}
+	if context.IsSet("tty") || context.String("console-socket") != "" || context.Int("preserve-fds") > 0 {
+		return -1, fmt.Errorf("--batch can't be used with a tty, console socket or preserved fds")
+	}
+
+	f, err := os.Open(context.String("batch"))
+	if err != nil {
+		return -1, err
+	}
+	defer f.Close()
+	var procSpecs []specs.Process
+	if err := json.NewDecoder(f).Decode(&procSpecs); err != nil {
+		return -1, err
+	}
+
+	processes := []*libcontainer.Process{}
+	for i := range procSpecs {
+		p := &procSpecs[i]
+		if err := validateProcessSpec(p); err != nil {
+			return -1, fmt.Errorf("batch process %d: %v", i, err)
+		}
+		if p.Terminal {
+			return -1, fmt.Errorf("batch process %d: batch processes can't have a terminal", i)
+		}
+		if err := syscont.ConvertProcessSpec(p, sysMgr, true); err != nil {
+			return -1, err
+		}
+		process, err := newProcess(*p, false, logLevel)
+		if err != nil {
+			return -1, err
+		}
+		process.Stdout = os.Stdout
+		process.Stderr = os.Stderr
+		processes = append(processes, process)
+	}
+
+	if err := container.StartBatch(processes); err != nil {
+		return -1, err
+	}
+	if path := context.String("pid-file"); path != "" {
+		if err := createPidFile(path, processes...); err != nil {
+			for _, p := range processes {
+				_ = p.Signal(unix.SIGKILL)
+				_, _ = p.Wait()
+			}
+			return -1, err
+		}
+	}
+	if context.Bool("detach") {
+		return 0, nil
+	}
+
+	status := 0
+	for _, p := range processes {
+		ps, err := p.Wait()
+		if ps == nil {
+			return -1, err
+		}
+		if ws, ok := ps.Sys().(unix.WaitStatus); ok && status == 0 {
+			status = utils.ExitStatus(ws)
+		}
+	}
+	return status, nil
+}
+
 func getProcess(context *cli.Context, bundle string, sysMgr *sysbox.Mgr) (*specs.Process, error) {
 	if path := context.String("process"); path != "" {
 		f, err := os.Open(path)
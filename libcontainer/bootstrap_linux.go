@@ -0,0 +1,148 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"fmt"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+
+	"github.com/sirupsen/logrus"
+	"github.com/vishvananda/netlink/nl"
+	"golang.org/x/sys/unix"
+)
+
+// sysbox-runc: the bootstrap data of exec processes (all but their oom score
+// adjustment and process specific attributes) is cached in the container's
+// state dir, in a file named after the init it was built for.
+const execBootstrapPrefix = "exec-bootstrap."
+
+// execBootstrapData returns the bootstrap data of a setns (exec) process. The
+// part of it that is the same for every exec into the container is only built
+// once (by the first exec) and reused afterwards; it depends on the container's
+// config and the namespaces of its init, so it's valid for as long as the init
+// is.
+func (c *linuxContainer) execBootstrapData(state *State, extra ...nl.NetlinkRequestData) ([]byte, error) {
+	cachePath := filepath.Join(c.root, fmt.Sprintf("%s%d-%d", execBootstrapPrefix, state.InitProcessPid, state.InitProcessStartTime))
+
+	data, err := ioutil.ReadFile(cachePath)
+	if err != nil || !validBootstrapData(data) {
+		r, err := c.bootstrapRequest(0, state.NamespacePaths)
+		if err != nil {
+			return nil, err
+		}
+		data = r.Serialize()
+		if err := c.cacheExecBootstrapData(cachePath, data); err != nil {
+			logrus.Debugf("unable to cache exec bootstrap data: %v", err)
+		}
+	}
+
+	oomScoreAdj, err := c.oomScoreAdjData()
+	if err != nil {
+		return nil, err
+	}
+	// The placement isn't cached either, as the cpuset can be updated.
+	attrs := append([]nl.NetlinkRequestData{oomScoreAdj}, c.placementData()...)
+	return appendBootstrapData(data, append(attrs, extra...)...), nil
+}
+
+func (c *linuxContainer) cacheExecBootstrapData(cachePath string, data []byte) (retErr error) {
+	tmpFile, err := ioutil.TempFile(c.root, execBootstrapPrefix+"tmp-")
+	if err != nil {
+		return err
+	}
+
+	defer func() {
+		if retErr != nil {
+			tmpFile.Close()
+			os.Remove(tmpFile.Name())
+		}
+	}()
+
+	if _, err := tmpFile.Write(data); err != nil {
+		return err
+	}
+	if err := tmpFile.Close(); err != nil {
+		return err
+	}
+	if err := os.Rename(tmpFile.Name(), cachePath); err != nil {
+		return err
+	}
+
+	// Drop the data cached for a previous init (e.g., before a restore).
+	stale, _ := filepath.Glob(filepath.Join(c.root, execBootstrapPrefix+"*"))
+	for _, path := range stale {
+		if path != cachePath {
+			os.Remove(path)
+		}
+	}
+	return nil
+}
+
+// validBootstrapData checks that data is a whole bootstrap message.
+func validBootstrapData(data []byte) bool {
+	if len(data) < unix.NLMSG_HDRLEN {
+		return false
+	}
+	native := nl.NativeEndian()
+	return native.Uint32(data[0:4]) == uint32(len(data)) && native.Uint16(data[4:6]) == InitMsg
+}
+
+// appendBootstrapData appends attributes to the bootstrap message msg.
+func appendBootstrapData(msg []byte, data ...nl.NetlinkRequestData) []byte {
+	buf := append([]byte(nil), msg...)
+	for _, d := range data {
+		buf = append(buf, d.Serialize()...)
+	}
+	nl.NativeEndian().PutUint32(buf[0:4], uint32(len(buf)))
+	return buf
+}
+
+// bootstrapMemfd returns a sealed memfd holding data.
+func bootstrapMemfd(data []byte) (*os.File, error) {
+	fd, err := unix.MemfdCreate("runc-bootstrap", unix.MFD_CLOEXEC|unix.MFD_ALLOW_SEALING)
+	if err != nil {
+		return nil, err
+	}
+	memfd := os.NewFile(uintptr(fd), "runc-bootstrap")
+	if _, err := memfd.Write(data); err != nil {
+		memfd.Close()
+		return nil, err
+	}
+	seals := unix.F_SEAL_SEAL | unix.F_SEAL_SHRINK | unix.F_SEAL_GROW | unix.F_SEAL_WRITE
+	if _, err := unix.FcntlInt(memfd.Fd(), unix.F_ADD_SEALS, seals); err != nil {
+		memfd.Close()
+		return nil, err
+	}
+	return memfd, nil
+}
+
+// sendBootstrapData sends the bootstrap data to nsexec through the init pipe.
+//
+// sysbox-runc: rather than the data itself, we send its netlink header along
+// with a sealed memfd holding the whole message; nsexec maps the memfd instead
+// of reading the data off the pipe into a buffer of its own (see nl_parse()).
+// If a memfd can't be used, the data is written to the pipe as usual.
+func sendBootstrapData(pipe *os.File, data []byte) error {
+	memfd, err := bootstrapMemfd(data)
+	if err != nil {
+		logrus.Debugf("unable to pass the bootstrap data in a memfd: %v", err)
+		_, err := pipe.Write(data)
+		return err
+	}
+	defer memfd.Close()
+
+	rawConn, err := pipe.SyscallConn()
+	if err != nil {
+		return err
+	}
+	var sendErr error
+	err = rawConn.Control(func(fd uintptr) {
+		sendErr = unix.Sendmsg(int(fd), data[:unix.NLMSG_HDRLEN], unix.UnixRights(int(memfd.Fd())), nil, 0)
+	})
+	if err != nil {
+		return err
+	}
+	return sendErr
+}
@@ -0,0 +1,82 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"bytes"
+	"io/ioutil"
+	"testing"
+
+	"github.com/vishvananda/netlink/nl"
+	"golang.org/x/sys/unix"
+)
+
+func TestAppendBootstrapData(t *testing.T) {
+	common := []nl.NetlinkRequestData{
+		&Int32msg{Type: CloneFlagsAttr, Value: 0},
+		&Bytemsg{Type: NsPathsAttr, Value: []byte("net:/proc/1/ns/net")},
+	}
+	extra := []nl.NetlinkRequestData{
+		&Bytemsg{Type: OomScoreAdjAttr, Value: []byte("-999")},
+		&Int32msg{Type: NsPidfdAttr, Value: 7},
+	}
+
+	r := nl.NewNetlinkRequest(int(InitMsg), 0)
+	for _, d := range common {
+		r.AddData(d)
+	}
+	msg := r.Serialize()
+
+	r = nl.NewNetlinkRequest(int(InitMsg), 0)
+	for _, d := range append(common, extra...) {
+		r.AddData(d)
+	}
+	expected := r.Serialize()
+
+	data := appendBootstrapData(msg, extra...)
+	if !bytes.Equal(data, expected) {
+		t.Fatalf("expected %v, got %v", expected, data)
+	}
+	if !validBootstrapData(data) {
+		t.Fatal("appended bootstrap data is not valid")
+	}
+	if !validBootstrapData(msg) {
+		t.Fatal("bootstrap data was changed by appending to it")
+	}
+	if validBootstrapData(data[:len(data)-4]) {
+		t.Fatal("truncated bootstrap data is valid")
+	}
+}
+
+func TestBootstrapMemfd(t *testing.T) {
+	data := []byte("bootstrap data")
+
+	memfd, err := bootstrapMemfd(data)
+	if err != nil {
+		t.Skipf("memfd not supported: %v", err)
+	}
+	defer memfd.Close()
+
+	seals, err := unix.FcntlInt(memfd.Fd(), unix.F_GET_SEALS, 0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	want := unix.F_SEAL_SEAL | unix.F_SEAL_SHRINK | unix.F_SEAL_GROW | unix.F_SEAL_WRITE
+	if seals&want != want {
+		t.Fatalf("expected seals %#x, got %#x", want, seals)
+	}
+	if _, err := memfd.Write([]byte("x")); err == nil {
+		t.Fatal("expected write to a sealed memfd to fail")
+	}
+
+	if _, err := memfd.Seek(0, 0); err != nil {
+		t.Fatal(err)
+	}
+	got, err := ioutil.ReadAll(memfd)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(got, data) {
+		t.Fatalf("expected %q, got %q", data, got)
+	}
+}
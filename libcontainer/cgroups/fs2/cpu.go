@@ -4,8 +4,8 @@ package fs2
 
 import (
 	"bufio"
-	"os"
 	"strconv"
+	"strings"
 
 	"github.com/opencontainers/runc/libcontainer/cgroups"
 	"github.com/opencontainers/runc/libcontainer/cgroups/fscommon"
@@ -16,7 +16,7 @@ func isCpuSet(cgroup *configs.Cgroup) bool {
 	return cgroup.Resources.CpuWeight != 0 || cgroup.Resources.CpuQuota != 0 || cgroup.Resources.CpuPeriod != 0
 }
 
-func setCpu(dirPath string, cgroup *configs.Cgroup) error {
+func setCpu(files *fileCache, cgroup *configs.Cgroup) error {
 	if !isCpuSet(cgroup) {
 		return nil
 	}
@@ -24,7 +24,7 @@ func setCpu(dirPath string, cgroup *configs.Cgroup) error {
 
 	// NOTE: .CpuShares is not used here. Conversion is the caller's responsibility.
 	if r.CpuWeight != 0 {
-		if err := fscommon.WriteFile(dirPath, "cpu.weight", strconv.FormatUint(r.CpuWeight, 10)); err != nil {
+		if err := files.writeFile("cpu.weight", strconv.FormatUint(r.CpuWeight, 10)); err != nil {
 			return err
 		}
 	}
@@ -41,21 +41,20 @@ func setCpu(dirPath string, cgroup *configs.Cgroup) error {
 			period = 100000
 		}
 		str += " " + strconv.FormatUint(period, 10)
-		if err := fscommon.WriteFile(dirPath, "cpu.max", str); err != nil {
+		if err := files.writeFile("cpu.max", str); err != nil {
 			return err
 		}
 	}
 
 	return nil
 }
-func statCpu(dirPath string, stats *cgroups.Stats) error {
-	f, err := fscommon.OpenFile(dirPath, "cpu.stat", os.O_RDONLY)
+func statCpu(files *fileCache, stats *cgroups.Stats) error {
+	contents, err := files.readFile("cpu.stat")
 	if err != nil {
 		return err
 	}
-	defer f.Close()
 
-	sc := bufio.NewScanner(f)
+	sc := bufio.NewScanner(strings.NewReader(contents))
 	for sc.Scan() {
 		t, v, err := fscommon.GetCgroupParamKeyValue(sc.Text())
 		if err != nil {
@@ -3,7 +3,6 @@
 package fs2
 
 import (
-	"github.com/opencontainers/runc/libcontainer/cgroups/fscommon"
 	"github.com/opencontainers/runc/libcontainer/configs"
 )
 
@@ -11,18 +10,18 @@ func isCpusetSet(cgroup *configs.Cgroup) bool {
 	return cgroup.Resources.CpusetCpus != "" || cgroup.Resources.CpusetMems != ""
 }
 
-func setCpuset(dirPath string, cgroup *configs.Cgroup) error {
+func setCpuset(files *fileCache, cgroup *configs.Cgroup) error {
 	if !isCpusetSet(cgroup) {
 		return nil
 	}
 
 	if cgroup.Resources.CpusetCpus != "" {
-		if err := fscommon.WriteFile(dirPath, "cpuset.cpus", cgroup.Resources.CpusetCpus); err != nil {
+		if err := files.writeFile("cpuset.cpus", cgroup.Resources.CpusetCpus); err != nil {
 			return err
 		}
 	}
 	if cgroup.Resources.CpusetMems != "" {
-		if err := fscommon.WriteFile(dirPath, "cpuset.mems", cgroup.Resources.CpusetMems); err != nil {
+		if err := files.writeFile("cpuset.mems", cgroup.Resources.CpusetMems); err != nil {
 			return err
 		}
 	}
@@ -8,7 +8,6 @@ import (
 	"github.com/opencontainers/runc/libcontainer/configs"
 	"github.com/opencontainers/runc/libcontainer/devices"
 	"github.com/pkg/errors"
-	"golang.org/x/sys/unix"
 )
 
 func isRWM(perms devices.Permissions) bool {
@@ -37,7 +36,7 @@ func canSkipEBPFError(cgroup *configs.Cgroup) bool {
 	return true
 }
 
-func setDevices(dirPath string, cgroup *configs.Cgroup) error {
+func setDevices(files *fileCache, cgroup *configs.Cgroup) error {
 	if cgroup.SkipDevices {
 		return nil
 	}
@@ -49,11 +48,10 @@ func setDevices(dirPath string, cgroup *configs.Cgroup) error {
 	if err != nil {
 		return err
 	}
-	dirFD, err := unix.Open(dirPath, unix.O_DIRECTORY|unix.O_RDONLY, 0600)
+	dirFD, err := files.dirFd()
 	if err != nil {
-		return errors.Errorf("cannot get dir FD for %s", dirPath)
+		return errors.Errorf("cannot get dir FD for %s", files.path())
 	}
-	defer unix.Close(dirFD)
 	// XXX: This code is currently incorrect when it comes to updating an
 	//      existing cgroup with new rules (new rulesets are just appended to
 	//      the program list because this uses BPF_F_ALLOW_MULTI). If we didn't
@@ -0,0 +1,187 @@
+// +build linux
+
+package fs2
+
+import (
+	"io"
+	"os"
+	"strings"
+	"sync"
+
+	"github.com/opencontainers/runc/libcontainer/cgroups"
+	"github.com/opencontainers/runc/libcontainer/cgroups/fscommon"
+	"github.com/pkg/errors"
+	"golang.org/x/sys/unix"
+)
+
+// sysbox-runc: fileCache is a handle on the directory of a cgroup, which keeps
+// the files in it open once they've been used: the directory is opened once,
+// the files in it with openat(2) relative to it, and every read or write of a
+// file after the first is then a single pread(2) or pwrite(2), rather than a
+// lookup of its path in cgroupfs, a read or write, and a close.
+//
+// A fileCache is safe for concurrent use.
+type fileCache struct {
+	mu      sync.Mutex
+	dirPath string
+	dir     *os.File
+	rd      map[string]*os.File
+	wr      map[string]*os.File
+	buf     []byte
+}
+
+func newFileCache(dirPath string) *fileCache {
+	return &fileCache{
+		dirPath: dirPath,
+		rd:      make(map[string]*os.File),
+		wr:      make(map[string]*os.File),
+	}
+}
+
+// path returns the cgroup's directory.
+func (c *fileCache) path() string {
+	return c.dirPath
+}
+
+// dirFd returns a file descriptor of the cgroup's directory, opened read-only
+// (as, e.g., the target of a cgroup BPF program must be). It's valid until the
+// cache is closed.
+func (c *fileCache) dirFd() (int, error) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if err := c.openDir(); err != nil {
+		return -1, err
+	}
+	return int(c.dir.Fd()), nil
+}
+
+func (c *fileCache) openDir() error {
+	if c.dir != nil {
+		return nil
+	}
+	dir, err := fscommon.OpenFile(c.dirPath, "", unix.O_RDONLY|unix.O_DIRECTORY)
+	if err != nil {
+		return err
+	}
+	c.dir = dir
+	return nil
+}
+
+func (c *fileCache) openFile(files map[string]*os.File, name string, flags int) (*os.File, error) {
+	if f, ok := files[name]; ok {
+		return f, nil
+	}
+	// Only files right in the directory (in which openat(2) can't follow a
+	// symlink out of it, with O_NOFOLLOW).
+	if name == "" || strings.Contains(name, "/") || name == "." || name == ".." {
+		return nil, &os.PathError{Op: "openat", Path: c.dirPath + "/" + name, Err: unix.EINVAL}
+	}
+	if err := c.openDir(); err != nil {
+		return nil, err
+	}
+	fd, err := unix.Openat(int(c.dir.Fd()), name, flags|unix.O_CLOEXEC|unix.O_NOFOLLOW, 0)
+	if err != nil {
+		return nil, &os.PathError{Op: "openat", Path: c.dirPath + "/" + name, Err: err}
+	}
+	f := os.NewFile(uintptr(fd), c.dirPath+"/"+name)
+	files[name] = f
+	return f, nil
+}
+
+// withFile runs fn on the file name, kept open in files (and opened with
+// flags first if need be). If the file was removed since it was opened (e.g.,
+// its controller was disabled and enabled again), the files are reopened and
+// fn is run once more.
+func (c *fileCache) withFile(files map[string]*os.File, name string, flags int, fn func(*os.File) error) error {
+	_, cached := files[name]
+	f, err := c.openFile(files, name, flags)
+	if err != nil {
+		return err
+	}
+	err = fn(f)
+	if cached && errors.Is(err, unix.ENODEV) {
+		c.closeFiles()
+		if f, err = c.openFile(files, name, flags); err != nil {
+			return err
+		}
+		err = fn(f)
+	}
+	return err
+}
+
+// readFile returns the content of the file name in the cgroup.
+func (c *fileCache) readFile(name string) (string, error) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if c.buf == nil {
+		c.buf = make([]byte, 4096)
+	}
+	n := 0
+	err := c.withFile(c.rd, name, unix.O_RDONLY, func(f *os.File) error {
+		n = 0
+		for {
+			m, err := f.ReadAt(c.buf[n:], int64(n))
+			n += m
+			if err == io.EOF {
+				return nil
+			}
+			if err != nil {
+				return err
+			}
+			if n == len(c.buf) {
+				c.buf = append(c.buf, make([]byte, len(c.buf))...)
+			}
+		}
+	})
+	if err != nil {
+		return "", err
+	}
+	return string(c.buf[:n]), nil
+}
+
+// writeFile writes data to the file name in the cgroup.
+func (c *fileCache) writeFile(name, data string) error {
+	if cgroups.TestMode {
+		// Unit tests "emulate" cgroupfs with regular files, which need to
+		// be truncated (or created) on every write.
+		return fscommon.WriteFile(c.dirPath, name, data)
+	}
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	err := c.withFile(c.wr, name, unix.O_WRONLY, func(f *os.File) error {
+		for {
+			_, err := f.WriteAt([]byte(data), 0)
+			if !errors.Is(err, unix.EINTR) {
+				return err
+			}
+		}
+	})
+	if err != nil {
+		return errors.Wrapf(err, "failed to write %q", data)
+	}
+	return nil
+}
+
+// close closes the directory and files kept open. The cache can still be
+// used afterwards; they are reopened as needed.
+func (c *fileCache) close() {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	c.closeFiles()
+}
+
+func (c *fileCache) closeFiles() {
+	for _, files := range []map[string]*os.File{c.rd, c.wr} {
+		for name, f := range files {
+			f.Close()
+			delete(files, name)
+		}
+	}
+	if c.dir != nil {
+		c.dir.Close()
+		c.dir = nil
+	}
+}
@@ -0,0 +1,70 @@
+// +build linux
+
+package fs2
+
+import (
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+)
+
+func TestFileCache(t *testing.T) {
+	dir, err := ioutil.TempDir("", "fs2_files_test")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	files := newFileCache(dir)
+	defer files.close()
+	files.buf = make([]byte, 16)
+
+	path := filepath.Join(dir, "pids.current")
+	for _, data := range []string{"12\n", strings.Repeat("long line\n", 10), "3\n"} {
+		if err := ioutil.WriteFile(path, []byte(data), 0644); err != nil {
+			t.Fatal(err)
+		}
+		got, err := files.readFile("pids.current")
+		if err != nil {
+			t.Fatal(err)
+		}
+		if got != data {
+			t.Fatalf("expected %q, got %q", data, got)
+		}
+	}
+	if len(files.rd) != 1 || files.dir == nil {
+		t.Fatalf("expected the directory and file to be kept open, got %d open files", len(files.rd))
+	}
+
+	value, err := getStatUint(files, "pids.current")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if value != 3 {
+		t.Fatalf("expected 3, got %d", value)
+	}
+
+	if err := files.writeFile("pids.current", "4\n"); err != nil {
+		t.Fatal(err)
+	}
+	if value, err := getStatUint(files, "pids.current"); err != nil || value != 4 {
+		t.Fatalf("expected 4, got %d (%v)", value, err)
+	}
+
+	if _, err := files.readFile("pids.max"); !os.IsNotExist(err) {
+		t.Fatalf("expected a not exist error, got %v", err)
+	}
+	if _, err := files.readFile("../pids.current"); err == nil {
+		t.Fatal("expected a file out of the cgroup to not be opened")
+	}
+
+	files.close()
+	if len(files.rd) != 0 || len(files.wr) != 0 || files.dir != nil {
+		t.Fatal("expected the directory and files to be closed")
+	}
+	if value, err := getStatUint(files, "pids.current"); err != nil || value != 4 {
+		t.Fatalf("expected 4 after reopening, got %d (%v)", value, err)
+	}
+}
@@ -23,6 +23,8 @@ type manager struct {
 	// excludes pseudo-controllers ("devices" and "freezer").
 	controllers map[string]struct{}
 	rootless    bool
+	// sysbox-runc: files keeps the cgroup's directory and files open.
+	files *fileCache
 }
 
 // NewManager creates a manager for cgroup v2 unified hierarchy.
@@ -44,6 +46,7 @@ func NewManager(config *configs.Cgroup, dirPath string, rootless bool) (cgroups.
 		config:   config,
 		dirPath:  dirPath,
 		rootless: rootless,
+		files:    newFileCache(dirPath),
 	}
 	return m, nil
 }
@@ -53,7 +56,7 @@ func (m *manager) getControllers() error {
 		return nil
 	}
 
-	data, err := fscommon.ReadFile(m.dirPath, "cgroup.controllers")
+	data, err := m.files.readFile("cgroup.controllers")
 	if err != nil {
 		if m.rootless && m.config.Path == "" {
 			return nil
@@ -88,6 +91,10 @@ func (m *manager) Apply(pid int) error {
 	if err := cgroups.WriteCgroupProc(m.dirPath, pid); err != nil {
 		return err
 	}
+	// The cgroup's files are opened relative to its directory from now on.
+	if _, err := m.files.dirFd(); err != nil {
+		return err
+	}
 	return nil
 }
 
@@ -100,61 +107,14 @@ func (m *manager) GetAllPids() ([]int, error) {
 }
 
 func (m *manager) GetStats() (*cgroups.Stats, error) {
-	var (
-		errs []error
-	)
-
-	st := cgroups.NewStats()
 	if err := m.getControllers(); err != nil {
-		return st, err
-	}
-
-	// pids (since kernel 4.5)
-	if _, ok := m.controllers["pids"]; ok {
-		if err := statPids(m.dirPath, st); err != nil {
-			errs = append(errs, err)
-		}
-	} else {
-		if err := statPidsWithoutController(m.dirPath, st); err != nil {
-			errs = append(errs, err)
-		}
-	}
-	// memory (since kernel 4.5)
-	if _, ok := m.controllers["memory"]; ok {
-		if err := statMemory(m.dirPath, st); err != nil {
-			errs = append(errs, err)
-		}
-	}
-	// io (since kernel 4.5)
-	if _, ok := m.controllers["io"]; ok {
-		if err := statIo(m.dirPath, st); err != nil {
-			errs = append(errs, err)
-		}
-	}
-	// cpu (since kernel 4.15)
-	if _, ok := m.controllers["cpu"]; ok {
-		if err := statCpu(m.dirPath, st); err != nil {
-			errs = append(errs, err)
-		}
-	}
-	// hugetlb (since kernel 5.6)
-	if _, ok := m.controllers["hugetlb"]; ok {
-		if err := statHugeTlb(m.dirPath, st); err != nil {
-			errs = append(errs, err)
-		}
-	}
-	// rdma (since kernel 4.11)
-	if err := fscommon.RdmaGetStats(m.dirPath, st); err != nil && !os.IsNotExist(err) {
-		errs = append(errs, err)
-	}
-	if len(errs) > 0 && !m.rootless {
-		return st, errors.Errorf("error while statting cgroup v2: %+v", errs)
+		return cgroups.NewStats(), err
 	}
-	return st, nil
+	return getStats(m.files, m.controllers, m.rootless)
 }
 
 func (m *manager) Freeze(state configs.FreezerState) error {
-	if err := setFreezer(m.dirPath, state); err != nil {
+	if err := setFreezer(m.files, state); err != nil {
 		return err
 	}
 	m.config.Resources.Freezer = state
@@ -162,6 +122,7 @@ func (m *manager) Freeze(state configs.FreezerState) error {
 }
 
 func (m *manager) Destroy() error {
+	m.files.close()
 	return cgroups.RemovePath(m.dirPath)
 }
 
@@ -177,19 +138,19 @@ func (m *manager) Set(container *configs.Config) error {
 		return err
 	}
 	// pids (since kernel 4.5)
-	if err := setPids(m.dirPath, container.Cgroups); err != nil {
+	if err := setPids(m.files, container.Cgroups); err != nil {
 		return err
 	}
 	// memory (since kernel 4.5)
-	if err := setMemory(m.dirPath, container.Cgroups); err != nil {
+	if err := setMemory(m.files, container.Cgroups); err != nil {
 		return err
 	}
 	// io (since kernel 4.5)
-	if err := setIo(m.dirPath, container.Cgroups); err != nil {
+	if err := setIo(m.files, container.Cgroups); err != nil {
 		return err
 	}
 	// cpu (since kernel 4.15)
-	if err := setCpu(m.dirPath, container.Cgroups); err != nil {
+	if err := setCpu(m.files, container.Cgroups); err != nil {
 		return err
 	}
 	// devices (since kernel 4.15, pseudo-controller)
@@ -197,15 +158,15 @@ func (m *manager) Set(container *configs.Config) error {
 	// When m.Rootless is true, errors from the device subsystem are ignored because it is really not expected to work.
 	// However, errors from other subsystems are not ignored.
 	// see @test "runc create (rootless + limits + no cgrouppath + no permission) fails with informative error"
-	if err := setDevices(m.dirPath, container.Cgroups); err != nil && !m.rootless {
+	if err := setDevices(m.files, container.Cgroups); err != nil && !m.rootless {
 		return err
 	}
 	// cpuset (since kernel 5.0)
-	if err := setCpuset(m.dirPath, container.Cgroups); err != nil {
+	if err := setCpuset(m.files, container.Cgroups); err != nil {
 		return err
 	}
 	// hugetlb (since kernel 5.6)
-	if err := setHugeTlb(m.dirPath, container.Cgroups); err != nil {
+	if err := setHugeTlb(m.files, container.Cgroups); err != nil {
 		return err
 	}
 	// rdma (since kernel 4.11)
@@ -213,7 +174,7 @@ func (m *manager) Set(container *configs.Config) error {
 		return err
 	}
 	// freezer (since kernel 5.2, pseudo-controller)
-	if err := setFreezer(m.dirPath, container.Cgroups.Freezer); err != nil {
+	if err := setFreezer(m.files, container.Cgroups.Freezer); err != nil {
 		return err
 	}
 	if err := m.setUnified(container.Cgroups.Unified); err != nil {
@@ -228,7 +189,7 @@ func (m *manager) setUnified(res map[string]string) error {
 		if strings.Contains(k, "/") {
 			return fmt.Errorf("unified resource %q must be a file name (no slashes)", k)
 		}
-		if err := fscommon.WriteFile(m.dirPath, k, v); err != nil {
+		if err := m.files.writeFile(k, v); err != nil {
 			errC := errors.Cause(err)
 			// Check for both EPERM and ENOENT since O_CREAT is used by WriteFile.
 			if errors.Is(errC, os.ErrPermission) || errors.Is(errC, os.ErrNotExist) {
@@ -261,7 +222,7 @@ func (m *manager) GetCgroups() (*configs.Cgroup, error) {
 }
 
 func (m *manager) GetFreezerState() (configs.FreezerState, error) {
-	return getFreezer(m.dirPath)
+	return getFreezer(m.files)
 }
 
 func (m *manager) Exists() bool {
@@ -16,12 +16,12 @@ func isHugeTlbSet(cgroup *configs.Cgroup) bool {
 	return len(cgroup.Resources.HugetlbLimit) > 0
 }
 
-func setHugeTlb(dirPath string, cgroup *configs.Cgroup) error {
+func setHugeTlb(files *fileCache, cgroup *configs.Cgroup) error {
 	if !isHugeTlbSet(cgroup) {
 		return nil
 	}
 	for _, hugetlb := range cgroup.Resources.HugetlbLimit {
-		if err := fscommon.WriteFile(dirPath, "hugetlb."+hugetlb.Pagesize+".max", strconv.FormatUint(hugetlb.Limit, 10)); err != nil {
+		if err := files.writeFile("hugetlb."+hugetlb.Pagesize+".max", strconv.FormatUint(hugetlb.Limit, 10)); err != nil {
 			return err
 		}
 	}
@@ -29,7 +29,7 @@ func setHugeTlb(dirPath string, cgroup *configs.Cgroup) error {
 	return nil
 }
 
-func statHugeTlb(dirPath string, stats *cgroups.Stats) error {
+func statHugeTlb(files *fileCache, stats *cgroups.Stats) error {
 	hugePageSizes, err := cgroups.GetHugePageSize()
 	if err != nil {
 		return errors.Wrap(err, "failed to fetch hugetlb info")
@@ -37,14 +37,14 @@ func statHugeTlb(dirPath string, stats *cgroups.Stats) error {
 	hugetlbStats := cgroups.HugetlbStats{}
 
 	for _, pagesize := range hugePageSizes {
-		value, err := fscommon.GetCgroupParamUint(dirPath, "hugetlb."+pagesize+".current")
+		value, err := getStatUint(files, "hugetlb."+pagesize+".current")
 		if err != nil {
 			return err
 		}
 		hugetlbStats.Usage = value
 
 		fileName := "hugetlb." + pagesize + ".events"
-		contents, err := fscommon.ReadFile(dirPath, fileName)
+		contents, err := files.readFile(fileName)
 		if err != nil {
 			return errors.Wrap(err, "failed to read stats")
 		}
@@ -4,12 +4,10 @@ package fs2
 
 import (
 	"bufio"
-	"os"
 	"strconv"
 	"strings"
 
 	"github.com/opencontainers/runc/libcontainer/cgroups"
-	"github.com/opencontainers/runc/libcontainer/cgroups/fscommon"
 	"github.com/opencontainers/runc/libcontainer/configs"
 )
 
@@ -21,35 +19,35 @@ func isIoSet(cgroup *configs.Cgroup) bool {
 		len(cgroup.Resources.BlkioThrottleWriteIOPSDevice) > 0
 }
 
-func setIo(dirPath string, cgroup *configs.Cgroup) error {
+func setIo(files *fileCache, cgroup *configs.Cgroup) error {
 	if !isIoSet(cgroup) {
 		return nil
 	}
 
 	if cgroup.Resources.BlkioWeight != 0 {
 		filename := "io.bfq.weight"
-		if err := fscommon.WriteFile(dirPath, filename,
+		if err := files.writeFile(filename,
 			strconv.FormatUint(cgroups.ConvertBlkIOToCgroupV2Value(cgroup.Resources.BlkioWeight), 10)); err != nil {
 			return err
 		}
 	}
 	for _, td := range cgroup.Resources.BlkioThrottleReadBpsDevice {
-		if err := fscommon.WriteFile(dirPath, "io.max", td.StringName("rbps")); err != nil {
+		if err := files.writeFile("io.max", td.StringName("rbps")); err != nil {
 			return err
 		}
 	}
 	for _, td := range cgroup.Resources.BlkioThrottleWriteBpsDevice {
-		if err := fscommon.WriteFile(dirPath, "io.max", td.StringName("wbps")); err != nil {
+		if err := files.writeFile("io.max", td.StringName("wbps")); err != nil {
 			return err
 		}
 	}
 	for _, td := range cgroup.Resources.BlkioThrottleReadIOPSDevice {
-		if err := fscommon.WriteFile(dirPath, "io.max", td.StringName("riops")); err != nil {
+		if err := files.writeFile("io.max", td.StringName("riops")); err != nil {
 			return err
 		}
 	}
 	for _, td := range cgroup.Resources.BlkioThrottleWriteIOPSDevice {
-		if err := fscommon.WriteFile(dirPath, "io.max", td.StringName("wiops")); err != nil {
+		if err := files.writeFile("io.max", td.StringName("wiops")); err != nil {
 			return err
 		}
 	}
@@ -57,14 +55,13 @@ func setIo(dirPath string, cgroup *configs.Cgroup) error {
 	return nil
 }
 
-func readCgroup2MapFile(dirPath string, name string) (map[string][]string, error) {
+func readCgroup2MapFile(files *fileCache, name string) (map[string][]string, error) {
 	ret := map[string][]string{}
-	f, err := fscommon.OpenFile(dirPath, name, os.O_RDONLY)
+	contents, err := files.readFile(name)
 	if err != nil {
 		return nil, err
 	}
-	defer f.Close()
-	scanner := bufio.NewScanner(f)
+	scanner := bufio.NewScanner(strings.NewReader(contents))
 	for scanner.Scan() {
 		line := scanner.Text()
 		parts := strings.Fields(line)
@@ -79,10 +76,10 @@ func readCgroup2MapFile(dirPath string, name string) (map[string][]string, error
 	return ret, nil
 }
 
-func statIo(dirPath string, stats *cgroups.Stats) error {
+func statIo(files *fileCache, stats *cgroups.Stats) error {
 	// more details on the io.stat file format: https://www.kernel.org/doc/Documentation/cgroup-v2.txt
 	var ioServiceBytesRecursive []cgroups.BlkioStatEntry
-	values, err := readCgroup2MapFile(dirPath, "io.stat")
+	values, err := readCgroup2MapFile(files, "io.stat")
 	if err != nil {
 		return err
 	}
@@ -6,6 +6,7 @@ import (
 	"bufio"
 	"os"
 	"strconv"
+	"strings"
 
 	"github.com/opencontainers/runc/libcontainer/cgroups"
 	"github.com/opencontainers/runc/libcontainer/cgroups/fscommon"
@@ -35,7 +36,7 @@ func isMemorySet(cgroup *configs.Cgroup) bool {
 		cgroup.Resources.Memory != 0 || cgroup.Resources.MemorySwap != 0
 }
 
-func setMemory(dirPath string, cgroup *configs.Cgroup) error {
+func setMemory(files *fileCache, cgroup *configs.Cgroup) error {
 	if !isMemorySet(cgroup) {
 		return nil
 	}
@@ -50,13 +51,13 @@ func setMemory(dirPath string, cgroup *configs.Cgroup) error {
 	}
 	// never write empty string to `memory.swap.max`, it means set to 0.
 	if swapStr != "" {
-		if err := fscommon.WriteFile(dirPath, "memory.swap.max", swapStr); err != nil {
+		if err := files.writeFile("memory.swap.max", swapStr); err != nil {
 			return err
 		}
 	}
 
 	if val := numToStr(cgroup.Resources.Memory); val != "" {
-		if err := fscommon.WriteFile(dirPath, "memory.max", val); err != nil {
+		if err := files.writeFile("memory.max", val); err != nil {
 			return err
 		}
 	}
@@ -64,7 +65,7 @@ func setMemory(dirPath string, cgroup *configs.Cgroup) error {
 	// cgroup.Resources.KernelMemory is ignored
 
 	if val := numToStr(cgroup.Resources.MemoryReservation); val != "" {
-		if err := fscommon.WriteFile(dirPath, "memory.low", val); err != nil {
+		if err := files.writeFile("memory.low", val); err != nil {
 			return err
 		}
 	}
@@ -72,15 +73,14 @@ func setMemory(dirPath string, cgroup *configs.Cgroup) error {
 	return nil
 }
 
-func statMemory(dirPath string, stats *cgroups.Stats) error {
+func statMemory(files *fileCache, stats *cgroups.Stats) error {
 	// Set stats from memory.stat.
-	statsFile, err := fscommon.OpenFile(dirPath, "memory.stat", os.O_RDONLY)
+	contents, err := files.readFile("memory.stat")
 	if err != nil {
 		return err
 	}
-	defer statsFile.Close()
 
-	sc := bufio.NewScanner(statsFile)
+	sc := bufio.NewScanner(strings.NewReader(contents))
 	for sc.Scan() {
 		t, v, err := fscommon.GetCgroupParamKeyValue(sc.Text())
 		if err != nil {
@@ -90,12 +90,12 @@ func statMemory(dirPath string, stats *cgroups.Stats) error {
 	}
 	stats.MemoryStats.Cache = stats.MemoryStats.Stats["cache"]
 
-	memoryUsage, err := getMemoryDataV2(dirPath, "")
+	memoryUsage, err := getMemoryDataV2(files, "")
 	if err != nil {
 		return err
 	}
 	stats.MemoryStats.Usage = memoryUsage
-	swapUsage, err := getMemoryDataV2(dirPath, "swap")
+	swapUsage, err := getMemoryDataV2(files, "swap")
 	if err != nil {
 		return err
 	}
@@ -105,7 +105,7 @@ func statMemory(dirPath string, stats *cgroups.Stats) error {
 	return nil
 }
 
-func getMemoryDataV2(path, name string) (cgroups.MemoryData, error) {
+func getMemoryDataV2(files *fileCache, name string) (cgroups.MemoryData, error) {
 	memoryData := cgroups.MemoryData{}
 
 	moduleName := "memory"
@@ -115,7 +115,7 @@ func getMemoryDataV2(path, name string) (cgroups.MemoryData, error) {
 	usage := moduleName + ".current"
 	limit := moduleName + ".max"
 
-	value, err := fscommon.GetCgroupParamUint(path, usage)
+	value, err := getStatUint(files, usage)
 	if err != nil {
 		if moduleName != "memory" && os.IsNotExist(err) {
 			return cgroups.MemoryData{}, nil
@@ -124,7 +124,7 @@ func getMemoryDataV2(path, name string) (cgroups.MemoryData, error) {
 	}
 	memoryData.Usage = value
 
-	value, err = fscommon.GetCgroupParamUint(path, limit)
+	value, err = getStatUint(files, limit)
 	if err != nil {
 		if moduleName != "memory" && os.IsNotExist(err) {
 			return cgroups.MemoryData{}, nil
@@ -17,12 +17,12 @@ func isPidsSet(cgroup *configs.Cgroup) bool {
 	return cgroup.Resources.PidsLimit != 0
 }
 
-func setPids(dirPath string, cgroup *configs.Cgroup) error {
+func setPids(files *fileCache, cgroup *configs.Cgroup) error {
 	if !isPidsSet(cgroup) {
 		return nil
 	}
 	if val := numToStr(cgroup.Resources.PidsLimit); val != "" {
-		if err := fscommon.WriteFile(dirPath, "pids.max", val); err != nil {
+		if err := files.writeFile("pids.max", val); err != nil {
 			return err
 		}
 	}
@@ -30,12 +30,12 @@ func setPids(dirPath string, cgroup *configs.Cgroup) error {
 	return nil
 }
 
-func statPidsWithoutController(dirPath string, stats *cgroups.Stats) error {
+func statPidsWithoutController(files *fileCache, stats *cgroups.Stats) error {
 	// if the controller is not enabled, let's read PIDS from cgroups.procs
 	// (or threads if cgroup.threads is enabled)
-	contents, err := fscommon.ReadFile(dirPath, "cgroup.procs")
+	contents, err := files.readFile("cgroup.procs")
 	if errors.Is(err, unix.ENOTSUP) {
-		contents, err = fscommon.ReadFile(dirPath, "cgroup.threads")
+		contents, err = files.readFile("cgroup.threads")
 	}
 	if err != nil {
 		return err
@@ -51,16 +51,17 @@ func statPidsWithoutController(dirPath string, stats *cgroups.Stats) error {
 	return nil
 }
 
-func statPids(dirPath string, stats *cgroups.Stats) error {
-	current, err := fscommon.GetCgroupParamUint(dirPath, "pids.current")
+func statPids(files *fileCache, stats *cgroups.Stats) error {
+	current, err := getStatUint(files, "pids.current")
 	if err != nil {
 		return errors.Wrap(err, "failed to parse pids.current")
 	}
 
-	maxString, err := fscommon.GetCgroupParamString(dirPath, "pids.max")
+	maxString, err := files.readFile("pids.max")
 	if err != nil {
 		return errors.Wrap(err, "failed to parse pids.max")
 	}
+	maxString = strings.TrimSpace(maxString)
 
 	// Default if pids.max == "max" is 0 -- which represents "no limit".
 	var max uint64
@@ -68,7 +69,7 @@ func statPids(dirPath string, stats *cgroups.Stats) error {
 		max, err = fscommon.ParseUint(maxString, 10, 64)
 		if err != nil {
 			return errors.Wrapf(err, "failed to parse pids.max - unable to parse %q as a uint from Cgroup file %q",
-				maxString, filepath.Join(dirPath, "pids.max"))
+				maxString, filepath.Join(files.path(), "pids.max"))
 		}
 	}
 
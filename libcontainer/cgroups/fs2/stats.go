@@ -0,0 +1,125 @@
+// +build linux
+
+package fs2
+
+import (
+	"math"
+	"os"
+	"strings"
+
+	"github.com/opencontainers/runc/libcontainer/cgroups"
+	"github.com/opencontainers/runc/libcontainer/cgroups/fscommon"
+	"github.com/pkg/errors"
+)
+
+// sysbox-runc: StatsReader reads the stats of a cgroup through file
+// descriptors that it keeps open between reads (see fileCache), so that each
+// read of a file is a single pread(2) rather than an open/read/close. This is
+// meant for sampling the stats of a cgroup repeatedly, e.g. by "events".
+type StatsReader struct {
+	files       *fileCache
+	controllers map[string]struct{}
+	rootless    bool
+}
+
+// NewStatsReader returns a StatsReader for the cgroup v2 cgroup at dirPath.
+func NewStatsReader(dirPath string, rootless bool) (*StatsReader, error) {
+	files := newFileCache(dirPath)
+	data, err := files.readFile("cgroup.controllers")
+	if err != nil && !rootless {
+		files.close()
+		return nil, err
+	}
+	fields := strings.Fields(data)
+	controllers := make(map[string]struct{}, len(fields))
+	for _, c := range fields {
+		controllers[c] = struct{}{}
+	}
+	return &StatsReader{
+		files:       files,
+		controllers: controllers,
+		rootless:    rootless,
+	}, nil
+}
+
+// GetStats returns the current stats of the cgroup.
+func (r *StatsReader) GetStats() (*cgroups.Stats, error) {
+	return getStats(r.files, r.controllers, r.rootless)
+}
+
+// Close closes the files of the cgroup kept open by r.
+func (r *StatsReader) Close() error {
+	r.files.close()
+	return nil
+}
+
+// getStats returns the stats of the cgroup read through files, for the
+// enabled controllers. Errors are ignored in rootless mode.
+func getStats(files *fileCache, controllers map[string]struct{}, rootless bool) (*cgroups.Stats, error) {
+	var (
+		errs []error
+	)
+
+	st := cgroups.NewStats()
+
+	// pids (since kernel 4.5)
+	if _, ok := controllers["pids"]; ok {
+		if err := statPids(files, st); err != nil {
+			errs = append(errs, err)
+		}
+	} else {
+		if err := statPidsWithoutController(files, st); err != nil {
+			errs = append(errs, err)
+		}
+	}
+	// memory (since kernel 4.5)
+	if _, ok := controllers["memory"]; ok {
+		if err := statMemory(files, st); err != nil {
+			errs = append(errs, err)
+		}
+	}
+	// io (since kernel 4.5)
+	if _, ok := controllers["io"]; ok {
+		if err := statIo(files, st); err != nil {
+			errs = append(errs, err)
+		}
+	}
+	// cpu (since kernel 4.15)
+	if _, ok := controllers["cpu"]; ok {
+		if err := statCpu(files, st); err != nil {
+			errs = append(errs, err)
+		}
+	}
+	// hugetlb (since kernel 5.6)
+	if _, ok := controllers["hugetlb"]; ok {
+		if err := statHugeTlb(files, st); err != nil {
+			errs = append(errs, err)
+		}
+	}
+	// rdma (since kernel 4.11)
+	if err := fscommon.RdmaGetStats(files.path(), st); err != nil && !os.IsNotExist(err) {
+		errs = append(errs, err)
+	}
+	if len(errs) > 0 && !rootless {
+		return st, errors.Errorf("error while statting cgroup v2: %+v", errs)
+	}
+	return st, nil
+}
+
+// getStatUint reads a single uint64 value from the file name in the cgroup.
+// If the value read is "max", the math.MaxUint64 is returned.
+func getStatUint(files *fileCache, name string) (uint64, error) {
+	contents, err := files.readFile(name)
+	if err != nil {
+		return 0, err
+	}
+	contents = strings.TrimSpace(contents)
+	if contents == "max" {
+		return math.MaxUint64, nil
+	}
+	res, err := fscommon.ParseUint(contents, 10, 64)
+	if err != nil {
+		return res, errors.Errorf("unable to parse file %q", files.path()+"/"+name)
+	}
+	return res, nil
+}
@@ -221,6 +221,10 @@ type Config struct {
 	// ShiftfsMounts is a list of directories on which shiftfs needs to be mounted
 	ShiftfsMounts []shiftfs.MountPoint `json:"shiftfs_mounts,omitempty"`
 
+	// IDMappedMounts is a list of directories that nsexec ID-maps (with the
+	// container's user-ns) while setting up the container's init process.
+	IDMappedMounts []string `json:"idmapped_mounts,omitempty"`
+
 	// SwitchDockerDns indicates if the containers should change the IP address
 	// of Docker DNS hosts with localhost addresses.
 	SwitchDockerDns bool `json:"switch_docker_dns,omitempty"`
@@ -25,9 +25,11 @@ import (
 
 	"github.com/nestybox/sysbox-libs/mount"
 	"github.com/opencontainers/runc/libcontainer/cgroups"
+	"github.com/opencontainers/runc/libcontainer/cgroups/fs2"
 	"github.com/opencontainers/runc/libcontainer/configs"
 	"github.com/opencontainers/runc/libcontainer/intelrdt"
 	"github.com/opencontainers/runc/libcontainer/logs"
+	"github.com/opencontainers/runc/libcontainer/seccomp"
 	"github.com/opencontainers/runc/libcontainer/system"
 	"github.com/opencontainers/runc/libcontainer/utils"
 	"github.com/opencontainers/runc/libsysbox/sysbox"
@@ -48,6 +50,7 @@ import (
 	"github.com/nestybox/sysbox-libs/idMap"
 	sh "github.com/nestybox/sysbox-libs/idShiftUtils"
 	"github.com/nestybox/sysbox-libs/shiftfs"
+	libutils "github.com/nestybox/sysbox-libs/utils"
 )
 
 const stdioFdCount = 3
@@ -65,6 +68,7 @@ type linuxContainer struct {
 	criuPath             string
 	newuidmapPath        string
 	newgidmapPath        string
+	sharedBinDir         string
 	m                    sync.Mutex
 	criuVersion          int
 	state                containerState
@@ -162,6 +166,34 @@ type Container interface {
 	// errors:
 	// Systemerror - System error.
 	NotifyMemoryPressure(level PressureLevel) (<-chan struct{}, error)
+
+	// StartBatch starts several processes inside the container at once, with a
+	// single nsexec bootstrap (the container's namespaces are joined once for
+	// all of them). The processes can't be the container's init, and can't have
+	// a console or extra files; their stdio, if set, must be *os.File. Returns
+	// error if any of the processes fails to start, in which case none of them
+	// is left running.
+	//
+	// sysbox-runc
+	//
+	// errors:
+	// ConfigInvalid - config is invalid,
+	// SystemError - System error.
+	StartBatch(processes []*Process) error
+
+	// NotifyStats returns a channel on which the container's stats are sent
+	// right away, then each time the container's cgroup.events, memory.events
+	// or pids.events files are modified (i.e., the container is frozen or
+	// thawed, or hits its memory or pids limits), and every interval otherwise
+	// (for the counters the kernel doesn't notify about). The cgroup files are
+	// kept open between samples. The channel is closed once the container's
+	// cgroup has no more processes. Requires cgroup v2.
+	//
+	// sysbox-runc
+	//
+	// errors:
+	// Systemerror - System error.
+	NotifyStats(interval time.Duration) (<-chan *Stats, error)
 }
 
 // ID returns the container's unique ID
@@ -211,11 +243,16 @@ func (c *linuxContainer) Processes() ([]int, error) {
 }
 
 func (c *linuxContainer) Stats() (*Stats, error) {
+	return c.stats(c.cgroupManager.GetStats)
+}
+
+// stats returns the container's stats, with its cgroup stats from getCgroupStats.
+func (c *linuxContainer) stats(getCgroupStats func() (*cgroups.Stats, error)) (*Stats, error) {
 	var (
 		err   error
 		stats = &Stats{}
 	)
-	if stats.CgroupStats, err = c.cgroupManager.GetStats(); err != nil {
+	if stats.CgroupStats, err = getCgroupStats(); err != nil {
 		return stats, newSystemErrorWithCause(err, "getting container stats from cgroups")
 	}
 	if c.intelRdtManager != nil {
@@ -336,6 +373,36 @@ func (c *linuxContainer) Run(process *Process) error {
 	return nil
 }
 
+// sysbox-runc: maxBatchSize is the most processes StartBatch() starts at once.
+const maxBatchSize = 128
+
+func (c *linuxContainer) StartBatch(processes []*Process) error {
+	c.m.Lock()
+	defer c.m.Unlock()
+
+	if len(processes) == 0 || len(processes) > maxBatchSize {
+		return newGenericError(fmt.Errorf("a batch must have 1 to %d processes", maxBatchSize), ConfigInvalid)
+	}
+	for _, p := range processes {
+		if p.Init {
+			return newGenericError(errors.New("can't start the container's init in a batch"), ConfigInvalid)
+		}
+		if p.ConsoleSocket != nil || len(p.ExtraFiles) > 0 {
+			return newGenericError(errors.New("batch processes can't have a console or extra files"), ConfigInvalid)
+		}
+	}
+
+	parent, err := c.newBatchSetnsProcess(processes)
+	if err != nil {
+		return newSystemErrorWithCause(err, "creating new batch parent process")
+	}
+	parent.forwardChildLogs()
+	if err := parent.start(); err != nil {
+		return newSystemErrorWithCause(err, "starting container processes")
+	}
+	return nil
+}
+
 func (c *linuxContainer) Exec() error {
 	c.m.Lock()
 	defer c.m.Unlock()
@@ -427,14 +494,19 @@ func (c *linuxContainer) start(process *Process) error {
 	// generate a timestamp indicating when the container was started
 	c.created = time.Now().UTC()
 
-	// sysbox-runc: send the creation-timestamp to sysbox-fs.
-	if process.Init && c.sysFs.Enabled() {
-		if err := c.sysFs.SendCreationTime(c.created); err != nil {
-			return newSystemErrorWithCause(err, "sending creation timestamp to sysbox-fs")
+	if process.Init {
+		// sysbox-runc: send the creation-timestamp to sysbox-fs, while the
+		// container's state is saved (it must be sent before the poststart
+		// hooks run).
+		sysFsErr := make(chan error, 1)
+		if c.sysFs.Enabled() {
+			go func() {
+				sysFsErr <- c.sysFs.SendCreationTime(c.created)
+			}()
+		} else {
+			sysFsErr <- nil
 		}
-	}
 
-	if process.Init {
 		c.state = &createdState{
 			c: c,
 		}
@@ -444,6 +516,10 @@ func (c *linuxContainer) start(process *Process) error {
 		}
 		c.initProcessStartTime = state.InitProcessStartTime
 
+		if err := <-sysFsErr; err != nil {
+			return newSystemErrorWithCause(err, "sending creation timestamp to sysbox-fs")
+		}
+
 		if c.config.Hooks != nil {
 			s, err := c.currentOCIState()
 			if err != nil {
@@ -601,7 +677,7 @@ func (c *linuxContainer) commandTemplate(p *Process, childInitPipe *os.File, chi
 	if cmd.SysProcAttr == nil {
 		cmd.SysProcAttr = &unix.SysProcAttr{}
 	}
-	cmd.Env = append(cmd.Env, "GOMAXPROCS="+os.Getenv("GOMAXPROCS"))
+	cmd.Env = append(cmd.Env, initRuntimeEnv()...)
 	cmd.ExtraFiles = append(cmd.ExtraFiles, p.ExtraFiles...)
 	if p.ConsoleSocket != nil {
 		cmd.ExtraFiles = append(cmd.ExtraFiles, p.ConsoleSocket)
@@ -620,6 +696,7 @@ func (c *linuxContainer) commandTemplate(p *Process, childInitPipe *os.File, chi
 		"_LIBCONTAINER_LOGPIPE="+strconv.Itoa(stdioFdCount+len(cmd.ExtraFiles)-1),
 		"_LIBCONTAINER_LOGLEVEL="+p.LogLevel,
 	)
+	c.useSharedBinary(cmd)
 
 	// NOTE: when running a container with no PID namespace and the parent process spawning the container is
 	// PID1 the pdeathsig is being delivered to the container's init process by the kernel for some reason
@@ -639,7 +716,23 @@ func (c *linuxContainer) newInitProcess(p *Process, cmd *exec.Cmd, messageSockPa
 		}
 	}
 	_, sharePidns := nsMaps[configs.NEWPID]
-	data, err := c.bootstrapData(c.config.Namespaces.CloneFlags(), nsMaps)
+
+	// sysbox-runc: on cgroup v2 the init inherits its cgroup from the bootstrap
+	// process (which p.manager.Apply() moves there before sending the bootstrap
+	// data), and unless Intel RDT is in use there's nothing else to set up
+	// before it can create its cgroup namespace; so spare it the
+	// CREATECGROUPNS round-trip.
+	var extra []nl.NetlinkRequestData
+	cgroupnsNoSync := false
+	if c.config.Namespaces.Contains(configs.NEWCGROUP) && c.config.Namespaces.PathOf(configs.NEWCGROUP) == "" {
+		cgroupnsNoSync = cgroups.IsCgroup2UnifiedMode() && c.intelRdtManager == nil
+		extra = append(extra, &Boolmsg{
+			Type:  CgroupnsNoSyncAttr,
+			Value: cgroupnsNoSync,
+		})
+	}
+
+	data, err := c.bootstrapData(c.config.Namespaces.CloneFlags(), nsMaps, extra...)
 	if err != nil {
 		return nil, err
 	}
@@ -654,41 +747,363 @@ func (c *linuxContainer) newInitProcess(p *Process, cmd *exec.Cmd, messageSockPa
 		process:         p,
 		bootstrapData:   data,
 		sharePidns:      sharePidns,
+		cgroupnsNoSync:  cgroupnsNoSync,
 	}
 	c.initProcess = init
 	return init, nil
 }
 
 func (c *linuxContainer) newSetnsProcess(p *Process, cmd *exec.Cmd, messageSockPair, logFilePair filePair) (*setnsProcess, error) {
-	cmd.Env = append(cmd.Env, "_LIBCONTAINER_INITTYPE="+string(initSetns))
 	state, err := c.currentState()
 	if err != nil {
 		return nil, newSystemErrorWithCause(err, "getting container's current state")
 	}
-	// for setns process, we don't have to set cloneflags as the process namespaces
-	// will only be set via setns syscall
-	data, err := c.bootstrapData(0, state.NamespacePaths)
+	bs, err := c.newSetnsBootstrap(cmd, state)
 	if err != nil {
 		return nil, err
 	}
-	// sysbox-runc: setns processes enter the child cgroup (i.e., the system
-	// container's cgroup root); this way they can't change the cgroup resources
-	// assigned to the system container itself.
+	config := c.newInitConfig(p)
+	c.compileSeccomp(config)
 	return &setnsProcess{
 		cmd:             cmd,
-		cgroupPaths:     c.cgroupManager.GetChildCgroupPaths(),
+		cgroupPaths:     bs.cgroupPaths,
 		rootlessCgroups: c.config.RootlessCgroups,
 		intelRdtPath:    state.IntelRdtPath,
 		messageSockPair: messageSockPair,
 		logFilePair:     logFilePair,
-		config:          c.newInitConfig(p),
+		config:          config,
 		process:         p,
-		bootstrapData:   data,
+		bootstrapData:   bs.data,
 		initProcessPid:  state.InitProcessPid,
 		container:       c,
+		bootstrapFiles:  bs.files,
+	}, nil
+}
+
+// sysbox-runc: setnsBootstrap is the nsexec bootstrap of the processes that
+// join the container (one, or a batch of them).
+type setnsBootstrap struct {
+	cgroupPaths map[string]string
+	data        []byte
+	// The files passed on to nsexec (in cmd's ExtraFiles), to be closed once
+	// it's done with them.
+	files []*os.File
+}
+
+// newSetnsBootstrap sets up cmd to join the container in the given state, and
+// returns its bootstrap data (which includes the given extra data).
+func (c *linuxContainer) newSetnsBootstrap(cmd *exec.Cmd, state *State, extra ...nl.NetlinkRequestData) (*setnsBootstrap, error) {
+	cmd.Env = append(cmd.Env, "_LIBCONTAINER_INITTYPE="+string(initSetns))
+
+	// sysbox-runc: setns processes enter the child cgroup (i.e., the system
+	// container's cgroup root); this way they can't change the cgroup resources
+	// assigned to the system container itself.
+	bs := &setnsBootstrap{cgroupPaths: c.cgroupManager.GetChildCgroupPaths()}
+
+	// sysbox-runc: on cgroup v2, ask nsexec to create the process directly in
+	// that cgroup (via clone3's CLONE_INTO_CGROUP) rather than having us move
+	// it there once it's running. If the kernel can't do that, nsexec falls
+	// back to the regular clone and we move the process as usual.
+	if f := openCgroupForClone(bs.cgroupPaths); f != nil {
+		cmd.ExtraFiles = append(cmd.ExtraFiles, f)
+		bs.files = append(bs.files, f)
+		extra = append(extra, &Int32msg{
+			Type:  CgroupFdAttr,
+			Value: uint32(stdioFdCount + len(cmd.ExtraFiles) - 1),
+		})
+	}
+
+	// sysbox-runc: let nsexec join all of the init's namespaces with a single
+	// setns(2) on a pidfd, rather than one per namespace path. It falls back to
+	// the paths if the kernel can't do that.
+	if f := c.openInitPidfd(state); f != nil {
+		cmd.ExtraFiles = append(cmd.ExtraFiles, f)
+		bs.files = append(bs.files, f)
+		extra = append(extra, &Int32msg{
+			Type:  NsPidfdAttr,
+			Value: uint32(stdioFdCount + len(cmd.ExtraFiles) - 1),
+		})
+	}
+
+	// for setns process, we don't have to set cloneflags as the process namespaces
+	// will only be set via setns syscall
+	data, err := c.execBootstrapData(state, extra...)
+	if err != nil {
+		for _, f := range bs.files {
+			f.Close()
+		}
+		return nil, err
+	}
+	bs.data = data
+	return bs, nil
+}
+
+// newBatchSetnsProcess sets up the nsexec bootstrap of a batch exec. nsexec
+// gets the init pipe and stdio of each of the processes, as ExtraFiles, and
+// hands them to the child it forks for the process (see BATCH_FDS_ATTR).
+func (c *linuxContainer) newBatchSetnsProcess(processes []*Process) (_ *batchSetnsProcess, retErr error) {
+	var files []*os.File
+	defer func() {
+		if retErr != nil {
+			for _, f := range files {
+				f.Close()
+			}
+		}
+	}()
+
+	parentInitPipe, childInitPipe, err := utils.NewSockPair("init")
+	if err != nil {
+		return nil, newSystemErrorWithCause(err, "creating new init pipe")
+	}
+	files = append(files, parentInitPipe, childInitPipe)
+	messageSockPair := filePair{parentInitPipe, childInitPipe}
+
+	parentLogPipe, childLogPipe, err := os.Pipe()
+	if err != nil {
+		return nil, fmt.Errorf("Unable to create the log pipe:  %s", err)
+	}
+	files = append(files, parentLogPipe, childLogPipe)
+	logFilePair := filePair{parentLogPipe, childLogPipe}
+
+	cmd := c.commandTemplate(&Process{LogLevel: processes[0].LogLevel}, childInitPipe, childLogPipe)
+
+	var (
+		procs    []*setnsProcess
+		procFds  []string
+		devNull  *os.File
+		extraFds = func(fs ...*os.File) []string {
+			var fds []string
+			for _, f := range fs {
+				cmd.ExtraFiles = append(cmd.ExtraFiles, f)
+				fds = append(fds, strconv.Itoa(stdioFdCount+len(cmd.ExtraFiles)-1))
+			}
+			return fds
+		}
+	)
+	for _, p := range processes {
+		stdio := []*os.File{}
+		for _, s := range []interface{}{p.Stdin, p.Stdout, p.Stderr} {
+			f, ok := s.(*os.File)
+			if s != nil && !ok {
+				return nil, newGenericError(errors.New("the stdio of batch processes must be files"), ConfigInvalid)
+			}
+			if f == nil {
+				if devNull == nil {
+					if devNull, err = os.OpenFile(os.DevNull, os.O_RDWR, 0); err != nil {
+						return nil, err
+					}
+					files = append(files, devNull)
+				}
+				f = devNull
+			}
+			stdio = append(stdio, f)
+		}
+
+		parentPipe, childPipe, err := utils.NewSockPair("init")
+		if err != nil {
+			return nil, newSystemErrorWithCause(err, "creating new init pipe")
+		}
+		files = append(files, parentPipe, childPipe)
+
+		procFds = append(procFds, strings.Join(extraFds(append([]*os.File{childPipe}, stdio...)...), ":"))
+		config := c.newInitConfig(p)
+		c.compileSeccomp(config)
+		procs = append(procs, &setnsProcess{
+			cmd:             &exec.Cmd{},
+			messageSockPair: filePair{parentPipe, childPipe},
+			config:          config,
+			process:         p,
+			container:       c,
+		})
+	}
+
+	state, err := c.currentState()
+	if err != nil {
+		return nil, newSystemErrorWithCause(err, "getting container's current state")
+	}
+	bs, err := c.newSetnsBootstrap(cmd, state, &Bytemsg{
+		Type:  BatchFdsAttr,
+		Value: []byte(strings.Join(procFds, ",")),
+	})
+	if err != nil {
+		return nil, err
+	}
+	for _, p := range procs {
+		p.cgroupPaths = bs.cgroupPaths
+		p.rootlessCgroups = c.config.RootlessCgroups
+		p.intelRdtPath = state.IntelRdtPath
+		p.initProcessPid = state.InitProcessPid
+	}
+	if devNull != nil {
+		bs.files = append(bs.files, devNull)
+	}
+
+	return &batchSetnsProcess{
+		cmd:             cmd,
+		messageSockPair: messageSockPair,
+		logFilePair:     logFilePair,
+		bootstrapData:   bs.data,
+		bootstrapFiles:  bs.files,
+		procs:           procs,
 	}, nil
 }
 
+// openInitPidfd returns a pidfd for the container's init, for nsexec to join
+// its namespaces through. This is only done if all of the namespaces exec
+// joins are the init's own (i.e., none of them is configured with a path, in
+// which case the path is joined instead). Returns nil if a pidfd can't be used.
+func (c *linuxContainer) openInitPidfd(state *State) *os.File {
+	for _, ns := range c.config.Namespaces {
+		if ns.Path != "" {
+			return nil
+		}
+	}
+	pid := state.InitProcessPid
+	fd, err := unix.PidfdOpen(pid, 0)
+	if err != nil {
+		logrus.Debugf("unable to open pidfd for init %d: %v", pid, err)
+		return nil
+	}
+	// Make sure the pid hasn't been recycled since we got the state; with the
+	// pidfd held, it can't be from now on.
+	if stat, err := system.Stat(pid); err != nil || stat.StartTime != state.InitProcessStartTime {
+		unix.Close(fd)
+		return nil
+	}
+	return os.NewFile(uintptr(fd), "pidfd")
+}
+
+// openCgroupForClone opens the cgroup v2 directory among the given cgroup
+// paths, for nsexec to clone a process into. Returns nil if there's none (or
+// it can't be opened).
+func openCgroupForClone(cgroupPaths map[string]string) *os.File {
+	if !cgroups.IsCgroup2UnifiedMode() {
+		return nil
+	}
+	path, ok := cgroupPaths[""]
+	if !ok || path == "" {
+		return nil
+	}
+	fd, err := unix.Open(path, unix.O_DIRECTORY|unix.O_RDONLY|unix.O_CLOEXEC, 0)
+	if err != nil {
+		logrus.Debugf("unable to open cgroup %s for clone: %v", path, err)
+		return nil
+	}
+	return os.NewFile(uintptr(fd), path)
+}
+
+// sysbox-runc: useSharedBinary sets up cmd to make use of the read-only view of
+// our binary that nsexec shares across invocations (see shared_binary() in
+// nsenter/cloned_binary.c). Once that view has been published, cmd executes it
+// directly, which tells nsexec it's already running from a cloned binary and
+// thus saves it the re-exec (and the reading of its cmdline & environment that
+// comes with it).
+func (c *linuxContainer) useSharedBinary(cmd *exec.Cmd) {
+	if c.sharedBinDir == "" {
+		return
+	}
+	cmd.Env = append(cmd.Env, "_LIBCONTAINER_SHARED_BINARY_DIR="+c.sharedBinDir)
+
+	if c.initPath != "/proc/self/exe" {
+		return
+	}
+	if path := sharedBinaryPath(c.sharedBinDir); path != "" {
+		cmd.Path = path
+		cmd.Env = append(cmd.Env, clonedBinaryEnv)
+	}
+}
+
+// sysbox-runc: the name prefix of the shared views of our binary, and the
+// environment telling nsexec it's running from one (see nsenter/cloned_binary.c).
+const (
+	sharedBinaryPrefix = ".runc-cloned."
+	clonedBinaryEnv    = "_LIBCONTAINER_CLONED_BINARY=1"
+)
+
+// sysbox-runc: sharedBinaryPath returns the path of the shared read-only view
+// of our binary under dir, or "" if it has not been published (yet).
+func sharedBinaryPath(dir string) string {
+	var self unix.Stat_t
+
+	if err := unix.Stat("/proc/self/exe", &self); err != nil {
+		return ""
+	}
+	path := filepath.Join(dir, fmt.Sprintf(sharedBinaryPrefix+"%x-%x-%x-%x.%x",
+		self.Dev, self.Ino, self.Size, self.Mtim.Sec, self.Mtim.Nsec))
+
+	fd, err := openSharedBinary(path, 0)
+	if err != nil {
+		return ""
+	}
+	unix.Close(fd)
+	return path
+}
+
+// sysbox-runc: openSharedBinary opens the shared view of our binary at path,
+// as an O_PATH handle numbered minFd or above. As in open_shared_binary()
+// (nsenter/cloned_binary.c), the view is only accepted if it's on a read-only
+// mount and refers to our own binary.
+func openSharedBinary(path string, minFd int) (int, error) {
+	var self, st unix.Stat_t
+	var fs unix.Statfs_t
+
+	if err := unix.Stat("/proc/self/exe", &self); err != nil {
+		return -1, err
+	}
+	fd, err := unix.Open(path, unix.O_PATH|unix.O_CLOEXEC|unix.O_NOFOLLOW, 0)
+	if err != nil {
+		return -1, err
+	}
+	if minFd > fd {
+		newFd, err := unix.FcntlInt(uintptr(fd), unix.F_DUPFD_CLOEXEC, minFd)
+		unix.Close(fd)
+		if err != nil {
+			return -1, err
+		}
+		fd = newFd
+	}
+	if err := unix.Fstat(fd, &st); err != nil || st.Dev != self.Dev || st.Ino != self.Ino {
+		unix.Close(fd)
+		return -1, fmt.Errorf("%s is not our binary", path)
+	}
+	if err := unix.Fstatfs(fd, &fs); err != nil || fs.Flags&unix.ST_RDONLY == 0 {
+		unix.Close(fd)
+		return -1, fmt.Errorf("%s is not on a read-only mount", path)
+	}
+	return fd, nil
+}
+
+// sysbox-runc: startCmd starts cmd, which useSharedBinary() may have set up to
+// run the shared view of our binary. The view can be dropped (or replaced)
+// after useSharedBinary() checked it, so it's opened (and checked again) here
+// and executed through that handle; if that fails, cmd runs our binary
+// instead, which nsexec then clones as usual.
+func startCmd(cmd *exec.Cmd) error {
+	if !strings.HasPrefix(filepath.Base(cmd.Path), sharedBinaryPrefix) {
+		return cmd.Start()
+	}
+
+	// The child moves its fds into place (0 to 2+len(ExtraFiles)) before it
+	// execs, possibly through as many temporary ones above them; the handle
+	// must be clear of all of them.
+	fd, err := openSharedBinary(cmd.Path, 2*(stdioFdCount+len(cmd.ExtraFiles)))
+	if err != nil {
+		logrus.Debugf("not using the shared binary: %v", err)
+		cmd.Path = "/proc/self/exe"
+		env := cmd.Env[:0]
+		for _, e := range cmd.Env {
+			if e != clonedBinaryEnv {
+				env = append(env, e)
+			}
+		}
+		cmd.Env = env
+		return cmd.Start()
+	}
+	defer unix.Close(fd)
+	cmd.Path = "/proc/self/fd/" + strconv.Itoa(fd)
+	return cmd.Start()
+}
+
 // sysbox-runc: create a new helper process command to perform rootfs mount initialization
 func (c *linuxContainer) initHelperCmdTemplate(p *Process, childInitPipe, childLogPipe *os.File) *exec.Cmd {
 	cmd := exec.Command(c.initPath, c.initArgs[1:]...)
@@ -701,7 +1116,7 @@ func (c *linuxContainer) initHelperCmdTemplate(p *Process, childInitPipe, childL
 		cmd.SysProcAttr = &unix.SysProcAttr{}
 	}
 	cmd.ExtraFiles = append(cmd.ExtraFiles, childInitPipe)
-	cmd.Env = append(cmd.Env, "GOMAXPROCS="+os.Getenv("GOMAXPROCS"))
+	cmd.Env = append(cmd.Env, initRuntimeEnv()...)
 	cmd.Env = append(cmd.Env, "_LIBCONTAINER_INITTYPE="+string(initMount))
 	cmd.Env = append(cmd.Env,
 		"_LIBCONTAINER_INITPIPE="+strconv.Itoa(stdioFdCount+len(cmd.ExtraFiles)-1),
@@ -712,6 +1127,7 @@ func (c *linuxContainer) initHelperCmdTemplate(p *Process, childInitPipe, childL
 		"_LIBCONTAINER_LOGPIPE="+strconv.Itoa(stdioFdCount+len(cmd.ExtraFiles)-1),
 		"_LIBCONTAINER_LOGLEVEL="+p.LogLevel,
 	)
+	c.useSharedBinary(cmd)
 	return cmd
 }
 
@@ -732,6 +1148,7 @@ func (c *linuxContainer) newInitConfig(process *Process) *initConfig {
 		AppArmorProfile:  c.config.AppArmorProfile,
 		ProcessLabel:     c.config.ProcessLabel,
 		Rlimits:          c.config.Rlimits,
+		Placement:        getCallerPlacement(c.config),
 	}
 	if process.NoNewPrivileges != nil {
 		cfg.NoNewPrivileges = *process.NoNewPrivileges
@@ -751,6 +1168,35 @@ func (c *linuxContainer) newInitConfig(process *Process) *initConfig {
 	return cfg
 }
 
+// sysbox-runc: compileSeccomp sets the compiled programs of the container's
+// seccomp filters in cfg (see seccompProgram()).
+func (c *linuxContainer) compileSeccomp(cfg *initConfig) {
+	cfg.SeccompBPF = c.seccompProgram(c.config.Seccomp)
+	if c.config.SeccompNotif != nil && len(c.config.SeccompNotif.Syscalls) > 0 {
+		cfg.SeccompNotifBPF = c.seccompProgram(c.config.SeccompNotif)
+	}
+}
+
+// sysbox-runc: seccompCacheDir is the directory, in the root dir of all the
+// containers, where the compiled seccomp filters are cached.
+const seccompCacheDir = "seccomp"
+
+// seccompProgram returns the compiled program of the seccomp filter for config
+// (from the cache, shared by all containers, if it was compiled before), or nil
+// if it can't be compiled here, in which case the init will compile the filter
+// itself.
+func (c *linuxContainer) seccompProgram(config *configs.Seccomp) []byte {
+	if config == nil {
+		return nil
+	}
+	prog, err := seccomp.CompileCached(config, filepath.Join(filepath.Dir(c.root), seccompCacheDir))
+	if err != nil {
+		logrus.Debugf("unable to compile seccomp filter: %v", err)
+		return nil
+	}
+	return prog
+}
+
 func (c *linuxContainer) Destroy() error {
 	var err error
 
@@ -821,9 +1267,15 @@ func (c *linuxContainer) Pause() error {
 			}
 		}
 
-		return c.state.transition(&pausedState{
+		if err := c.state.transition(&pausedState{
 			c: c,
-		})
+		}); err != nil {
+			return err
+		}
+		if s, err := c.currentState(); err == nil {
+			c.indexState(s, Paused)
+		}
+		return nil
 	}
 	return newGenericError(fmt.Errorf("container not running or created: %s", status), ContainerNotRunning)
 }
@@ -854,9 +1306,15 @@ func (c *linuxContainer) Resume() error {
 	if err := c.cgroupManager.Freeze(configs.Thawed); err != nil {
 		return err
 	}
-	return c.state.transition(&runningState{
+	if err := c.state.transition(&runningState{
 		c: c,
-	})
+	}); err != nil {
+		return err
+	}
+	if s, err := c.currentState(); err == nil {
+		c.indexState(s, Running)
+	}
+	return nil
 }
 
 func (c *linuxContainer) NotifyOOM() (<-chan struct{}, error) {
@@ -871,6 +1329,23 @@ func (c *linuxContainer) NotifyOOM() (<-chan struct{}, error) {
 	return notifyOnOOM(path)
 }
 
+func (c *linuxContainer) NotifyStats(interval time.Duration) (<-chan *Stats, error) {
+	if !cgroups.IsCgroup2UnifiedMode() {
+		return nil, errors.New("stats notifications require cgroup v2")
+	}
+	if interval <= 0 {
+		return nil, errors.New("stats interval must be greater than 0")
+	}
+	path := c.cgroupManager.Path("")
+	reader, err := fs2.NewStatsReader(path, c.config.RootlessCgroups)
+	if err != nil {
+		return nil, newSystemErrorWithCause(err, "getting container stats from cgroups")
+	}
+	return notifyOnStatsV2(path, interval, reader, func() (*Stats, error) {
+		return c.stats(reader.GetStats)
+	})
+}
+
 func (c *linuxContainer) NotifyMemoryPressure(level PressureLevel) (<-chan struct{}, error) {
 	// XXX(cyphar): This requires cgroups.
 	if c.config.RootlessCgroups {
@@ -1449,7 +1924,7 @@ func (c *linuxContainer) prepareCriuRestoreMounts(mounts []*configs.Mount) error
 	return nil
 }
 
-func (c *linuxContainer) Restore(process *Process, criuOpts *CriuOpts) error {
+func (c *linuxContainer) Restore(process *Process, criuOpts *CriuOpts) (retErr error) {
 	c.m.Lock()
 	defer c.m.Unlock()
 
@@ -1580,6 +2055,33 @@ func (c *linuxContainer) Restore(process *Process, criuOpts *CriuOpts) error {
 		req.Opts.ManageCgroupsMode = &mode
 	}
 
+	if criuOpts.LazyPages {
+		// lazy restore requested; check if criu supports it
+		feat := criurpc.CriuFeatures{
+			LazyPages: proto.Bool(true),
+		}
+		if err := c.checkCriuFeatures(criuOpts, req.Opts, &feat); err != nil {
+			return err
+		}
+
+		// sysbox-runc: with a page server (i.e., where the container was
+		// checkpointed with --lazy-pages), start the lazy-pages daemon that
+		// gets the pages from it as the restored processes fault them in.
+		if criuOpts.PageServer.Address != "" && criuOpts.PageServer.Port != 0 {
+			stop, err := c.startCriuLazyPages(criuOpts)
+			if err != nil {
+				return err
+			}
+			// Without a restore to serve, the daemon would stay connected
+			// to the page server for good.
+			defer func() {
+				if retErr != nil {
+					stop()
+				}
+			}()
+		}
+	}
+
 	var (
 		fds    []string
 		fdJSON []byte
@@ -1609,6 +2111,66 @@ func (c *linuxContainer) Restore(process *Process, criuOpts *CriuOpts) error {
 	return err
 }
 
+// sysbox-runc: lazyPagesSocket is the socket, in the criu work directory, on
+// which the lazy-pages daemon serves the restore.
+const lazyPagesSocket = "lazy-pages.socket"
+
+// startCriuLazyPages starts the criu lazy-pages daemon for a lazy restore with
+// the given options, getting the pages from the page server in them, and
+// waits until it's ready for the restore. The daemon exits once it has
+// transferred all the pages; the returned function kills (and reaps) it
+// before that, if the restore fails.
+func (c *linuxContainer) startCriuLazyPages(criuOpts *CriuOpts) (func(), error) {
+	sock := filepath.Join(criuOpts.WorkDirectory, lazyPagesSocket)
+	if err := os.Remove(sock); err != nil && !os.IsNotExist(err) {
+		return nil, err
+	}
+
+	cmd := exec.Command(c.criuPath, "lazy-pages",
+		"--page-server",
+		"--address", criuOpts.PageServer.Address,
+		"--port", strconv.Itoa(int(criuOpts.PageServer.Port)),
+		"--images-dir", criuOpts.ImagesDirectory,
+		"--work-dir", criuOpts.WorkDirectory,
+		"--log-file", "lazy-pages.log",
+		"-v4")
+	// The daemon outlives the restore (and, when detached, sysbox-runc).
+	cmd.SysProcAttr = &unix.SysProcAttr{Setsid: true}
+	if err := cmd.Start(); err != nil {
+		return nil, newSystemErrorWithCause(err, "starting criu lazy-pages")
+	}
+
+	// The daemon is reaped here, or by stop().
+	exited := make(chan error, 1)
+	go func() {
+		exited <- cmd.Wait()
+	}()
+	stop := func() {
+		cmd.Process.Kill()
+		if err := <-exited; err != nil {
+			logrus.Debugf("criu lazy-pages (pid %d) stopped: %v", cmd.Process.Pid, err)
+		}
+	}
+
+	timeout := time.After(10 * time.Second)
+	for {
+		if _, err := os.Stat(sock); err == nil {
+			logrus.Debugf("criu lazy-pages (pid %d) ready, getting pages from %s:%d",
+				cmd.Process.Pid, criuOpts.PageServer.Address, criuOpts.PageServer.Port)
+			return stop, nil
+		}
+		select {
+		case err := <-exited:
+			return nil, fmt.Errorf("criu lazy-pages exited (%v); see %s",
+				err, filepath.Join(criuOpts.WorkDirectory, "lazy-pages.log"))
+		case <-timeout:
+			stop()
+			return nil, errors.New("timed out waiting for criu lazy-pages to start")
+		case <-time.After(10 * time.Millisecond):
+		}
+	}
+}
+
 func (c *linuxContainer) criuApplyCgroups(pid int, req *criurpc.CriuReq) error {
 	// need to apply cgroups only on restore
 	if req.GetType() != criurpc.CriuReqType_RESTORE {
@@ -1895,6 +2457,12 @@ func (c *linuxContainer) criuNotifications(resp *criurpc.CriuResp, process *Proc
 			return err
 		}
 	case "setup-namespaces":
+		// sysbox-runc: register the restored container with sysbox-fs before its
+		// processes resume (with lazy pages, while their memory is still being
+		// faulted in).
+		if err := c.registerWithSysboxfs(int(notify.GetPid())); err != nil {
+			return err
+		}
 		if c.config.Hooks != nil {
 			s, err := c.currentOCIState()
 			if err != nil {
@@ -1934,6 +2502,11 @@ func (c *linuxContainer) criuNotifications(resp *criurpc.CriuResp, process *Proc
 		if _, err := c.updateState(r); err != nil {
 			return err
 		}
+		if c.sysFs.Enabled() {
+			if err := c.sysFs.SendCreationTime(c.created); err != nil {
+				return newSystemErrorWithCause(err, "sending creation timestamp to sysbox-fs")
+			}
+		}
 		if err := os.Remove(filepath.Join(c.root, "checkpoint")); err != nil {
 			if !os.IsNotExist(err) {
 				logrus.Error(err)
@@ -2008,7 +2581,11 @@ func (c *linuxContainer) saveState(s *State) (retErr error) {
 	}
 
 	stateFilePath := filepath.Join(c.root, stateFilename)
-	return os.Rename(tmpFile.Name(), stateFilePath)
+	if err := os.Rename(tmpFile.Name(), stateFilePath); err != nil {
+		return err
+	}
+	c.indexState(s, c.state.status())
+	return nil
 }
 
 func (c *linuxContainer) currentStatus() (Status, error) {
@@ -2182,13 +2759,34 @@ func encodeIDMapping(idMap []configs.IDMap) ([]byte, error) {
 	return data.Bytes(), nil
 }
 
-// bootstrapData encodes the necessary data in netlink binary format
-// as a io.Reader.
+// bootstrapData encodes the necessary data in netlink binary format.
 // Consumer can write the data to a bootstrap program
 // such as one that uses nsenter package to bootstrap the container's
 // init process correctly, i.e. with correct namespaces, uid/gid
 // mapping etc.
-func (c *linuxContainer) bootstrapData(cloneFlags uintptr, nsMaps map[configs.NamespaceType]string) (io.Reader, error) {
+// bootstrapData returns the netlink message nsexec is bootstrapped with. Any
+// extra (process specific) attributes are appended to the common ones.
+func (c *linuxContainer) bootstrapData(cloneFlags uintptr, nsMaps map[configs.NamespaceType]string, extra ...nl.NetlinkRequestData) ([]byte, error) {
+	r, err := c.bootstrapRequest(cloneFlags, nsMaps)
+	if err != nil {
+		return nil, err
+	}
+	oomScoreAdj, err := c.oomScoreAdjData()
+	if err != nil {
+		return nil, err
+	}
+	r.AddData(oomScoreAdj)
+	for _, d := range append(c.placementData(), extra...) {
+		r.AddData(d)
+	}
+	return r.Serialize(), nil
+}
+
+// bootstrapRequest returns the netlink message nsexec is bootstrapped with,
+// save for the oom score adjustment (see oomScoreAdjData()) and the process
+// specific attributes. It only depends on the container's config and on the
+// given namespaces, so for exec it is cached (see execBootstrapData()).
+func (c *linuxContainer) bootstrapRequest(cloneFlags uintptr, nsMaps map[configs.NamespaceType]string) (*nl.NetlinkRequest, error) {
 	// create the netlink message
 	r := nl.NewNetlinkRequest(int(InitMsg), 0)
 
@@ -2256,50 +2854,6 @@ func (c *linuxContainer) bootstrapData(cloneFlags uintptr, nsMaps map[configs.Na
 		}
 	}
 
-	if c.config.OomScoreAdj != nil {
-		// write the configured oom_score_adj
-		r.AddData(&Bytemsg{
-			Type:  OomScoreAdjAttr,
-			Value: []byte(strconv.Itoa(*c.config.OomScoreAdj)),
-		})
-	} else {
-		// Pass sysbox's oom_score_adj explicitly to nsenter; this is needed because nsenter
-		// initially sets the oom_score_adj to -999 and later reverts it to the given value
-		// (so as to allow child processes to set -999 if desired).  By passing it here, we
-		// honor the OCI spec: "If oomScoreAdj is not set, the runtime MUST NOT change the
-		// value of oom_score_adj."
-		var err error
-
-		f, err := os.Open("/proc/self/oom_score_adj")
-		if err != nil {
-			return nil, err
-		}
-		defer f.Close()
-
-		str, err := bufio.NewReader(f).ReadString('\n')
-		if err != nil {
-			return nil, err
-		}
-
-		str = strings.Trim(str, "\n")
-
-		selfOomScoreAdj, err := strconv.Atoi(str)
-		if err != nil {
-			return nil, err
-		}
-
-		// For sys containers we don't allow -1000 for the OOM score value, as this
-		// is not supported from within a user-ns.
-		if selfOomScoreAdj < -999 {
-			selfOomScoreAdj = -999
-		}
-
-		r.AddData(&Bytemsg{
-			Type:  OomScoreAdjAttr,
-			Value: []byte(strconv.Itoa(selfOomScoreAdj)),
-		})
-	}
-
 	// write rootless
 	r.AddData(&Boolmsg{
 		Type:  RootlessEUIDAttr,
@@ -2355,9 +2909,62 @@ func (c *linuxContainer) bootstrapData(cloneFlags uintptr, nsMaps map[configs.Na
 			Value: []byte(strings.Join(shiftfsMounts, ",")),
 		})
 
+		if len(c.config.IDMappedMounts) > 0 {
+			r.AddData(&Bytemsg{
+				Type:  IDMapMountsAttr,
+				Value: []byte(strings.Join(c.config.IDMappedMounts, ",")),
+			})
+		}
 	}
 
-	return bytes.NewReader(r.Serialize()), nil
+	return r, nil
+}
+
+// oomScoreAdjData returns the oom score adjustment attribute of the bootstrap
+// data. Unless it's configured, it's that of the caller (i.e., ours), so it
+// can't be cached along with the rest of the bootstrap data.
+func (c *linuxContainer) oomScoreAdjData() (nl.NetlinkRequestData, error) {
+	if c.config.OomScoreAdj != nil {
+		// write the configured oom_score_adj
+		return &Bytemsg{
+			Type:  OomScoreAdjAttr,
+			Value: []byte(strconv.Itoa(*c.config.OomScoreAdj)),
+		}, nil
+	}
+
+	// Pass sysbox's oom_score_adj explicitly to nsenter; this is needed because nsenter
+	// initially sets the oom_score_adj to -999 and later reverts it to the given value
+	// (so as to allow child processes to set -999 if desired).  By passing it here, we
+	// honor the OCI spec: "If oomScoreAdj is not set, the runtime MUST NOT change the
+	// value of oom_score_adj."
+	f, err := os.Open("/proc/self/oom_score_adj")
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	str, err := bufio.NewReader(f).ReadString('\n')
+	if err != nil {
+		return nil, err
+	}
+
+	str = strings.Trim(str, "\n")
+
+	selfOomScoreAdj, err := strconv.Atoi(str)
+	if err != nil {
+		return nil, err
+	}
+
+	// For sys containers we don't allow -1000 for the OOM score value, as this
+	// is not supported from within a user-ns.
+	if selfOomScoreAdj < -999 {
+		selfOomScoreAdj = -999
+	}
+
+	return &Bytemsg{
+		Type:  OomScoreAdjAttr,
+		Value: []byte(strconv.Itoa(selfOomScoreAdj)),
+	}, nil
 }
 
 // ignoreTerminateErrors returns nil if the given err matches an error known
@@ -2453,7 +3060,7 @@ func (c *linuxContainer) handleOp(op opReqType, childPid int, reqs []opReq) erro
 	// start the command (creates parent, child, and grandchild
 	// processes; the granchild enters the go-runtime in the desired
 	// namespaces).
-	err = cmd.Start()
+	err = startCmd(cmd)
 	childMsgPipe.Close()
 	childLogPipe.Close()
 	if err != nil {
@@ -2505,6 +3112,9 @@ func (c *linuxContainer) handleOp(op opReqType, childPid int, reqs []opReq) erro
 		cmd.Wait()
 		return newSystemErrorWithCause(err, "getting the initHelper pid from pipe")
 	}
+	if err := readNsexecTimings(decoder); err != nil {
+		return newSystemErrorWithCause(err, "reading the initHelper nsexec timings from pipe")
+	}
 
 	firstChildProcess, err := os.FindProcess(pid.PidFirstChild)
 	if err != nil {
@@ -2869,6 +3479,18 @@ func (c *linuxContainer) setupIDMappedMounts() error {
 		}
 		if idMapMountAllowed {
 			config.RootfsUidShiftType = sh.IDMappedMount
+
+			// A rootfs other than overlayfs is ID-mapped by nsexec, right after
+			// it sets up the container's user-ns mappings. Overlayfs requires its
+			// lower layers to be ID-mapped (and its upper layer chowned), so it's
+			// done by the init helper process instead (see rootfsIDMap).
+			fsName, err := libutils.GetFsName(config.Rootfs)
+			if err != nil {
+				return newSystemErrorWithCausef(err, "getting fs type of rootfs %s", config.Rootfs)
+			}
+			if fsName != "overlayfs" {
+				config.IDMappedMounts = []string{config.Rootfs}
+			}
 		}
 	}
 
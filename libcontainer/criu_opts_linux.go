@@ -22,7 +22,7 @@ type CriuOpts struct {
 	ShellJob                bool               // allow to dump and restore shell jobs
 	FileLocks               bool               // handle file locks, for safety
 	PreDump                 bool               // call criu predump to perform iterative checkpoint
-	PageServer              CriuPageServerInfo // allow to dump to criu page server
+	PageServer              CriuPageServerInfo // allow to dump to criu page server (or, on a lazy restore, to get pages from it)
 	VethPairs               []VethPairName     // pass the veth to criu when restore
 	ManageCgroupsMode       criu.CriuCgMode    // dump or restore cgroup mode
 	EmptyNs                 uint32             // don't c/r properties for namespace from this mask
@@ -5,6 +5,7 @@ package libcontainer
 import (
 	"encoding/json"
 	"fmt"
+	"io/ioutil"
 	"os"
 	"path/filepath"
 	"regexp"
@@ -24,6 +25,7 @@ import (
 
 	"github.com/opencontainers/runc/libsysbox/sysbox"
 	"github.com/pkg/errors"
+	"github.com/vishvananda/netlink/nl"
 
 	"golang.org/x/sys/unix"
 )
@@ -183,6 +185,18 @@ func CriuPath(criupath string) func(*LinuxFactory) error {
 	}
 }
 
+// SharedClonedBinary returns an option func that configures a LinuxFactory to
+// have the nsenter bootstrap re-exec from a single read-only view of the
+// binary that is published under the given directory and shared by all
+// invocations of the same binary version (rather than copying or bind-mounting
+// the binary on every container create and exec).
+func SharedClonedBinary(dir string) func(*LinuxFactory) error {
+	return func(l *LinuxFactory) error {
+		l.SharedClonedBinaryDir = dir
+		return nil
+	}
+}
+
 // SysFs returns an option func that configures a LinuxFactory to return containers that
 // use the given sysbox-fs for emulating parts of the container's rootfs.
 func SysFs(sysFs *sysbox.Fs) func(*LinuxFactory) error {
@@ -259,6 +273,10 @@ type LinuxFactory struct {
 	NewuidmapPath string
 	NewgidmapPath string
 
+	// SharedClonedBinaryDir is the directory under which the read-only view
+	// of the binary shared across invocations is published (empty if disabled).
+	SharedClonedBinaryDir string
+
 	// Validator provides validation to container configurations.
 	Validator validate.Validator
 
@@ -309,6 +327,7 @@ func (l *LinuxFactory) Create(id string, config *configs.Config) (Container, err
 		criuPath:      l.CriuPath,
 		newuidmapPath: l.NewuidmapPath,
 		newgidmapPath: l.NewgidmapPath,
+		sharedBinDir:  l.SharedClonedBinaryDir,
 		cgroupManager: l.NewCgroupsManager(config.Cgroups, nil),
 		sysMgr:        l.SysMgr,
 		sysFs:         l.SysFs,
@@ -351,6 +370,7 @@ func (l *LinuxFactory) Load(id string) (Container, error) {
 		criuPath:             l.CriuPath,
 		newuidmapPath:        l.NewuidmapPath,
 		newgidmapPath:        l.NewgidmapPath,
+		sharedBinDir:         l.SharedClonedBinaryDir,
 		cgroupManager:        l.NewCgroupsManager(state.Config.Cgroups, state.CgroupPaths),
 		root:                 containerRoot,
 		created:              state.Created,
@@ -374,6 +394,41 @@ func (l *LinuxFactory) Type() string {
 	return "libcontainer"
 }
 
+// sysbox-runc: the strategies nsexec uses to get a safe copy (or view) of our
+// binary, in the order of their counters in clonedBinaryStatsFile (see
+// clone_strategies in nsenter/cloned_binary.c).
+var clonedBinaryStrategies = []string{"memfd", "tmpfile", "mkostemp", "bindfd", "shared"}
+
+const clonedBinaryStatsFile = ".runc-clone-stats"
+
+// ClonedBinaryStats returns how many times nsexec used each of the cloned
+// binary strategies, for the containers under the factory's root. Only the
+// invocations logging at debug level are counted. A missing stats file (i.e.,
+// nsexec hasn't counted any yet) yields zero counters.
+func (l *LinuxFactory) ClonedBinaryStats() (map[string]uint64, error) {
+	stats := make(map[string]uint64, len(clonedBinaryStrategies))
+	for _, name := range clonedBinaryStrategies {
+		stats[name] = 0
+	}
+
+	data, err := ioutil.ReadFile(filepath.Join(l.Root, clonedBinaryStatsFile))
+	if err != nil {
+		if os.IsNotExist(err) {
+			return stats, nil
+		}
+		return nil, err
+	}
+
+	native := nl.NativeEndian()
+	for i, name := range clonedBinaryStrategies {
+		if len(data) < (i+1)*8 {
+			break
+		}
+		stats[name] = native.Uint64(data[i*8:])
+	}
+	return stats, nil
+}
+
 // StartInitialization loads a container by opening the pipe fd from the parent to read the configuration and state
 // This is a low level implementation detail of the reexec and should not be consumed externally
 func (l *LinuxFactory) StartInitialization() (err error) {
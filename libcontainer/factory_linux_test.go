@@ -13,6 +13,7 @@ import (
 	"github.com/opencontainers/runc/libcontainer/configs"
 	"github.com/opencontainers/runc/libcontainer/utils"
 	"github.com/opencontainers/runtime-spec/specs-go"
+	"github.com/vishvananda/netlink/nl"
 
 	"golang.org/x/sys/unix"
 )
@@ -228,3 +229,41 @@ type unserializableHook struct{}
 func (unserializableHook) Run(*specs.State) error {
 	return nil
 }
+
+func TestFactoryClonedBinaryStats(t *testing.T) {
+	root, rerr := newTestRoot()
+	if rerr != nil {
+		t.Fatal(rerr)
+	}
+	defer os.RemoveAll(root)
+	factory, err := New(root, Cgroupfs)
+	if err != nil {
+		t.Fatal(err)
+	}
+	lfactory := factory.(*LinuxFactory)
+
+	stats, err := lfactory.ClonedBinaryStats()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(stats) != len(clonedBinaryStrategies) || stats["memfd"] != 0 {
+		t.Fatalf("expected zero counters without a stats file, got %v", stats)
+	}
+
+	// Same layout as nsexec's count_strategy(): one native-endian uint64 per strategy.
+	data := make([]byte, 8*len(clonedBinaryStrategies))
+	native := nl.NativeEndian()
+	native.PutUint64(data[0:], 3)
+	native.PutUint64(data[4*8:], 42)
+	if err := ioutil.WriteFile(filepath.Join(root, clonedBinaryStatsFile), data, 0600); err != nil {
+		t.Fatal(err)
+	}
+
+	stats, err = lfactory.ClonedBinaryStats()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if stats["memfd"] != 3 || stats["shared"] != 42 || stats["bindfd"] != 0 {
+		t.Fatalf("unexpected counters %v", stats)
+	}
+}
@@ -21,6 +21,7 @@ import (
 	"github.com/opencontainers/runc/libcontainer/configs"
 	"github.com/opencontainers/runc/libcontainer/seccomp"
 	"github.com/opencontainers/runc/libcontainer/system"
+	"github.com/opencontainers/runc/libcontainer/usdt"
 	"github.com/opencontainers/runc/libcontainer/user"
 	"github.com/opencontainers/runc/libcontainer/utils"
 	"github.com/opencontainers/runtime-spec/specs-go"
@@ -40,6 +41,29 @@ const (
 type pid struct {
 	Pid           int `json:"pid"`
 	PidFirstChild int `json:"pid_first"`
+
+	// sysbox-runc: IntoCgroup is set when nsexec created the process directly
+	// in the cgroup passed via CgroupFdAttr.
+	IntoCgroup bool `json:"into_cgroup"`
+
+	// sysbox-runc: Pids are the pids of the processes of a batch exec (see
+	// StartBatch()), in the order they were asked for; Pid is the first one.
+	Pids []int `json:"pids,omitempty"`
+}
+
+// nsexecTiming is the time spent in one of the phases of the nsexec bootstrap
+// (see nsenter/nsexec.c). Start is relative to when nsexec was entered; both
+// Start and Duration are in nanoseconds.
+type nsexecTiming struct {
+	Stage    int    `json:"stage"`
+	Phase    string `json:"phase"`
+	Start    uint64 `json:"start"`
+	Duration uint64 `json:"duration"`
+}
+
+// nsexecTimings is sent by nsexec over the init pipe right after the pid.
+type nsexecTimings struct {
+	Timings []nsexecTiming `json:"timings"`
 }
 
 // network is an internal struct used to setup container networks.
@@ -73,6 +97,15 @@ type initConfig struct {
 	RootlessEUID     bool                  `json:"rootless_euid,omitempty"`
 	RootlessCgroups  bool                  `json:"rootless_cgroups,omitempty"`
 	SpecState        *specs.State          `json:"spec_state,omitempty"`
+
+	// sysbox-runc: the compiled programs of Config.Seccomp and
+	// Config.SeccompNotif, if the parent compiled them.
+	SeccompBPF      []byte `json:"seccomp_bpf,omitempty"`
+	SeccompNotifBPF []byte `json:"seccomp_notif_bpf,omitempty"`
+
+	// sysbox-runc: the caller's CPU affinity and memory policy, for the init
+	// to restore after nsexec's placement (see restorePlacement()).
+	Placement *callerPlacement `json:"placement,omitempty"`
 }
 
 type initer interface {
@@ -85,6 +118,7 @@ func newContainerInit(t initType, pipe *os.File, consoleSocket *os.File, fifoFd
 		if err := json.NewDecoder(pipe).Decode(&config); err != nil {
 			return nil, err
 		}
+		usdt.InitStart(string(t))
 		if err := populateProcessEnvironment(config.Env); err != nil {
 			return nil, err
 		}
@@ -109,6 +143,7 @@ func newContainerInit(t initType, pipe *os.File, consoleSocket *os.File, fifoFd
 		if err := json.NewDecoder(pipe).Decode(&reqs); err != nil {
 			return nil, err
 		}
+		usdt.InitStart(string(t))
 		return &linuxRootfsInit{
 			pipe: pipe,
 			reqs: reqs,
@@ -137,6 +172,8 @@ func populateProcessEnvironment(env []string) error {
 // and working dir, and closes any leaked file descriptors
 // before executing the command inside the namespace
 func finalizeNamespace(config *initConfig) error {
+	usdt.InitFinalize()
+
 	// Ensure that all unwanted fds we may have accidentally
 	// inherited are marked close-on-exec so they stay out of the
 	// container
@@ -620,13 +657,22 @@ func signalAllProcesses(m cgroups.Manager, s os.Signal) error {
 	return nil
 }
 
+// loadSeccomp loads the seccomp filter for config, from prog if the parent
+// passed us its compiled program (see linuxContainer.seccompProgram()).
+func loadSeccomp(config *configs.Seccomp, prog []byte) (int32, error) {
+	if len(prog) > 0 {
+		return seccomp.LoadSeccompBPF(prog, seccomp.HasNotify(config))
+	}
+	return seccomp.LoadSeccomp(config)
+}
+
 // setupSyscallTraps sets up syscall trapping for the calling process, using seccomp.
 func setupSyscallTraps(config *initConfig, pipe *os.File) error {
 
 	// Load the seccomp notification filter here (for syscall trapping inside the container)
 	if config.Config.SeccompNotif != nil && len(config.Config.SeccompNotif.Syscalls) > 0 {
 
-		fd, err := seccomp.LoadSeccomp(config.Config.SeccompNotif)
+		fd, err := loadSeccomp(config.Config.SeccompNotif, config.SeccompNotifBPF)
 		if err != nil {
 			return newSystemErrorWithCause(err, "loading seccomp notification rules")
 		}
@@ -0,0 +1,44 @@
+// +build linux
+
+package libcontainer
+
+import "os"
+
+// sysbox-runc: the Go runtime settings of the runc init (and of the other
+// processes we re-exec ourselves as, e.g., for exec). The init returns from
+// nsexec into a full Go runtime and sits in it until it execs the container's
+// process, which for a created container can be a long time; with thousands
+// of containers per host, the runtime's footprint adds up. The settings can
+// only be passed in the environment: by the time our own init() runs, the
+// runtime has already sized itself (e.g., one P per CPU) from it.
+//
+// A setting that's in the environment of sysbox-runc is passed on as is, so
+// that the defaults can be overridden. See docs/init-runtime.md.
+var initRuntimeDefaults = []struct {
+	name  string
+	value string
+}{
+	// The init is single threaded (see init.go); with one P the runtime
+	// doesn't allocate per-P caches and GC workers for each CPU.
+	{"GOMAXPROCS", "1"},
+	// GC target percentage; not set by default (i.e., the runtime's 100).
+	{"GOGC", ""},
+	// Soft memory limit (Go 1.19+); not set by default.
+	{"GOMEMLIMIT", ""},
+}
+
+// initRuntimeEnv returns the environment with the Go runtime settings of the
+// runc init.
+func initRuntimeEnv() []string {
+	var env []string
+	for _, d := range initRuntimeDefaults {
+		value, ok := os.LookupEnv(d.name)
+		if !ok {
+			value = d.value
+		}
+		if value != "" {
+			env = append(env, d.name+"="+value)
+		}
+	}
+	return env
+}
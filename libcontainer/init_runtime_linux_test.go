@@ -0,0 +1,41 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"os"
+	"reflect"
+	"testing"
+)
+
+func TestInitRuntimeEnv(t *testing.T) {
+	for _, d := range initRuntimeDefaults {
+		if value, ok := os.LookupEnv(d.name); ok {
+			defer os.Setenv(d.name, value)
+		} else {
+			defer os.Unsetenv(d.name)
+		}
+		os.Unsetenv(d.name)
+	}
+
+	expected := []string{"GOMAXPROCS=1"}
+	if env := initRuntimeEnv(); !reflect.DeepEqual(env, expected) {
+		t.Fatalf("expected %v, got %v", expected, env)
+	}
+
+	// Settings in our environment override the defaults.
+	os.Setenv("GOMAXPROCS", "4")
+	os.Setenv("GOGC", "50")
+	os.Setenv("GOMEMLIMIT", "16MiB")
+	expected = []string{"GOMAXPROCS=4", "GOGC=50", "GOMEMLIMIT=16MiB"}
+	if env := initRuntimeEnv(); !reflect.DeepEqual(env, expected) {
+		t.Fatalf("expected %v, got %v", expected, env)
+	}
+
+	// An empty setting gets the runtime's default.
+	os.Setenv("GOMAXPROCS", "")
+	expected = []string{"GOGC=50", "GOMEMLIMIT=16MiB"}
+	if env := initRuntimeEnv(); !reflect.DeepEqual(env, expected) {
+		t.Fatalf("expected %v, got %v", expected, env)
+	}
+}
@@ -28,6 +28,13 @@ const (
 	RootfsAttr         uint16 = 27293
 	ParentMountAttr    uint16 = 27294
 	ShiftfsMountsAttr  uint16 = 27295
+	CgroupFdAttr       uint16 = 27296
+	CgroupnsNoSyncAttr uint16 = 27297
+	NsPidfdAttr        uint16 = 27298
+	IDMapMountsAttr    uint16 = 27299
+	BatchFdsAttr       uint16 = 27300
+	CpusetCpusAttr     uint16 = 27301
+	CpusetMemsAttr     uint16 = 27302
 )
 
 type Int32msg struct {
@@ -0,0 +1,273 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"os"
+	"path/filepath"
+	"sync"
+	"time"
+	"unsafe"
+
+	"github.com/opencontainers/runc/libcontainer/configs"
+	libcontainerUtils "github.com/opencontainers/runc/libcontainer/utils"
+	"github.com/pkg/errors"
+	"github.com/sirupsen/logrus"
+
+	"golang.org/x/sys/unix"
+)
+
+// sysbox-runc: a mountPlan is the list of bind mounts requested of the rootfs
+// init helper, compiled ahead of time into the steps that set each of them up
+// with the new mount API (kernel 5.12+) rather than with mount(2): the source
+// tree is cloned as a detached mount (open_tree(2)), the mount's flags are set
+// on the detached tree (mount_setattr(2)), the tree is attached at the
+// destination in one move_mount(2), and its propagation is then changed with
+// mount_setattr(2), recursively if requested. That's one call per mount for
+// the flags (rather than a statfs and a remount), and none of the mount(2)
+// data parsing.
+//
+// Mounts the plan can't set up that way (e.g., the kernel lacks the API, or
+// open_tree(2) fails where mount(2) works, as it does for shiftfs on tmpfs)
+// fall back to doBindMount() and remount().
+type mountPlan struct {
+	rootfs string
+	steps  []*mountStep
+}
+
+type mountStep struct {
+	m      *configs.Mount
+	attr   unix.MountAttr // flags set on the detached tree
+	props  []mountProp    // propagation changes after the tree is attached
+	legacy bool           // set up with mount(2)
+	took   time.Duration
+}
+
+type mountProp struct {
+	propagation uint64
+	recursive   bool
+}
+
+// mount(2) flags and their mount_setattr(2) equivalents.
+var mountAttrFlags = []struct {
+	flag int
+	attr uint64
+}{
+	{unix.MS_RDONLY, unix.MOUNT_ATTR_RDONLY},
+	{unix.MS_NOSUID, unix.MOUNT_ATTR_NOSUID},
+	{unix.MS_NODEV, unix.MOUNT_ATTR_NODEV},
+	{unix.MS_NOEXEC, unix.MOUNT_ATTR_NOEXEC},
+	{unix.MS_NODIRATIME, unix.MOUNT_ATTR_NODIRATIME},
+}
+
+var mountAtimeFlags = []struct {
+	flag int
+	attr uint64
+}{
+	{unix.MS_NOATIME, unix.MOUNT_ATTR_NOATIME},
+	{unix.MS_STRICTATIME, unix.MOUNT_ATTR_STRICTATIME},
+	{unix.MS_RELATIME, unix.MOUNT_ATTR_RELATIME},
+}
+
+const mountPropFlags = unix.MS_SHARED | unix.MS_SLAVE | unix.MS_PRIVATE | unix.MS_UNBINDABLE
+
+var (
+	mountAPIOnce      sync.Once
+	mountAPISupported bool
+)
+
+// haveMountAPI returns true if the kernel supports mount_setattr(2) (and thus
+// open_tree(2) and move_mount(2), which are older).
+func haveMountAPI() bool {
+	mountAPIOnce.Do(func() {
+		err := unix.MountSetattr(-1, "", unix.AT_EMPTY_PATH, &unix.MountAttr{})
+		mountAPISupported = err != unix.ENOSYS
+	})
+	return mountAPISupported
+}
+
+// newMountPlan compiles the plan for the given bind mounts into rootfs.
+func newMountPlan(rootfs string, mounts []*configs.Mount) *mountPlan {
+	plan := &mountPlan{rootfs: rootfs}
+	api := haveMountAPI()
+	for _, m := range mounts {
+		step := compileMountStep(m)
+		if !api {
+			step.legacy = true
+		}
+		plan.steps = append(plan.steps, step)
+	}
+	return plan
+}
+
+func compileMountStep(m *configs.Mount) *mountStep {
+	step := &mountStep{m: m}
+
+	flags := m.Flags &^ (unix.MS_REC | unix.MS_REMOUNT | unix.MS_BIND)
+	for _, f := range mountAttrFlags {
+		if flags&f.flag != 0 {
+			step.attr.Attr_set |= f.attr
+			flags &^= f.flag
+		}
+	}
+	for _, f := range mountAtimeFlags {
+		if flags&f.flag != 0 {
+			step.attr.Attr_set = (step.attr.Attr_set &^ unix.MOUNT_ATTR__ATIME) | f.attr
+			step.attr.Attr_clr |= unix.MOUNT_ATTR__ATIME
+			flags &^= f.flag
+		}
+	}
+
+	for _, pflag := range m.PropagationFlags {
+		prop := uint64(pflag & mountPropFlags)
+		// mount_setattr(2) takes a single propagation type.
+		if prop == 0 || prop&(prop-1) != 0 || pflag&^(mountPropFlags|unix.MS_REC) != 0 {
+			step.legacy = true
+			break
+		}
+		step.props = append(step.props, mountProp{
+			propagation: prop,
+			recursive:   pflag&unix.MS_REC != 0,
+		})
+	}
+
+	// Flags with no mount_setattr(2) equivalent (e.g., MS_SYNCHRONOUS) are
+	// left to remount().
+	if flags != 0 {
+		step.legacy = true
+	}
+	return step
+}
+
+// setup sets up the bind mount of the step.
+func (s *mountStep) setup(rootfs string) error {
+	start := time.Now()
+	defer func() { s.took = time.Since(start) }()
+
+	if !s.legacy {
+		err := s.setupDetached(rootfs)
+		if err != errMountLegacy {
+			return err
+		}
+		s.legacy = true
+	}
+
+	m := s.m
+	if err := doBindMount(rootfs, m); err != nil {
+		return err
+	}
+	// The bind mount won't change mount options, we need remount to make mount options effective.
+	// first check that we have non-default options required before attempting a remount
+	if m.Flags&^(unix.MS_REC|unix.MS_REMOUNT|unix.MS_BIND) != 0 {
+		// only remount if unique mount options are set
+		if err := remount(m); err != nil {
+			return errors.Wrapf(err, "remount of %s with flags %#x", m.Destination, m.Flags)
+		}
+	}
+	return nil
+}
+
+// errMountLegacy is returned by setupDetached() when the mount is to be set up
+// with mount(2) instead; nothing was mounted then.
+var errMountLegacy = errors.New("mount to be set up with mount(2)")
+
+func (s *mountStep) setupDetached(rootfs string) error {
+	m := s.m
+
+	// See doBindMount() about the lstat of the source under shiftfs.
+	src := m.Source
+	if !m.BindSrcInfo.IsDir {
+		src = filepath.Dir(m.Source)
+	}
+	os.Lstat(src)
+
+	fd, err := openTree(unix.AT_FDCWD, m.Source, unix.OPEN_TREE_CLONE|unix.OPEN_TREE_CLOEXEC|unix.AT_RECURSIVE)
+	if err != nil {
+		logrus.Debugf("open_tree of %s failed (%v); bind mounting with mount(2)", m.Source, err)
+		return errMountLegacy
+	}
+	defer unix.Close(fd)
+
+	// As with remount() the flags are set on the top mount of the tree only,
+	// and the ones not set are kept.
+	if s.attr.Attr_set|s.attr.Attr_clr != 0 {
+		if err := unix.MountSetattr(fd, "", unix.AT_EMPTY_PATH, &s.attr); err != nil {
+			logrus.Debugf("mount_setattr of %s failed (%v); bind mounting with mount(2)", m.Source, err)
+			return errMountLegacy
+		}
+	}
+
+	// Attach with procfd to mitigate symlink exchange attacks.
+	if err := libcontainerUtils.WithProcfd(rootfs, m.Destination, func(procfd string) error {
+		return moveMount(fd, "", unix.AT_FDCWD, procfd, unix.MOVE_MOUNT_F_EMPTY_PATH)
+	}); err != nil {
+		return errors.Wrapf(err, "move_mount of %s -> %s", m.Source, m.Destination)
+	}
+
+	if len(s.props) == 0 {
+		return nil
+	}
+	if err := libcontainerUtils.WithProcfd(rootfs, m.Destination, func(procfd string) error {
+		for _, p := range s.props {
+			flags := uint(0)
+			if p.recursive {
+				flags |= unix.AT_RECURSIVE
+			}
+			if err := unix.MountSetattr(unix.AT_FDCWD, procfd, flags, &unix.MountAttr{Propagation: p.propagation}); err != nil {
+				return err
+			}
+		}
+		return nil
+	}); err != nil {
+		return errors.Wrap(err, "change bind mount propagation through procfd")
+	}
+	return nil
+}
+
+// report logs how long each mount of the plan took to set up.
+func (p *mountPlan) report() {
+	if !logrus.IsLevelEnabled(logrus.DebugLevel) {
+		return
+	}
+	var total time.Duration
+	legacy := 0
+	for _, s := range p.steps {
+		how := "move_mount"
+		if s.legacy {
+			how = "mount"
+			legacy++
+		}
+		logrus.Debugf("bind mount %s -> %s (%s): %v", s.m.Source, s.m.Destination, how, s.took)
+		total += s.took
+	}
+	logrus.Debugf("bind mounts: %d in %v (%d with mount(2))", len(p.steps), total, legacy)
+}
+
+func openTree(dirfd int, path string, flags uint) (int, error) {
+	p, err := unix.BytePtrFromString(path)
+	if err != nil {
+		return -1, err
+	}
+	fd, _, errno := unix.Syscall(unix.SYS_OPEN_TREE, uintptr(dirfd), uintptr(unsafe.Pointer(p)), uintptr(flags))
+	if errno != 0 {
+		return -1, errno
+	}
+	return int(fd), nil
+}
+
+func moveMount(fromDirfd int, fromPath string, toDirfd int, toPath string, flags uint) error {
+	from, err := unix.BytePtrFromString(fromPath)
+	if err != nil {
+		return err
+	}
+	to, err := unix.BytePtrFromString(toPath)
+	if err != nil {
+		return err
+	}
+	_, _, errno := unix.Syscall6(unix.SYS_MOVE_MOUNT, uintptr(fromDirfd), uintptr(unsafe.Pointer(from)),
+		uintptr(toDirfd), uintptr(unsafe.Pointer(to)), uintptr(flags), 0)
+	if errno != 0 {
+		return errno
+	}
+	return nil
+}
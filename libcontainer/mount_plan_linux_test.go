@@ -0,0 +1,45 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"testing"
+
+	"github.com/opencontainers/runc/libcontainer/configs"
+	"golang.org/x/sys/unix"
+)
+
+func TestCompileMountStep(t *testing.T) {
+	m := &configs.Mount{
+		Device:           "bind",
+		Source:           "/src",
+		Destination:      "/dst",
+		Flags:            unix.MS_BIND | unix.MS_REC | unix.MS_RDONLY | unix.MS_NOSUID | unix.MS_NOATIME,
+		PropagationFlags: []int{unix.MS_REC | unix.MS_SLAVE, unix.MS_PRIVATE},
+	}
+	step := compileMountStep(m)
+	if step.legacy {
+		t.Fatal("expected the mount to be set up with move_mount")
+	}
+	if set := uint64(unix.MOUNT_ATTR_RDONLY | unix.MOUNT_ATTR_NOSUID | unix.MOUNT_ATTR_NOATIME); step.attr.Attr_set != set {
+		t.Fatalf("expected attr_set %#x, got %#x", set, step.attr.Attr_set)
+	}
+	if step.attr.Attr_clr != unix.MOUNT_ATTR__ATIME {
+		t.Fatalf("expected attr_clr %#x, got %#x", unix.MOUNT_ATTR__ATIME, step.attr.Attr_clr)
+	}
+	expected := []mountProp{{unix.MS_SLAVE, true}, {unix.MS_PRIVATE, false}}
+	if len(step.props) != len(expected) {
+		t.Fatalf("expected propagation %v, got %v", expected, step.props)
+	}
+	for i := range expected {
+		if step.props[i] != expected[i] {
+			t.Fatalf("expected propagation %v, got %v", expected, step.props)
+		}
+	}
+
+	// Flags with no mount_setattr(2) equivalent need mount(2).
+	m.Flags |= unix.MS_SYNCHRONOUS
+	if step := compileMountStep(m); !step.legacy {
+		t.Fatal("expected the mount to be set up with mount(2)")
+	}
+}
@@ -7,8 +7,10 @@ import (
 	"path/filepath"
 	"strconv"
 	"strings"
+	"time"
 	"unsafe"
 
+	"github.com/opencontainers/runc/libcontainer/cgroups/fs2"
 	"github.com/pkg/errors"
 	"github.com/sirupsen/logrus"
 	"golang.org/x/sys/unix"
@@ -100,3 +102,97 @@ func registerMemoryEventV2(cgDir, evName, cgEvName string) (<-chan struct{}, err
 func notifyOnOOMV2(path string) (<-chan struct{}, error) {
 	return registerMemoryEventV2(path, "memory.events", "cgroup.events")
 }
+
+// sysbox-runc: notifyOnStatsV2 returns a channel on which the stats returned
+// by sample are sent, first right away and then each time the cgroup's
+// cgroup.events, memory.events or pids.events files are modified, or interval
+// has gone by since the previous sample. reader (which sample reads the cgroup's stats
+// through) is closed, and so is the channel, once the cgroup at cgDir has no
+// more processes.
+func notifyOnStatsV2(cgDir string, interval time.Duration, reader *fs2.StatsReader, sample func() (*Stats, error)) (<-chan *Stats, error) {
+	cgEvPath := filepath.Join(cgDir, "cgroup.events")
+	fd, err := unix.InotifyInit1(unix.IN_CLOEXEC)
+	if err != nil {
+		reader.Close()
+		return nil, errors.Wrap(err, "unable to init inotify")
+	}
+	cgFd, err := unix.InotifyAddWatch(fd, cgEvPath, unix.IN_MODIFY)
+	if err != nil {
+		unix.Close(fd)
+		reader.Close()
+		return nil, errors.Wrap(err, "unable to add inotify watch")
+	}
+	// These only exist if their controllers are enabled.
+	for _, name := range []string{"memory.events", "pids.events"} {
+		if _, err := unix.InotifyAddWatch(fd, filepath.Join(cgDir, name), unix.IN_MODIFY); err != nil && err != unix.ENOENT {
+			unix.Close(fd)
+			reader.Close()
+			return nil, errors.Wrap(err, "unable to add inotify watch")
+		}
+	}
+
+	// Events that come in while a sample is being taken (or sent) are
+	// coalesced into a single sample after it.
+	modified := make(chan struct{}, 1)
+	done := make(chan struct{})
+	go func() {
+		var buffer [unix.SizeofInotifyEvent + unix.PathMax + 1]byte
+
+		defer close(done)
+		for {
+			n, err := unix.Read(fd, buffer[:])
+			if err != nil {
+				logrus.Warnf("unable to read event data from inotify, got error: %v", err)
+				return
+			}
+			populated := true
+			for offset := 0; offset+unix.SizeofInotifyEvent <= n; {
+				rawEvent := (*unix.InotifyEvent)(unsafe.Pointer(&buffer[offset]))
+				offset += unix.SizeofInotifyEvent + int(rawEvent.Len)
+				if int(rawEvent.Wd) == cgFd {
+					pids, err := getValueFromCgroup(cgEvPath, "populated")
+					if err != nil || pids == 0 {
+						populated = false
+					}
+				}
+			}
+			if !populated {
+				return
+			}
+			select {
+			case modified <- struct{}{}:
+			default:
+			}
+		}
+	}()
+
+	ch := make(chan *Stats)
+	go func() {
+		ticker := time.NewTicker(interval)
+		defer func() {
+			ticker.Stop()
+			unix.Close(fd)
+			reader.Close()
+			close(ch)
+		}()
+
+		for {
+			if s, err := sample(); err != nil {
+				logrus.Error(err)
+			} else {
+				select {
+				case ch <- s:
+				case <-done:
+					return
+				}
+			}
+			select {
+			case <-modified:
+			case <-ticker.C:
+			case <-done:
+				return
+			}
+		}
+	}()
+	return ch, nil
+}
@@ -0,0 +1,372 @@
+/*
+ * Micro-benchmarks for the pieces of the nsenter bootstrap that can be timed
+ * in isolation: the binary cloning strategies and copy tiers of
+ * cloned_binary.c, nl_parse(), join_namespaces() and the forks of the bootstrap
+ * (a stage fork, and spawning a mapping tool). The end-to-end bootstrap
+ * (create to SYNC_CHILD_READY, and concurrent bootstraps) is benchmarked from
+ * Go, see nsenter_bench_test.go.
+ *
+ * Every benchmark prints one JSON object per line on stdout:
+ *
+ *	{"name": "clone/memfd", "iterations": 120, "ns_per_op": 8312345}
+ *
+ * or, if it can't run on this host (e.g., not root, no kernel support):
+ *
+ *	{"name": "clone/bindfd", "skipped": "Operation not permitted"}
+ *
+ * The fork benchmarks also report the resident set and page table sizes of the
+ * forking process ("rss_kb", "pte_kb"), which is what a fork has to copy; -m
+ * grows the former by dirtying that many MiB of heap first.
+ *
+ * Usage: nsexec-bench [-t seconds-per-benchmark] [-m MiB] [name-prefix ...]
+ */
+
+/* Pull in the static functions we benchmark. */
+#include "../nsexec.c"
+#include "../cloned_binary.c"
+#include "../log.c"
+
+static double bench_secs = 1.0;
+
+struct bench_t {
+	const char *name;
+	/* Performs one iteration; returns -1 with errno set if it can't run. */
+	int (*fn)(void *arg);
+	void *arg;
+	/* Report the memory of the process along with the latency. */
+	bool mem;
+};
+
+/* The VmRSS and VmPTE of this process, in KiB. */
+static void read_mem(unsigned long *rss, unsigned long *pte)
+{
+	char line[256];
+	FILE *f;
+
+	*rss = *pte = 0;
+	f = fopen("/proc/self/status", "re");
+	if (!f)
+		return;
+	while (fgets(line, sizeof(line), f)) {
+		sscanf(line, "VmRSS: %lu", rss);
+		sscanf(line, "VmPTE: %lu", pte);
+	}
+	fclose(f);
+}
+
+static void run_bench(const struct bench_t *b)
+{
+	uint64_t start, elapsed, iters = 0;
+	uint64_t budget = bench_secs * 1e9;
+
+	/* Warm up, and find out whether we can run at all. */
+	if (b->fn(b->arg) < 0) {
+		printf("{\"name\": \"%s\", \"skipped\": \"%s\"}\n", b->name, strerror(errno));
+		fflush(stdout);
+		return;
+	}
+
+	start = now_ns();
+	do {
+		if (b->fn(b->arg) < 0) {
+			printf("{\"name\": \"%s\", \"skipped\": \"%s\"}\n", b->name, strerror(errno));
+			fflush(stdout);
+			return;
+		}
+		iters++;
+		elapsed = now_ns() - start;
+	} while (elapsed < budget);
+
+	printf("{\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %llu",
+	       b->name, (unsigned long long)iters, (unsigned long long)(elapsed / iters));
+	if (b->mem) {
+		unsigned long rss, pte;
+
+		read_mem(&rss, &pte);
+		printf(", \"rss_kb\": %lu, \"pte_kb\": %lu", rss, pte);
+	}
+	printf("}\n");
+	fflush(stdout);
+}
+
+/* Binary cloning strategies, and copy tiers. */
+
+static int bench_strategy(void *arg)
+{
+	int fd = clone_strategies[(intptr_t)arg].clone();
+
+	if (fd < 0)
+		return -1;
+	close(fd);
+	return 0;
+}
+
+static int bench_copy(void *arg)
+{
+	int tier = (intptr_t)arg;
+	struct stat statbuf = {};
+	int binfd, execfd, ret = -1;
+
+	execfd = make_execfd_tmpfile();
+	if (execfd < 0)
+		return -1;
+
+	binfd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+	if (binfd < 0 || fstat(binfd, &statbuf) < 0)
+		goto out;
+
+	ret = copy_tiers[tier].copy(execfd, binfd, statbuf.st_size);
+	if (ret == 0)
+		ret = seal_execfd(&execfd, EFD_FILE);
+
+out:
+	if (binfd >= 0)
+		close(binfd);
+	close(execfd);
+	return ret;
+}
+
+static int bench_shared(void *arg)
+{
+	int fd = shared_binary(arg);
+
+	if (fd < 0)
+		return -1;
+	close(fd);
+	return 0;
+}
+
+/* nl_parse() */
+
+struct nl_arg {
+	char *msg;
+	size_t len;
+};
+
+static void nl_add_attr(char *buf, size_t *off, uint16_t type, const char *data, size_t len)
+{
+	struct nlattr *attr = (struct nlattr *)(buf + *off);
+
+	attr->nla_type = type;
+	attr->nla_len = NLA_HDRLEN + len;
+	memcpy(buf + *off + NLA_HDRLEN, data, len);
+	*off += NLA_ALIGN(attr->nla_len);
+}
+
+/*
+ * Builds a bootstrap message of roughly the given payload size, made of the
+ * attributes of a typical container create with a namespace path list padded
+ * up to the requested size.
+ */
+static void nl_build(struct nl_arg *a, size_t size)
+{
+	struct nlmsghdr *hdr;
+	uint32_t flags = CLONE_NEWNS | CLONE_NEWUTS | CLONE_NEWIPC | CLONE_NEWPID | CLONE_NEWNET;
+	const char *map = "0 165536 65536\n";
+	size_t off = NLMSG_HDRLEN, pathlen, i;
+	char *paths;
+
+	pathlen = size > 128 ? size - 128 : 16;
+	paths = malloc(pathlen);
+	a->msg = calloc(1, NLMSG_HDRLEN + size + 256);
+	if (!paths || !a->msg)
+		bail("failed to allocate bootstrap message");
+
+	for (i = 0; i < pathlen - 1; i++)
+		paths[i] = (i % 32 == 31) ? ',' : 'a';
+	paths[pathlen - 1] = '\0';
+
+	nl_add_attr(a->msg, &off, CLONE_FLAGS_ATTR, (char *)&flags, sizeof(flags));
+	nl_add_attr(a->msg, &off, UIDMAP_ATTR, map, strlen(map) + 1);
+	nl_add_attr(a->msg, &off, GIDMAP_ATTR, map, strlen(map) + 1);
+	nl_add_attr(a->msg, &off, NS_PATHS_ATTR, paths, pathlen);
+
+	hdr = (struct nlmsghdr *)a->msg;
+	hdr->nlmsg_len = off;
+	hdr->nlmsg_type = INIT_MSG;
+	a->len = off;
+	free(paths);
+}
+
+static int bench_nl_parse(void *arg)
+{
+	struct nl_arg *a = arg;
+	struct nlconfig_t config = {0};
+	int sk[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sk) < 0)
+		return -1;
+	if (write(sk[0], a->msg, a->len) != a->len) {
+		close(sk[0]);
+		close(sk[1]);
+		return -1;
+	}
+
+	nl_parse(sk[1], &config);
+	nl_free(&config);
+	close(sk[0]);
+	close(sk[1]);
+	return 0;
+}
+
+/* join_namespaces() on our own namespaces (the user-ns can't be re-joined). */
+
+static const char *join_types[] = { "ipc", "uts", "net", "pid", "cgroup", "time", "mnt" };
+
+static int bench_join(void *arg)
+{
+	char nslist[512] = {0};
+	size_t len = 0;
+	int i, n = (intptr_t)arg;
+
+	for (i = 0; i < n; i++)
+		len += snprintf(nslist + len, sizeof(nslist) - len, "%s%s:/proc/self/ns/%s",
+				i ? "," : "", join_types[i], join_types[i]);
+
+	/* join_namespaces() bails on error; check we have what it needs first. */
+	for (i = 0; i < n; i++) {
+		char path[PATH_MAX];
+
+		snprintf(path, sizeof(path), "/proc/self/ns/%s", join_types[i]);
+		if (access(path, F_OK) < 0)
+			return -1;
+	}
+	if (geteuid() != 0) {
+		errno = EPERM;
+		return -1;
+	}
+
+	join_namespaces(nslist);
+	return 0;
+}
+
+/* Forks: a stage fork, and spawning a tool with fork(2) versus spawn_tool(). */
+
+static char *true_argv[] = { "/bin/true", NULL };
+
+static int reap(int child)
+{
+	int status;
+
+	if (child < 0)
+		return -1;
+	while (waitpid(child, &status, 0) < 0)
+		if (errno != EINTR)
+			return -1;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		errno = ECHILD;
+		return -1;
+	}
+	return 0;
+}
+
+static int bench_fork_stage(void *arg)
+{
+	int child = fork();
+
+	if (child == 0)
+		_exit(0);
+	return reap(child);
+}
+
+static int bench_spawn_fork(void *arg)
+{
+	char *envp[] = { NULL };
+	int child = fork();
+
+	if (child == 0) {
+		execve(true_argv[0], true_argv, envp);
+		_exit(127);
+	}
+	return reap(child);
+}
+
+static int bench_spawn_vfork(void *arg)
+{
+	return reap(spawn_tool(true_argv[0], true_argv));
+}
+
+static bool selected(const char *name, int argc, char **argv)
+{
+	int i;
+
+	if (argc == 0)
+		return true;
+	for (i = 0; i < argc; i++)
+		if (strncmp(name, argv[i], strlen(argv[i])) == 0)
+			return true;
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	static struct nl_arg nl[4];
+	static const size_t nl_sizes[] = { 256, 4096, 16384, 65536 };
+	static char names[32][64];
+	struct bench_t benches[64];
+	char shared_dir[] = "/tmp/nsexec-bench.XXXXXX";
+	int nbenches = 0, nnames = 0, opt, i;
+	size_t heap_mib = 0;
+	char *heap;
+
+	while ((opt = getopt(argc, argv, "t:m:")) != -1) {
+		switch (opt) {
+		case 't':
+			bench_secs = atof(optarg);
+			break;
+		case 'm':
+			heap_mib = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-m MiB] [name-prefix ...]\n", argv[0]);
+			return 1;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	for (i = 0; i < CLONE_SHARED; i++) {
+		snprintf(names[nnames], sizeof(names[0]), "clone/%s", clone_strategies[i].name);
+		benches[nbenches++] = (struct bench_t){ names[nnames++], bench_strategy, (void *)(intptr_t)i };
+	}
+	if (mkdtemp(shared_dir))
+		benches[nbenches++] = (struct bench_t){ "clone/shared", bench_shared, shared_dir };
+
+	for (i = 0; i < sizeof(copy_tiers) / sizeof(copy_tiers[0]); i++) {
+		snprintf(names[nnames], sizeof(names[0]), "copy/%s", copy_tiers[i].name);
+		benches[nbenches++] = (struct bench_t){ names[nnames++], bench_copy, (void *)(intptr_t)i };
+	}
+
+	for (i = 0; i < sizeof(nl_sizes) / sizeof(nl_sizes[0]); i++) {
+		nl_build(&nl[i], nl_sizes[i]);
+		snprintf(names[nnames], sizeof(names[0]), "nl_parse/%zu", nl_sizes[i]);
+		benches[nbenches++] = (struct bench_t){ names[nnames++], bench_nl_parse, &nl[i] };
+	}
+
+	for (i = 1; i <= sizeof(join_types) / sizeof(join_types[0]); i++) {
+		snprintf(names[nnames], sizeof(names[0]), "join_namespaces/%d", i);
+		benches[nbenches++] = (struct bench_t){ names[nnames++], bench_join, (void *)(intptr_t)i };
+	}
+
+	benches[nbenches++] = (struct bench_t){ "fork/stage", bench_fork_stage, NULL, true };
+	benches[nbenches++] = (struct bench_t){ "spawn/fork", bench_spawn_fork, NULL, true };
+	benches[nbenches++] = (struct bench_t){ "spawn/vfork", bench_spawn_vfork, NULL, true };
+
+	if (heap_mib > 0) {
+		heap = malloc(heap_mib << 20);
+		if (!heap)
+			bail("failed to allocate %zu MiB of heap", heap_mib);
+		memset(heap, 1, heap_mib << 20);
+	}
+
+	for (i = 0; i < nbenches; i++)
+		if (selected(benches[i].name, argc, argv))
+			run_bench(&benches[i]);
+
+	/* Tear down the shared view published by clone/shared. */
+	if (shared_dir[strlen(shared_dir) - 1] != 'X') {
+		prune_shared_binaries(shared_dir, "");
+		rmdir(shared_dir);
+	}
+	return 0;
+}
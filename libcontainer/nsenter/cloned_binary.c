@@ -48,7 +48,10 @@
 #include <limits.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <dirent.h>
 
+#include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
@@ -57,6 +60,10 @@
 #include <sys/mount.h>
 #include <sys/sendfile.h>
 #include <sys/syscall.h>
+#include <sys/utsname.h>
+
+#include "log.h"
+#include "probe.h"
 
 /* Use our own wrapper for memfd_create. */
 #ifndef SYS_memfd_create
@@ -101,6 +108,23 @@ int memfd_create(const char *name, unsigned int flags)
 #endif
 }
 
+/* Use our own wrapper for copy_file_range, which needs glibc 2.27. */
+static ssize_t runc_copy_file_range(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len,
+				    unsigned int flags)
+{
+#ifdef SYS_copy_file_range
+	return syscall(SYS_copy_file_range, fd_in, off_in, fd_out, off_out, len, flags);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/* This comes directly from <linux/fs.h>. */
+#ifndef FICLONE
+#  define FICLONE _IOW(0x94, 9, int)
+#endif
+
 
 /* This comes directly from <linux/fcntl.h>. */
 #ifndef F_LINUX_SPECIFIC_BASE
@@ -122,6 +146,20 @@ int memfd_create(const char *name, unsigned int flags)
 #define RUNC_MEMFD_SEALS \
 	(F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
 
+/*
+ * sysbox-runc: if set, this names a directory (the runc root) under which a
+ * single read-only view of the binary is published and shared by all
+ * invocations of that binary version.
+ */
+#define SHARED_BINARY_ENV "_LIBCONTAINER_SHARED_BINARY_DIR"
+#define SHARED_BINARY_PREFIX ".runc-cloned"
+
+/*
+ * How long a placeholder for a shared binary may stay unpublished before we
+ * consider it a left-over from a crashed publisher and remove it.
+ */
+#define SHARED_BINARY_STALE_SECS 60
+
 static void *must_realloc(void *ptr, size_t size)
 {
 	void *old = ptr;
@@ -295,75 +333,82 @@ enum {
 #  endif
 #endif
 
-static int make_execfd(int *fdtype)
+/* The directory that our temporary copies of the binary are created in. */
+static const char *execfd_prefix(void)
 {
-	int fd = -1;
-	char template[PATH_MAX] = {0};
 	char *prefix = getenv("_LIBCONTAINER_STATEDIR");
 
 	if (!prefix || *prefix != '/')
 		prefix = "/tmp";
-	if (snprintf(template, sizeof(template), "%s/runc.XXXXXX", prefix) < 0)
-		return -1;
+	return prefix;
+}
 
+static int make_execfd_memfd(void)
+{
 	/*
-	 * Now try memfd, it's much nicer than actually creating a file in STATEDIR
-	 * since it's easily detected thanks to sealing and also doesn't require
-	 * assumptions about STATEDIR.
+	 * memfd is much nicer than actually creating a file in STATEDIR since it's
+	 * easily detected thanks to sealing and also doesn't require assumptions
+	 * about STATEDIR.
 	 */
-	*fdtype = EFD_MEMFD;
-	fd = memfd_create(RUNC_MEMFD_COMMENT, MFD_CLOEXEC | MFD_ALLOW_SEALING);
-	if (fd >= 0)
-		return fd;
-	if (errno != ENOSYS && errno != EINVAL)
-		goto error;
+	return memfd_create(RUNC_MEMFD_COMMENT, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+}
 
+static int make_execfd_tmpfile(void)
+{
 #ifdef O_TMPFILE
 	/*
-	 * Try O_TMPFILE to avoid races where someone might snatch our file. Note
+	 * Use O_TMPFILE to avoid races where someone might snatch our file. Note
 	 * that O_EXCL isn't actually a security measure here (since you can just
 	 * fd re-open it and clear O_EXCL).
 	 */
-	*fdtype = EFD_FILE;
-	fd = open(prefix, O_TMPFILE | O_EXCL | O_RDWR | O_CLOEXEC, 0700);
-	if (fd >= 0) {
-		struct stat statbuf = {};
-		bool working_otmpfile = false;
-
-		/*
-		 * open(2) ignores unknown O_* flags -- yeah, I was surprised when I
-		 * found this out too. As a result we can't check for EINVAL. However,
-		 * if we get nlink != 0 (or EISDIR) then we know that this kernel
-		 * doesn't support O_TMPFILE.
-		 */
-		if (fstat(fd, &statbuf) >= 0)
-			working_otmpfile = (statbuf.st_nlink == 0);
-
-		if (working_otmpfile)
-			return fd;
+	struct stat statbuf = {};
+	bool working_otmpfile = false;
+	int fd;
 
-		/* Pretend that we got EISDIR since O_TMPFILE failed. */
-		close(fd);
-		errno = EISDIR;
-	}
-	if (errno != EISDIR)
-		goto error;
+	fd = open(execfd_prefix(), O_TMPFILE | O_EXCL | O_RDWR | O_CLOEXEC, 0700);
+	if (fd < 0)
+		return -1;
+
+	/*
+	 * open(2) ignores unknown O_* flags -- yeah, I was surprised when I
+	 * found this out too. As a result we can't check for EINVAL. However,
+	 * if we get nlink != 0 (or EISDIR) then we know that this kernel
+	 * doesn't support O_TMPFILE.
+	 */
+	if (fstat(fd, &statbuf) >= 0)
+		working_otmpfile = (statbuf.st_nlink == 0);
+
+	if (working_otmpfile)
+		return fd;
+
+	/* Pretend that we got EISDIR since O_TMPFILE failed. */
+	close(fd);
+	errno = EISDIR;
+	return -1;
+#else
+	errno = ENOSYS;
+	return -1;
 #endif /* defined(O_TMPFILE) */
+}
 
+static int make_execfd_mkostemp(void)
+{
 	/*
-	 * Our final option is to create a temporary file the old-school way, and
-	 * then unlink it so that nothing else sees it by accident.
+	 * Create a temporary file the old-school way, and then unlink it so that
+	 * nothing else sees it by accident.
 	 */
-	*fdtype = EFD_FILE;
+	char template[PATH_MAX] = {0};
+	int fd;
+
+	if (snprintf(template, sizeof(template), "%s/runc.XXXXXX", execfd_prefix()) < 0)
+		return -1;
+
 	fd = mkostemp(template, O_CLOEXEC);
 	if (fd >= 0) {
 		if (unlink(template) >= 0)
 			return fd;
 		close(fd);
 	}
-
-error:
-	*fdtype = EFD_NONE;
 	return -1;
 }
 
@@ -453,55 +498,174 @@ out:
 	return ret;
 }
 
-static ssize_t fd_to_fd(int outfd, int infd)
+/*
+ * The copy engine. Every tier copies size bytes from binfd (starting at offset
+ * 0) into the (empty) execfd. If a tier can't do the job, execfd is reset and
+ * the next one is tried -- ordered from the cheapest to the most expensive.
+ * A tier that fails sets errno, with EIO for a short copy (i.e., one that hit
+ * the end of the binary early), so that the failure can be logged.
+ */
+#define COPY_BUFFER_SIZE (1 << 20)
+
+/* Share the data blocks with the binary (only for a tmpfile on the same fs). */
+static int copy_ficlone(int execfd, int binfd, off_t size)
 {
-	ssize_t total = 0;
-	char buffer[4096];
+	struct stat statbuf = {};
 
-	for (;;) {
-		ssize_t nread, nwritten = 0;
+	if (ioctl(execfd, FICLONE, binfd) < 0)
+		return -1;
+	if (fstat(execfd, &statbuf) < 0)
+		return -1;
+	if (statbuf.st_size != size) {
+		errno = EIO;
+		return -1;
+	}
+	return 0;
+}
 
-		nread = read(infd, buffer, sizeof(buffer));
-		if (nread < 0)
+static int copy_cfr(int execfd, int binfd, off_t size)
+{
+	loff_t off_in = 0, off_out = 0;
+
+	while (off_in < size) {
+		ssize_t n = runc_copy_file_range(binfd, &off_in, execfd, &off_out, size - off_in, 0);
+		if (n == 0)
+			errno = EIO;
+		if (n <= 0)
 			return -1;
-		if (!nread)
-			break;
+	}
+	return 0;
+}
+
+static int copy_sendfile(int execfd, int binfd, off_t size)
+{
+	off_t offset = 0;
+
+	while (offset < size) {
+		ssize_t n = sendfile(execfd, binfd, &offset, size - offset);
+		if (n == 0)
+			errno = EIO;
+		if (n <= 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int copy_splice(int execfd, int binfd, off_t size)
+{
+	int ret = -1, pipefd[2];
+	loff_t off_in = 0, off_out = 0;
+
+	if (pipe2(pipefd, O_CLOEXEC) < 0)
+		return -1;
+	/* Best-effort: a bigger pipe means fewer round-trips. */
+	fcntl(pipefd[1], F_SETPIPE_SZ, COPY_BUFFER_SIZE);
+
+	while (off_in < size) {
+		ssize_t nread = splice(binfd, &off_in, pipefd[1], NULL, size - off_in, SPLICE_F_MOVE);
+		if (nread == 0)
+			errno = EIO;
+		if (nread <= 0)
+			goto out;
+
+		while (nread > 0) {
+			ssize_t n = splice(pipefd[0], NULL, execfd, &off_out, nread, SPLICE_F_MOVE);
+			if (n == 0)
+				errno = EIO;
+			if (n <= 0)
+				goto out;
+			nread -= n;
+		}
+	}
+	ret = 0;
+
+out:
+	close(pipefd[0]);
+	close(pipefd[1]);
+	return ret;
+}
+
+/* Our last resort is a dumb user-space copy, using a large buffer. */
+static int copy_buffer(int execfd, int binfd, off_t size)
+{
+	int ret = -1;
+	off_t offset = 0;
+	char *buffer;
+
+	buffer = mmap(NULL, COPY_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffer == MAP_FAILED)
+		return -1;
+
+	while (offset < size) {
+		ssize_t nread, nwritten = 0;
+
+		nread = pread(binfd, buffer, COPY_BUFFER_SIZE, offset);
+		if (nread < 0 && errno == EINTR)
+			continue;
+		if (nread == 0)
+			errno = EIO;
+		if (nread <= 0)
+			goto out;
 
 		do {
-			ssize_t n = write(outfd, buffer + nwritten, nread - nwritten);
-			if (n < 0)
-				return -1;
+			ssize_t n = pwrite(execfd, buffer + nwritten, nread - nwritten, offset + nwritten);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n == 0)
+				errno = EIO;
+			if (n <= 0)
+				goto out;
 			nwritten += n;
-		} while(nwritten < nread);
+		} while (nwritten < nread);
 
-		total += nwritten;
+		offset += nwritten;
 	}
+	ret = 0;
+
+out:
+	munmap(buffer, COPY_BUFFER_SIZE);
+	return ret;
+}
+
+static const struct {
+	const char *name;
+	int (*copy)(int execfd, int binfd, off_t size);
+} copy_tiers[] = {
+	{ "ficlone", copy_ficlone },
+	{ "copy_file_range", copy_cfr },
+	{ "sendfile", copy_sendfile },
+	{ "splice", copy_splice },
+	{ "buffer", copy_buffer },
+};
+
+/* Copy the whole binary (of the given size) from binfd into execfd. */
+static int copy_binary(int execfd, int binfd, off_t size)
+{
+	int i;
+
+	for (i = 0; i < sizeof(copy_tiers) / sizeof(copy_tiers[0]); i++) {
+		if (copy_tiers[i].copy(execfd, binfd, size) == 0) {
+			write_log(DEBUG, "cloned binary (%lld bytes) using %s", (long long)size, copy_tiers[i].name);
+			return 0;
+		}
+		write_log(DEBUG, "could not clone binary using %s: %m", copy_tiers[i].name);
 
-	return total;
+		/* Throw away whatever the failed tier managed to copy. */
+		if (ftruncate(execfd, 0) < 0 || lseek(execfd, 0, SEEK_SET) < 0)
+			return -1;
+	}
+	return -1;
 }
 
-static int clone_binary(void)
+/* Copy the binary into the execfd returned by make_execfd, and seal it. */
+static int clone_binary_copy(int (*make_execfd)(void), int fdtype)
 {
 	int binfd, execfd;
 	struct stat statbuf = {};
-	size_t sent = 0;
-	int fdtype = EFD_NONE;
-
-	/*
-	 * Before we resort to copying, let's try creating an ro-binfd in one shot
-	 * by getting a handle for a read-only bind-mount of the execfd.
-	 */
-	execfd = try_bindfd();
-	if (execfd >= 0)
-		return execfd;
 
-	/*
-	 * Dammit, that didn't work -- time to copy the binary to a safe place we
-	 * can seal the contents.
-	 */
-	execfd = make_execfd(&fdtype);
-	if (execfd < 0 || fdtype == EFD_NONE)
-		return -ENOTRECOVERABLE;
+	execfd = make_execfd();
+	if (execfd < 0)
+		return -1;
 
 	binfd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
 	if (binfd < 0)
@@ -510,19 +674,9 @@ static int clone_binary(void)
 	if (fstat(binfd, &statbuf) < 0)
 		goto error_binfd;
 
-	while (sent < statbuf.st_size) {
-		int n = sendfile(execfd, binfd, NULL, statbuf.st_size - sent);
-		if (n < 0) {
-			/* sendfile can fail so we fallback to a dumb user-space copy. */
-			n = fd_to_fd(execfd, binfd);
-			if (n < 0)
-				goto error_binfd;
-		}
-		sent += n;
-	}
+	if (copy_binary(execfd, binfd, statbuf.st_size) < 0)
+		goto error_binfd;
 	close(binfd);
-	if (sent != statbuf.st_size)
-		goto error;
 
 	if (seal_execfd(&execfd, fdtype) < 0)
 		goto error;
@@ -533,7 +687,473 @@ error_binfd:
 	close(binfd);
 error:
 	close(execfd);
-	return -EIO;
+	return -1;
+}
+
+static int clone_memfd(void)
+{
+	return clone_binary_copy(make_execfd_memfd, EFD_MEMFD);
+}
+
+static int clone_tmpfile(void)
+{
+	return clone_binary_copy(make_execfd_tmpfile, EFD_FILE);
+}
+
+static int clone_mkostemp(void)
+{
+	return clone_binary_copy(make_execfd_mkostemp, EFD_FILE);
+}
+
+static int clone_bindfd(void)
+{
+	int fd;
+
+	PROBE0(try_bindfd_enter);
+	fd = try_bindfd();
+	PROBE1(try_bindfd_exit, fd);
+
+	if (fd < 0) {
+		errno = -fd;
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * sysbox-runc: the ways we know of to get a sealed (or read-only) execfd for
+ * the binary, from the safest to the least safe: only a memfd can be sealed,
+ * an O_TMPFILE is never visible in the filesystem, and a mkostemp file is a
+ * named file in a directory until it's unlinked. So memfd is always used when
+ * it works; the fallbacks cost differently from one host to another, though:
+ * the copies depend on the copy tiers the filesystems support (e.g., a reflink
+ * of the binary onto a tmpfile is nearly free), while bindfd needs no copy but
+ * changes the mount table twice, which serializes on the kernel's namespace
+ * lock with every other mount operation on the host (a real problem on hosts
+ * with many containers, each with many mounts). The
+ * counters of the strategy used by each invocation at debug log level (plus
+ * "shared", for the shared read-only view) are kept in the stats file (see
+ * count_strategy());
+ * the order of this table must match libcontainer's clonedBinaryStrategies.
+ */
+enum {
+	CLONE_MEMFD = 0,
+	CLONE_TMPFILE,
+	CLONE_MKOSTEMP,
+	CLONE_BINDFD,
+	CLONE_SHARED,
+	CLONE_NUM_STRATEGIES,
+};
+
+static const struct {
+	const char *name;
+	int (*clone)(void);
+} clone_strategies[] = {
+	[CLONE_MEMFD] = { "memfd", clone_memfd },
+	[CLONE_TMPFILE] = { "tmpfile", clone_tmpfile },
+	[CLONE_MKOSTEMP] = { "mkostemp", clone_mkostemp },
+	[CLONE_BINDFD] = { "bindfd", clone_bindfd },
+	[CLONE_SHARED] = { "shared", NULL },
+};
+
+#define CLONE_STRATEGY_FILE ".runc-clone-strategy"
+#define CLONE_STATS_FILE ".runc-clone-stats"
+
+/*
+ * The strategy cache and the stats are kept in the parent of STATEDIR (i.e.,
+ * the runc root), so that they are shared by all containers. Returns -1 if
+ * there's no such directory.
+ */
+static int clone_cache_dir(char *dir, size_t len)
+{
+	char *statedir = getenv("_LIBCONTAINER_STATEDIR"), *slash;
+
+	if (!statedir || *statedir != '/')
+		return -1;
+	if (snprintf(dir, len, "%s", statedir) >= len)
+		return -1;
+
+	/* Strip trailing slashes, then the last component. */
+	for (slash = dir + strlen(dir) - 1; slash > dir && *slash == '/'; slash--)
+		*slash = '\0';
+	slash = strrchr(dir, '/');
+	if (!slash || slash == dir)
+		return -1;
+	*slash = '\0';
+	return 0;
+}
+
+/*
+ * The probed strategy is only valid for the kernel and the binary it was probed
+ * with: either of them changing may change which strategies work (and thus which
+ * one is picked).
+ */
+static int clone_cache_key(char *key, size_t len)
+{
+	struct utsname uts = {};
+	struct stat binstat = {};
+	int n;
+
+	if (uname(&uts) < 0 || stat("/proc/self/exe", &binstat) < 0)
+		return -1;
+
+	n = snprintf(key, len, "%s-%llx-%llx-%llx-%llx.%lx", uts.release,
+		     (unsigned long long)binstat.st_dev, (unsigned long long)binstat.st_ino,
+		     (unsigned long long)binstat.st_size, (unsigned long long)binstat.st_mtim.tv_sec,
+		     (unsigned long)binstat.st_mtim.tv_nsec);
+	if (n < 0 || n >= len)
+		return -1;
+	return 0;
+}
+
+/* Returns the cached strategy for key, or -1 if there's none. */
+static int cached_strategy(const char *dir, const char *key)
+{
+	char path[PATH_MAX] = {0}, buf[512] = {0}, *name;
+	int fd, i;
+	ssize_t n;
+
+	if (snprintf(path, sizeof(path), "%s/" CLONE_STRATEGY_FILE, dir) >= sizeof(path))
+		return -1;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+	if (fd < 0)
+		return -1;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0)
+		return -1;
+
+	/* The format is "<key> <strategy>\n". */
+	name = strchr(buf, ' ');
+	if (!name || name - buf != strlen(key) || strncmp(buf, key, name - buf))
+		return -1;
+	name++;
+	name[strcspn(name, "\n")] = '\0';
+
+	for (i = 0; i < CLONE_SHARED; i++)
+		if (!strcmp(name, clone_strategies[i].name))
+			return i;
+	return -1;
+}
+
+/* Replaces the cached strategy (atomically, as other invocations may read it). */
+static void cache_strategy(const char *dir, const char *key, int strategy)
+{
+	char path[PATH_MAX] = {0}, tmp[PATH_MAX] = {0}, buf[512] = {0};
+	int fd, len;
+
+	if (snprintf(path, sizeof(path), "%s/" CLONE_STRATEGY_FILE, dir) >= sizeof(path))
+		return;
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= sizeof(tmp))
+		return;
+	len = snprintf(buf, sizeof(buf), "%s %s\n", key, clone_strategies[strategy].name);
+	if (len < 0 || len >= sizeof(buf))
+		return;
+
+	fd = mkostemp(tmp, O_CLOEXEC);
+	if (fd < 0)
+		return;
+	if (write(fd, buf, len) != len || rename(tmp, path) < 0)
+		unlink(tmp);
+	close(fd);
+}
+
+/*
+ * Bumps the counter of the given strategy in the stats file, an array of
+ * CLONE_NUM_STRATEGIES native-endian 64-bit counters (indexed as
+ * clone_strategies) which all invocations update in place. Best-effort, and
+ * only done for invocations logging at debug level, so that the others don't
+ * pay for the open and mapping of the file.
+ */
+static void count_strategy(int strategy)
+{
+	char dir[PATH_MAX] = {0}, path[PATH_MAX] = {0};
+	size_t size = CLONE_NUM_STRATEGIES * sizeof(uint64_t);
+	struct stat statbuf = {};
+	uint64_t *counters;
+	int fd;
+
+	if (loglevel < DEBUG)
+		return;
+	if (clone_cache_dir(dir, sizeof(dir)) < 0)
+		return;
+	if (snprintf(path, sizeof(path), "%s/" CLONE_STATS_FILE, dir) >= sizeof(path))
+		return;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+	if (fd < 0)
+		return;
+	if (fstat(fd, &statbuf) < 0 || (statbuf.st_size < size && ftruncate(fd, size) < 0))
+		goto out;
+
+	counters = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (counters == MAP_FAILED)
+		goto out;
+	__atomic_add_fetch(&counters[strategy], 1, __ATOMIC_RELAXED);
+	munmap(counters, size);
+out:
+	close(fd);
+}
+
+/*
+ * sysbox-runc: read the binary into the page cache, so that the probed copies
+ * are timed on an equal footing (rather than the first one paying for reading
+ * it from disk).
+ */
+static void warm_binary(void)
+{
+	struct stat statbuf = {};
+	int binfd;
+
+	binfd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+	if (binfd < 0)
+		return;
+	if (fstat(binfd, &statbuf) == 0)
+		readahead(binfd, 0, statbuf.st_size);
+	close(binfd);
+}
+
+/*
+ * sysbox-runc: pick the strategy to clone the binary with. memfd is used
+ * whenever it works (see clone_strategies); otherwise the fastest working one
+ * of the other copies is picked. bindfd is only used if none of them works, as
+ * its cost is not just its own. Returns the execfd obtained with the picked
+ * strategy.
+ */
+static int probe_strategies(int *strategy)
+{
+	uint64_t best_ns = 0;
+	int i, fd, best_fd = -1;
+
+	*strategy = -1;
+	fd = clone_memfd();
+	if (fd >= 0) {
+		*strategy = CLONE_MEMFD;
+		return fd;
+	}
+	write_log(DEBUG, "could not clone binary using %s: %m", clone_strategies[CLONE_MEMFD].name);
+
+	warm_binary();
+	for (i = CLONE_MEMFD + 1; i < CLONE_BINDFD; i++) {
+		struct timespec start, end;
+		uint64_t ns;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		fd = clone_strategies[i].clone();
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if (fd < 0) {
+			write_log(DEBUG, "could not clone binary using %s: %m", clone_strategies[i].name);
+			continue;
+		}
+
+		ns = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+		write_log(DEBUG, "probed cloned binary strategy %s: %llu ns", clone_strategies[i].name,
+			  (unsigned long long)ns);
+		if (best_fd < 0 || ns < best_ns) {
+			if (best_fd >= 0)
+				close(best_fd);
+			best_fd = fd;
+			best_ns = ns;
+			*strategy = i;
+		} else {
+			close(fd);
+		}
+	}
+	if (best_fd >= 0)
+		return best_fd;
+
+	best_fd = clone_bindfd();
+	if (best_fd >= 0)
+		*strategy = CLONE_BINDFD;
+	return best_fd;
+}
+
+static int clone_binary(void)
+{
+	char dir[PATH_MAX] = {0}, key[512] = {0};
+	bool cacheable;
+	int strategy = -1, execfd;
+
+	cacheable = clone_cache_dir(dir, sizeof(dir)) == 0 && clone_cache_key(key, sizeof(key)) == 0;
+
+	/*
+	 * Use the strategy we picked last time around (for this kernel and binary),
+	 * if it still works. Otherwise, probe them again.
+	 */
+	if (cacheable)
+		strategy = cached_strategy(dir, key);
+	if (strategy >= 0) {
+		execfd = clone_strategies[strategy].clone();
+		if (execfd >= 0)
+			goto out;
+		write_log(DEBUG, "could not clone binary using cached strategy %s: %m", clone_strategies[strategy].name);
+	}
+
+	execfd = probe_strategies(&strategy);
+	if (execfd < 0)
+		return -ENOTRECOVERABLE;
+	if (cacheable)
+		cache_strategy(dir, key, strategy);
+
+out:
+	write_log(DEBUG, "cloned binary using %s", clone_strategies[strategy].name);
+	count_strategy(strategy);
+	return execfd;
+}
+
+/*
+ * sysbox-runc: compute the path of the shared read-only view of the binary. The
+ * name is keyed on the identity of the on-disk binary (device, inode, size and
+ * mtime), so that installing a new version of the binary results in a new
+ * shared view rather than re-using a stale one.
+ */
+static int shared_binary_path(const char *dir, const struct stat *binstat, char *path, size_t len)
+{
+	int n;
+
+	n = snprintf(path, len, "%s/" SHARED_BINARY_PREFIX ".%llx-%llx-%llx-%llx.%lx",
+		     dir, (unsigned long long)binstat->st_dev, (unsigned long long)binstat->st_ino,
+		     (unsigned long long)binstat->st_size, (unsigned long long)binstat->st_mtim.tv_sec,
+		     (unsigned long)binstat->st_mtim.tv_nsec);
+	if (n < 0 || n >= len)
+		return -1;
+	return 0;
+}
+
+/*
+ * sysbox-runc: open the shared read-only view of the binary, if one has been
+ * published. The handle is only accepted if it sits on a read-only mount (i.e.,
+ * the same check is_self_cloned() does once we've exec'ed it) and refers to the
+ * very same inode as the binary we are running.
+ */
+static int open_shared_binary(const char *path, const struct stat *binstat)
+{
+	int fd;
+	struct stat statbuf = {};
+	struct statfs fsbuf = {};
+
+	fd = open(path, O_PATH | O_CLOEXEC | O_NOFOLLOW);
+	if (fd < 0)
+		return -1;
+
+	if (fstatfs(fd, &fsbuf) < 0 || !(fsbuf.f_flags & MS_RDONLY))
+		goto error;
+	if (fstat(fd, &statbuf) < 0 || statbuf.st_dev != binstat->st_dev || statbuf.st_ino != binstat->st_ino)
+		goto error;
+
+	return fd;
+
+error:
+	/*
+	 * An empty file here is the placeholder of a publisher that either hasn't
+	 * finished yet or died half-way. Remove it once it's old enough so that
+	 * the next invocation can publish again. Note that unlink(2) fails with
+	 * EBUSY if the binary has been mounted on it in the meantime.
+	 */
+	if (fstat(fd, &statbuf) >= 0 && S_ISREG(statbuf.st_mode) && statbuf.st_size == 0 &&
+	    time(NULL) - statbuf.st_ctime > SHARED_BINARY_STALE_SECS)
+		unlink(path);
+	close(fd);
+	return -1;
+}
+
+/*
+ * sysbox-runc: drop the shared views of binary versions that are no longer
+ * installed, i.e., whose binary has been unlinked (the view is a mount of the
+ * binary's inode, so its link count drops to 0). The views of other versions
+ * that are still installed are kept: during a rolling upgrade, the old and the
+ * new binary are both in use, and dropping each other's view would have them
+ * republish theirs over and over. Invocations that already hold a handle to a
+ * view are not affected, since MNT_DETACH keeps a mount alive until its last
+ * user is gone.
+ */
+static void prune_shared_binaries(const char *dir, const char *path)
+{
+	DIR *d;
+	struct dirent *ent;
+	struct stat statbuf = {};
+	char stale[PATH_MAX] = {0};
+
+	d = opendir(dir);
+	if (!d)
+		return;
+
+	while ((ent = readdir(d)) != NULL) {
+		if (strncmp(ent->d_name, SHARED_BINARY_PREFIX ".", strlen(SHARED_BINARY_PREFIX ".")))
+			continue;
+		if (snprintf(stale, sizeof(stale), "%s/%s", dir, ent->d_name) < 0)
+			continue;
+		if (!strcmp(stale, path))
+			continue;
+		if (stat(stale, &statbuf) < 0 || statbuf.st_nlink > 0)
+			continue;
+		umount2(stale, MNT_DETACH);
+		unlink(stale);
+	}
+	closedir(d);
+}
+
+/*
+ * sysbox-runc: publish a read-only view of the binary at the given path, by
+ * bind-mounting it over an (exclusively created) empty file. This is what
+ * try_bindfd() does, except that the mount is kept around so that later
+ * invocations pick it up via open_shared_binary() and don't have to create a
+ * mount (or a copy of the binary) of their own. The mount lives in the host
+ * mount namespace under the runc root, so it can't be remounted read-write from
+ * within a container.
+ */
+static int publish_shared_binary(const char *dir, const char *path, const struct stat *binstat)
+{
+	int fd;
+
+	/* Someone else is already publishing (or has published) this version. */
+	fd = open(path, O_CREAT | O_EXCL | O_RDONLY | O_CLOEXEC, 0500);
+	if (fd < 0)
+		return -1;
+	close(fd);
+
+	if (mount("/proc/self/exe", path, "", MS_BIND, "") < 0)
+		goto out_unlink;
+	if (mount("", path, "", MS_REMOUNT | MS_BIND | MS_RDONLY | MS_NOSUID | MS_NODEV, "") < 0)
+		goto out_umount;
+
+	fd = open_shared_binary(path, binstat);
+	if (fd < 0)
+		goto out_umount;
+
+	prune_shared_binaries(dir, path);
+	return fd;
+
+out_umount:
+	umount2(path, MNT_DETACH);
+out_unlink:
+	unlink(path);
+	return -1;
+}
+
+/*
+ * sysbox-runc: get an execfd for the shared read-only view of the binary,
+ * publishing it if it doesn't exist yet. Unlike clone_binary(), once the view
+ * has been published this costs a single open(2): no copy of the binary and no
+ * change to the mount table.
+ */
+static int shared_binary(const char *dir)
+{
+	int execfd;
+	struct stat binstat = {};
+	char path[PATH_MAX] = {0};
+
+	if (stat("/proc/self/exe", &binstat) < 0)
+		return -1;
+	if (shared_binary_path(dir, &binstat, path, sizeof(path)) < 0)
+		return -1;
+
+	execfd = open_shared_binary(path, &binstat);
+	if (execfd >= 0)
+		return execfd;
+
+	return publish_shared_binary(dir, path, &binstat);
 }
 
 /* Get cheap access to the environment. */
@@ -543,6 +1163,7 @@ int ensure_cloned_binary(void)
 {
 	int execfd;
 	char **argv = NULL;
+	char *shared_dir;
 
 	/* Check that we're not self-cloned, and if we are then bail. */
 	int cloned = is_self_cloned();
@@ -552,13 +1173,25 @@ int ensure_cloned_binary(void)
 	if (fetchve(&argv) < 0)
 		return -EINVAL;
 
-	execfd = clone_binary();
+	execfd = -1;
+	shared_dir = getenv(SHARED_BINARY_ENV);
+	if (shared_dir && *shared_dir == '/') {
+		execfd = shared_binary(shared_dir);
+		if (execfd >= 0)
+			count_strategy(CLONE_SHARED);
+	}
+	if (execfd < 0) {
+		PROBE0(clone_binary_enter);
+		execfd = clone_binary();
+		PROBE1(clone_binary_exit, execfd);
+	}
 	if (execfd < 0)
 		return -EIO;
 
 	if (putenv(CLONED_BINARY_ENV "=1"))
 		goto error;
 
+	log_flush();
 	fexecve(execfd, argv, environ);
 error:
 	close(execfd);
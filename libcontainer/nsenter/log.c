@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+
+static int logfd = -1;
+int loglevel = -1;
+
+static const char *level_names[] = {
+	[PANIC] = "panic",
+	[FATAL] = "fatal",
+	[ERROR] = "error",
+	[WARNING] = "warning",
+	[INFO] = "info",
+	[DEBUG] = "debug",
+};
+
+/*
+ * Records waiting to be written to the log pipe. The buffer is no larger than
+ * PIPE_BUF, so that every flush is a single atomic write and the records of
+ * stages that log at the same time don't get interleaved.
+ */
+static char logbuf[PIPE_BUF];
+static size_t loglen;
+
+/* A record longer than this gets its message truncated. */
+#define LOG_RECORD_MAX 1024
+#define LOG_TRAILER    "\"}\n"
+
+static int parse_loglevel(const char *level)
+{
+	int i;
+
+	if (level == NULL || *level == '\0')
+		return DEBUG;
+	/* logrus calls it either way. */
+	if (strcmp(level, "warn") == 0)
+		return WARNING;
+	for (i = PANIC; i <= DEBUG; i++)
+		if (strcmp(level, level_names[i]) == 0)
+			return i;
+	/* "trace", or something we don't know about: log everything. */
+	return DEBUG;
+}
+
+void setup_logpipe(void)
+{
+	char *logpipe, *endptr;
+
+	logpipe = getenv("_LIBCONTAINER_LOGPIPE");
+	if (logpipe == NULL || *logpipe == '\0') {
+		return;
+	}
+
+	logfd = strtol(logpipe, &endptr, 10);
+	if (logpipe == endptr || *endptr != '\0') {
+		fprintf(stderr, "unable to parse _LIBCONTAINER_LOGPIPE, value: %s\n", logpipe);
+		/* It is too early to use bail */
+		exit(1);
+	}
+
+	loglevel = parse_loglevel(getenv("_LIBCONTAINER_LOGLEVEL"));
+	atexit(log_flush);
+}
+
+void log_flush(void)
+{
+	int saved_errno = errno;
+	size_t off = 0;
+	ssize_t n;
+
+	while (logfd >= 0 && off < loglen) {
+		n = write(logfd, logbuf + off, loglen - off);
+		if (n < 0 && errno == EINTR)
+			continue;
+		/* There is nobody we could report this to. */
+		if (n <= 0)
+			break;
+		off += n;
+	}
+	loglen = 0;
+	errno = saved_errno;
+}
+
+void write_log_with_info(int level, const char *function, int line, const char *format, ...)
+{
+	/* Leave room for the trailer, which is always there even if we truncate. */
+	const size_t size = LOG_RECORD_MAX - (sizeof(LOG_TRAILER) - 1);
+	int saved_errno = errno;
+	char *record;
+	va_list args;
+	int n, len;
+
+	if (logfd < 0 || level < PANIC || level > DEBUG)
+		return;
+
+	/* Format the record in place, making room for a whole one first. */
+	if (sizeof(logbuf) - loglen < LOG_RECORD_MAX)
+		log_flush();
+	record = logbuf + loglen;
+
+	len = snprintf(record, size, "{\"level\":\"%s\", \"msg\": \"%s:%d ", level_names[level], function, line);
+	if (len < 0)
+		goto done;
+	if (len >= size)
+		len = size - 1;
+
+	va_start(args, format);
+	n = vsnprintf(record + len, size - len, format, args);
+	va_end(args);
+	if (n < 0)
+		goto done;
+	len += n;
+	if (len >= size)
+		len = size - 1;
+
+	memcpy(record + len, LOG_TRAILER, sizeof(LOG_TRAILER) - 1);
+	loglen += len + sizeof(LOG_TRAILER) - 1;
+done:
+	/* Formatting "%m" and flushing must not change the errno of our caller. */
+	errno = saved_errno;
+}
@@ -0,0 +1,47 @@
+#ifndef NSENTER_LOG_H
+#define NSENTER_LOG_H
+
+/*
+ * Log levels, in the order (and with the names, see log.c) that logrus uses on
+ * the Go side of the log pipe.
+ */
+#define PANIC   0
+#define FATAL   1
+#define ERROR   2
+#define WARNING 3
+#define INFO    4
+#define DEBUG   5
+
+/*
+ * The most verbose level that gets logged (from _LIBCONTAINER_LOGLEVEL), or -1
+ * if we are not logging at all.
+ */
+extern int loglevel;
+
+/*
+ * Sets up logging from the _LIBCONTAINER_LOGPIPE and _LIBCONTAINER_LOGLEVEL
+ * environment variables. This should happen before anything else, so that all
+ * stages can log.
+ */
+void setup_logpipe(void);
+
+/*
+ * Records are buffered, and written to the log pipe by log_flush(). It must be
+ * called before anything that forks the process (or the records buffered so
+ * far are written by the child as well) or replaces it (execve), and before
+ * blocking on another process (so that the logs make it to the parent in a
+ * timely fashion). Records are also flushed on exit().
+ */
+void log_flush(void);
+
+void write_log_with_info(int level, const char *function, int line, const char *format, ...)
+	__attribute__ ((format(printf, 4, 5)));
+
+/* The level is checked first, so a disabled record costs a comparison. */
+#define write_log(level, fmt, ...)                                                  \
+	do {                                                                        \
+		if ((level) <= loglevel)                                            \
+			write_log_with_info((level), __FUNCTION__, __LINE__, (fmt), ##__VA_ARGS__); \
+	} while (0)
+
+#endif /* NSENTER_LOG_H */
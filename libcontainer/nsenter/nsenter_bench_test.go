@@ -0,0 +1,197 @@
+package nsenter
+
+import (
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/opencontainers/runc/libcontainer"
+	"github.com/vishvananda/netlink/nl"
+	"golang.org/x/sys/unix"
+)
+
+// Benchmarks of the whole nsenter bootstrap, from starting the process to its
+// grandchild being ready (SYNC_CHILD_READY). The pieces of the bootstrap that
+// can be timed in isolation (binary cloning, nl_parse(), join_namespaces())
+// are benchmarked in C, see bench/nsexec_bench.c.
+//
+// The results are in the standard `go test -bench` format (use -json for
+// JSON), so they can be compared across releases with benchstat:
+//
+//	go test -run '^$' -bench Nsenter -count 10 ./libcontainer/nsenter/ > new.txt
+//	benchstat old.txt new.txt
+
+// Namespaces of our own that a bootstrap can join (the user-ns can't be
+// re-joined).
+var benchJoinTypes = []string{"ipc", "uts", "net", "pid", "cgroup", "time", "mnt"}
+
+// bootstrap runs one nsenter bootstrap with the given (serialized) bootstrap
+// data and returns the per-phase timings it reported.
+func bootstrap(data []byte) (*timings, error) {
+	parent, child, err := newPipe()
+	if err != nil {
+		return nil, fmt.Errorf("failed to create pipe: %v", err)
+	}
+	defer parent.Close()
+	defer child.Close()
+
+	cmd := &exec.Cmd{
+		Path:       os.Args[0],
+		Args:       []string{"nsenter-exec"},
+		ExtraFiles: []*os.File{child},
+		Env:        []string{"_LIBCONTAINER_INITPIPE=3"},
+		Stdout:     os.Stdout,
+		Stderr:     os.Stderr,
+	}
+	if err := cmd.Start(); err != nil {
+		return nil, fmt.Errorf("nsenter failed to start: %v", err)
+	}
+
+	if _, err := io.Copy(parent, bytes.NewReader(data)); err != nil {
+		return nil, err
+	}
+
+	decoder := json.NewDecoder(parent)
+	var pid *pid
+	var tm timings
+
+	if err := cmd.Wait(); err != nil {
+		return nil, fmt.Errorf("nsenter exits with a non-zero exit status")
+	}
+	if err := decoder.Decode(&pid); err != nil {
+		return nil, err
+	}
+	if err := decoder.Decode(&tm); err != nil {
+		return nil, fmt.Errorf("failed to decode timings: %v", err)
+	}
+	p, err := os.FindProcess(pid.Pid)
+	if err != nil {
+		return nil, err
+	}
+	p.Wait()
+
+	return &tm, nil
+}
+
+func benchRequest(cloneFlags uintptr, namespaces []string) []byte {
+	r := nl.NewNetlinkRequest(int(libcontainer.InitMsg), 0)
+	r.AddData(&libcontainer.Int32msg{
+		Type:  libcontainer.CloneFlagsAttr,
+		Value: uint32(cloneFlags),
+	})
+	if len(namespaces) > 0 {
+		r.AddData(&libcontainer.Bytemsg{
+			Type:  libcontainer.NsPathsAttr,
+			Value: []byte(strings.Join(namespaces, ",")),
+		})
+	}
+	return r.Serialize()
+}
+
+func skipUnlessRoot(b *testing.B) {
+	if os.Geteuid() != 0 {
+		b.Skip("requires root")
+	}
+}
+
+// BenchmarkNsenterBootstrap measures the create-to-ready latency of a bootstrap
+// that creates new namespaces, and also reports the average duration of each
+// of the bootstrap phases (as "<stage>.<phase>-ns/op").
+func BenchmarkNsenterBootstrap(b *testing.B) {
+	skipUnlessRoot(b)
+
+	r := benchRequest(unix.CLONE_NEWUTS|unix.CLONE_NEWIPC|unix.CLONE_NEWNET, nil)
+	phases := make(map[string]uint64)
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		tm, err := bootstrap(r)
+		if err != nil {
+			b.Fatal(err)
+		}
+		for _, timing := range tm.Timings {
+			phases[fmt.Sprintf("%d.%s", timing.Stage, timing.Phase)] += timing.Duration
+		}
+	}
+	b.StopTimer()
+
+	for phase, total := range phases {
+		b.ReportMetric(float64(total)/float64(b.N), phase+"-ns/op")
+	}
+}
+
+// BenchmarkNsenterJoinNamespaces measures bootstraps that join 1 to 7 of our
+// own namespaces.
+func BenchmarkNsenterJoinNamespaces(b *testing.B) {
+	skipUnlessRoot(b)
+
+	for n := 1; n <= len(benchJoinTypes); n++ {
+		namespaces := []string{}
+		for _, ns := range benchJoinTypes[:n] {
+			namespaces = append(namespaces, fmt.Sprintf("%s:/proc/%d/ns/%s", ns, os.Getpid(), ns))
+		}
+		if _, err := os.Stat(fmt.Sprintf("/proc/self/ns/%s", benchJoinTypes[n-1])); err != nil {
+			b.Logf("skipping %d namespaces: %v", n, err)
+			break
+		}
+
+		r := benchRequest(0, namespaces)
+		b.Run(fmt.Sprintf("ns=%d", n), func(b *testing.B) {
+			for i := 0; i < b.N; i++ {
+				if _, err := bootstrap(r); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+// BenchmarkNsenterConcurrent measures the throughput of 1, 8 and 64 concurrent
+// bootstraps (reported as "bootstraps/s").
+func BenchmarkNsenterConcurrent(b *testing.B) {
+	skipUnlessRoot(b)
+
+	r := benchRequest(unix.CLONE_NEWUTS|unix.CLONE_NEWIPC, nil)
+
+	for _, conc := range []int{1, 8, 64} {
+		b.Run(fmt.Sprintf("conc=%d", conc), func(b *testing.B) {
+			var wg sync.WaitGroup
+			var errOnce sync.Once
+			var benchErr error
+
+			work := make(chan struct{}, b.N)
+			for i := 0; i < b.N; i++ {
+				work <- struct{}{}
+			}
+			close(work)
+
+			start := time.Now()
+			for w := 0; w < conc; w++ {
+				wg.Add(1)
+				go func() {
+					defer wg.Done()
+					for range work {
+						if _, err := bootstrap(r); err != nil {
+							errOnce.Do(func() { benchErr = err })
+							return
+						}
+					}
+				}()
+			}
+			wg.Wait()
+			elapsed := time.Since(start)
+
+			if benchErr != nil {
+				b.Fatal(benchErr)
+			}
+			b.ReportMetric(float64(b.N)/elapsed.Seconds(), "bootstraps/s")
+		})
+	}
+}
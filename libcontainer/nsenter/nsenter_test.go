@@ -8,6 +8,7 @@ import (
 	"io/ioutil"
 	"os"
 	"os/exec"
+	"path/filepath"
 	"strings"
 	"testing"
 
@@ -20,6 +21,14 @@ type pid struct {
 	Pid int `json:"Pid"`
 }
 
+type timings struct {
+	Timings []struct {
+		Stage    int    `json:"stage"`
+		Phase    string `json:"phase"`
+		Duration uint64 `json:"duration"`
+	} `json:"timings"`
+}
+
 type logentry struct {
 	Msg   string `json:"msg"`
 	Level string `json:"level"`
@@ -222,6 +231,241 @@ func TestNsenterChildLogging(t *testing.T) {
 	}
 }
 
+func TestNsenterTimings(t *testing.T) {
+	args := []string{"nsenter-exec"}
+	parent, child, err := newPipe()
+	if err != nil {
+		t.Fatalf("failed to create pipe %v", err)
+	}
+	defer parent.Close()
+	defer child.Close()
+
+	namespaces := []string{
+		// join pid ns of the current process
+		fmt.Sprintf("pid:/proc/%d/ns/pid", os.Getpid()),
+	}
+	cmd := &exec.Cmd{
+		Path:       os.Args[0],
+		Args:       args,
+		ExtraFiles: []*os.File{child},
+		Env:        []string{"_LIBCONTAINER_INITPIPE=3"},
+		Stdout:     os.Stdout,
+		Stderr:     os.Stderr,
+	}
+
+	if err := cmd.Start(); err != nil {
+		t.Fatalf("nsenter failed to start %v", err)
+	}
+	r := nl.NewNetlinkRequest(int(libcontainer.InitMsg), 0)
+	r.AddData(&libcontainer.Int32msg{
+		Type:  libcontainer.CloneFlagsAttr,
+		Value: uint32(unix.CLONE_NEWNET),
+	})
+	r.AddData(&libcontainer.Bytemsg{
+		Type:  libcontainer.NsPathsAttr,
+		Value: []byte(strings.Join(namespaces, ",")),
+	})
+	if _, err := io.Copy(parent, bytes.NewReader(r.Serialize())); err != nil {
+		t.Fatal(err)
+	}
+
+	decoder := json.NewDecoder(parent)
+	var pid *pid
+	var tm timings
+
+	if err := cmd.Wait(); err != nil {
+		t.Fatalf("nsenter exits with a non-zero exit status")
+	}
+	if err := decoder.Decode(&pid); err != nil {
+		t.Fatalf("%v", err)
+	}
+	if err := decoder.Decode(&tm); err != nil {
+		t.Fatalf("failed to decode timings: %v", err)
+	}
+	p, err := os.FindProcess(pid.Pid)
+	if err != nil {
+		t.Fatalf("%v", err)
+	}
+	p.Wait()
+
+	phases := make(map[string]bool)
+	for _, timing := range tm.Timings {
+		phases[fmt.Sprintf("%d:%s", timing.Stage, timing.Phase)] = true
+	}
+	for _, want := range []string{"0:nl_parse", "0:clone_child", "1:join_namespaces", "1:unshare", "1:clone_init", "2:grandchild_wait"} {
+		if !phases[want] {
+			t.Errorf("phase %s missing from timings %+v", want, tm.Timings)
+		}
+	}
+}
+
+func TestNsenterBatch(t *testing.T) {
+	parent, child, err := newPipe()
+	if err != nil {
+		t.Fatalf("failed to create pipe %v", err)
+	}
+	defer parent.Close()
+	defer child.Close()
+
+	// Each process of the batch gets its own init pipe and stdio.
+	const nprocs = 3
+	extraFiles := []*os.File{child}
+	procFds := []string{}
+	for i := 0; i < nprocs; i++ {
+		procParent, procChild, err := newPipe()
+		if err != nil {
+			t.Fatalf("failed to create pipe %v", err)
+		}
+		defer procParent.Close()
+		defer procChild.Close()
+
+		fd := 3 + len(extraFiles)
+		extraFiles = append(extraFiles, procChild, os.Stdin, os.Stdout, os.Stderr)
+		procFds = append(procFds, fmt.Sprintf("%d:%d:%d:%d", fd, fd+1, fd+2, fd+3))
+	}
+
+	cmd := &exec.Cmd{
+		Path:       os.Args[0],
+		Args:       []string{"nsenter-exec"},
+		ExtraFiles: extraFiles,
+		Env:        []string{"_LIBCONTAINER_INITPIPE=3"},
+		Stdout:     os.Stdout,
+		Stderr:     os.Stderr,
+	}
+	if err := cmd.Start(); err != nil {
+		t.Fatalf("nsenter failed to start %v", err)
+	}
+
+	r := nl.NewNetlinkRequest(int(libcontainer.InitMsg), 0)
+	r.AddData(&libcontainer.Int32msg{
+		Type:  libcontainer.CloneFlagsAttr,
+		Value: 0,
+	})
+	r.AddData(&libcontainer.Bytemsg{
+		Type:  libcontainer.BatchFdsAttr,
+		Value: []byte(strings.Join(procFds, ",")),
+	})
+	if _, err := io.Copy(parent, bytes.NewReader(r.Serialize())); err != nil {
+		t.Fatal(err)
+	}
+
+	decoder := json.NewDecoder(parent)
+	var pids struct {
+		Pid  int   `json:"pid"`
+		Pids []int `json:"pids"`
+	}
+	var tm timings
+
+	if err := cmd.Wait(); err != nil {
+		t.Fatalf("nsenter exits with a non-zero exit status")
+	}
+	if err := decoder.Decode(&pids); err != nil {
+		t.Fatalf("%v", err)
+	}
+	if err := decoder.Decode(&tm); err != nil {
+		t.Fatalf("failed to decode timings: %v", err)
+	}
+	if len(pids.Pids) != nprocs || pids.Pid != pids.Pids[0] {
+		t.Fatalf("expected %d pids (the first one as pid), got %+v", nprocs, pids)
+	}
+
+	seen := make(map[int]bool)
+	for _, pid := range pids.Pids {
+		if seen[pid] {
+			t.Errorf("pid %d is in the batch more than once: %v", pid, pids.Pids)
+		}
+		seen[pid] = true
+		p, err := os.FindProcess(pid)
+		if err != nil {
+			t.Fatalf("%v", err)
+		}
+		p.Wait()
+	}
+}
+
+func TestNsenterSharedClonedBinary(t *testing.T) {
+	dir, err := ioutil.TempDir("", "nsenter-shared")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	// Run the bootstrap twice; the first run publishes the shared view of the
+	// binary and the second one re-uses it.
+	for i := 0; i < 2; i++ {
+		parent, child, err := newPipe()
+		if err != nil {
+			t.Fatalf("failed to create pipe %v", err)
+		}
+
+		cmd := &exec.Cmd{
+			Path:       os.Args[0],
+			Args:       []string{"nsenter-exec"},
+			ExtraFiles: []*os.File{child},
+			Env:        []string{"_LIBCONTAINER_INITPIPE=3", "_LIBCONTAINER_SHARED_BINARY_DIR=" + dir},
+			Stdout:     os.Stdout,
+			Stderr:     os.Stderr,
+		}
+		if err := cmd.Start(); err != nil {
+			t.Fatalf("nsenter failed to start %v", err)
+		}
+
+		r := nl.NewNetlinkRequest(int(libcontainer.InitMsg), 0)
+		r.AddData(&libcontainer.Int32msg{
+			Type:  libcontainer.CloneFlagsAttr,
+			Value: 0,
+		})
+		if _, err := io.Copy(parent, bytes.NewReader(r.Serialize())); err != nil {
+			t.Fatal(err)
+		}
+
+		decoder := json.NewDecoder(parent)
+		var pid *pid
+
+		if err := cmd.Wait(); err != nil {
+			t.Fatalf("nsenter exits with a non-zero exit status")
+		}
+		if err := decoder.Decode(&pid); err != nil {
+			t.Fatalf("%v", err)
+		}
+		p, err := os.FindProcess(pid.Pid)
+		if err != nil {
+			t.Fatalf("%v", err)
+		}
+		p.Wait()
+		parent.Close()
+		child.Close()
+	}
+
+	matches, err := filepath.Glob(filepath.Join(dir, ".runc-cloned.*"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(matches) != 1 {
+		t.Fatalf("expected one shared cloned binary in %s, got %v", dir, matches)
+	}
+	defer unix.Unmount(matches[0], unix.MNT_DETACH)
+
+	var st, exe unix.Stat_t
+	if err := unix.Stat(matches[0], &st); err != nil {
+		t.Fatal(err)
+	}
+	if err := unix.Stat("/proc/self/exe", &exe); err != nil {
+		t.Fatal(err)
+	}
+	if st.Dev != exe.Dev || st.Ino != exe.Ino {
+		t.Fatalf("shared cloned binary %s is not a view of the test binary", matches[0])
+	}
+
+	var fs unix.Statfs_t
+	if err := unix.Statfs(matches[0], &fs); err != nil {
+		t.Fatal(err)
+	}
+	if fs.Flags&unix.ST_RDONLY == 0 {
+		t.Fatalf("shared cloned binary %s is not on a read-only mount", matches[0])
+	}
+}
+
 func init() {
 	if strings.HasPrefix(os.Args[0], "nsenter-") {
 		os.Exit(0)
@@ -14,11 +14,15 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/prctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/mount.h>
@@ -29,15 +33,29 @@
 
 /* Get all of the CLONE_NEW* flags. */
 #include "namespace.h"
+#include "log.h"
+#include "probe.h"
 
-/* Synchronisation values. */
+/*
+ * Synchronisation values.
+ *
+ * sysbox-runc: the stages exchange these as fixed-size sync_msg_t messages over
+ * SOCK_SEQPACKET socketpairs, each message carrying its own payload (rather
+ * than the payload following in separate writes).
+ */
 enum sync_t {
 	SYNC_USERMAP_PLS = 0x40,	/* Request parent to map our users. */
 	SYNC_USERMAP_ACK = 0x41,	/* Mapping finished by the parent. */
-	SYNC_RECVPID_PLS = 0x42,	/* Tell parent we're sending the PID. */
-	SYNC_RECVPID_ACK = 0x43,	/* PID was correctly received by parent. */
+	SYNC_RECVPID_PLS = 0x42,	/* Tell parent the PID of the grandchild (in .pid). */
 	SYNC_GRANDCHILD = 0x44,	   /* The grandchild is ready to run. */
 	SYNC_CHILD_READY = 0x45,	/* The child or grandchild is ready to return. */
+	SYNC_ERROR = 0x46,		/* The peer failed (with errno .err) and is exiting. */
+};
+
+struct sync_msg_t {
+	uint32_t type;			/* enum sync_t */
+	int32_t pid;
+	int32_t err;
 };
 
 /*
@@ -68,6 +86,10 @@ struct clone_t {
 struct nlconfig_t {
 	char *data;
 
+	/* sysbox-runc: the mapping of the bootstrap memfd data lives in, if any. */
+	void *map;
+	size_t map_len;
+
 	/* Process settings. */
 	uint32_t cloneflags;
 	char *oom_score_adj;
@@ -99,16 +121,24 @@ struct nlconfig_t {
 	size_t parent_mount_len;
 	char *shiftfs_mounts;
 	size_t shiftfs_mounts_len;
-};
+	char *idmap_mounts;
+	size_t idmap_mounts_len;
 
-#define PANIC   "panic"
-#define FATAL   "fatal"
-#define ERROR   "error"
-#define WARNING "warning"
-#define INFO    "info"
-#define DEBUG   "debug"
+	/* sysbox-runc: cgroup setup */
+	int cgroup_fd;
+	uint8_t cgroupns_nosync; /* boolean */
 
-static int logfd = -1;
+	/* sysbox-runc: pidfd of a process in all of the namespaces to join */
+	int ns_pidfd;
+
+	/* sysbox-runc: batch exec (see parse_batch()) */
+	char *batch_fds;
+	size_t batch_fds_len;
+
+	/* sysbox-runc: CPU and memory placement (see set_placement()) */
+	char *cpuset_cpus;
+	char *cpuset_mems;
+};
 
 /*
  * List of netlink message types sent to us as part of bootstrapping the init.
@@ -130,6 +160,13 @@ static int logfd = -1;
 #define ROOTFS_ATTR        27293
 #define PARENT_MOUNT_ATTR  27294
 #define SHIFTFS_MOUNTS_ATTR 27295
+#define CGROUP_FD_ATTR     27296
+#define CGROUPNS_NOSYNC_ATTR 27297
+#define NS_PIDFD_ATTR      27298
+#define IDMAP_MOUNTS_ATTR  27299
+#define BATCH_FDS_ATTR     27300
+#define CPUSET_CPUS_ATTR   27301
+#define CPUSET_MEMS_ATTR   27302
 
 /*
  * Use the raw syscall for versions of glibc which don't include a function for
@@ -152,49 +189,257 @@ int setns(int fd, int nstype)
 }
 #endif
 
-static void write_log_with_info(const char *level, const char *function, int line, const char *format, ...)
+/* XXX: This is ugly. */
+static int syncfd = -1;
+
+static void sync_error(void);
+
+#define bail(fmt, ...)                                       \
+	do {                                                       \
+		write_log(FATAL, "nsenter: " fmt ": %m", ##__VA_ARGS__); \
+		log_flush();                                             \
+		sync_error();                                            \
+		exit(1);                                                 \
+	} while(0)
+
+/*
+ * sysbox-runc: sends a message to the peer stage on fd. MSG_NOSIGNAL, as a dead
+ * peer must show up as an error (EPIPE) rather than kill us.
+ */
+static int sync_send(int fd, enum sync_t type, int32_t pid)
 {
-	char message[1024] = {};
+	struct sync_msg_t msg = { .type = type, .pid = pid };
+
+	PROBE3(sync_send, fd, type, pid);
+	if (send(fd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg))
+		return -1;
+	return 0;
+}
 
-	va_list args;
+/*
+ * Receives the next message from the peer stage on fd. Since every stage closes
+ * the ends of the sync sockets it doesn't use, a peer that dies shows up here
+ * as end-of-file (reported as EPIPE) rather than as a read that never returns,
+ * and a peer that fails reports its error with SYNC_ERROR (reported as its
+ * errno).
+ */
+static int sync_recv(int fd, struct sync_msg_t *msg)
+{
+	ssize_t n;
 
-	if (logfd < 0 || level == NULL)
+	log_flush();
+	do {
+		n = recv(fd, msg, sizeof(*msg), 0);
+	} while (n < 0 && errno == EINTR);
+
+	if (n == 0)
+		errno = EPIPE;
+	if (n != sizeof(*msg))
+		return -1;
+	PROBE3(sync_recv, fd, msg->type, msg->pid);
+	if (msg->type == SYNC_ERROR) {
+		errno = msg->err ? msg->err : EPIPE;
+		return -1;
+	}
+	return 0;
+}
+
+/* Lets the peer stage know that we are bailing out (called by bail()). */
+static void sync_error(void)
+{
+	struct sync_msg_t msg = { .type = SYNC_ERROR, .err = errno };
+
+	if (syncfd >= 0)
+		send(syncfd, &msg, sizeof(msg), MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+/*
+ * sysbox-runc: per-phase latency instrumentation. Every stage records how long
+ * each of its phases took in a table that is shared among all the stages, and
+ * stage 2 reports the table to our parent once the setup is done.
+ */
+#define NSEXEC_START_ENV "_LIBCONTAINER_NSEXEC_START"
+#define MAX_TIMINGS 32
+
+struct timing_t {
+	const char *phase;
+	int stage;
+	uint64_t start;		/* ns since nsexec was first entered */
+	uint64_t duration;	/* ns */
+};
+
+struct timings_t {
+	uint64_t base;
+	uint32_t count;
+	struct timing_t entries[MAX_TIMINGS];
+};
+
+static struct timings_t *timings;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Sets up the (MAP_SHARED, so inherited by all stages) timings table. Also
+ * accounts for the time spent before ensure_cloned_binary() re-exec'ed us,
+ * which is passed along in NSEXEC_START_ENV.
+ */
+static void timings_init(void)
+{
+	char *start = getenv(NSEXEC_START_ENV);
+	uint64_t now = now_ns();
+
+	timings = mmap(NULL, sizeof(*timings), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (timings == MAP_FAILED) {
+		timings = NULL;
 		return;
+	}
 
-	va_start(args, format);
-	if (vsnprintf(message, sizeof(message), format, args) < 0)
-		goto done;
+	timings->base = now;
+	if (start) {
+		uint64_t base = strtoull(start, NULL, 10);
+		if (base && base <= now)
+			timings->base = base;
+		unsetenv(NSEXEC_START_ENV);
+	}
+}
+
+/* Records that the given phase of the given stage ran from start until now. */
+static void timing_record(int stage, const char *phase, uint64_t start)
+{
+	uint32_t i;
+
+	if (!timings)
+		return;
+
+	i = __atomic_fetch_add(&timings->count, 1, __ATOMIC_RELAXED);
+	if (i >= MAX_TIMINGS)
+		return;
 
-	dprintf(logfd, "{\"level\":\"%s\", \"msg\": \"%s:%d %s\"}\n", level, function, line, message);
-done:
-	va_end(args);
+	timings->entries[i] = (struct timing_t) {
+		.phase = phase,
+		.stage = stage,
+		.start = start - timings->base,
+		.duration = now_ns() - start,
+	};
 }
 
-#define write_log(level, fmt, ...) \
-	write_log_with_info((level), __FUNCTION__, __LINE__, (fmt), ##__VA_ARGS__)
+/*
+ * Sends the timings table to our parent as a JSON message following the pid
+ * one. Must only be called once all other stages are done recording.
+ */
+static void report_timings(int pipenum)
+{
+	char buf[4096];
+	uint32_t i, count = 0;
+	int len;
 
-/* XXX: This is ugly. */
-static int syncfd = -1;
+	if (timings)
+		count = timings->count < MAX_TIMINGS ? timings->count : MAX_TIMINGS;
 
-#define bail(fmt, ...)                                       \
-	do {                                                       \
-		write_log(FATAL, "nsenter: " fmt ": %m", ##__VA_ARGS__); \
-		exit(1);                                                 \
-	} while(0)
+	len = snprintf(buf, sizeof(buf), "{\"timings\": [");
+	for (i = 0; i < count && len < sizeof(buf); i++) {
+		struct timing_t *t = &timings->entries[i];
+
+		len += snprintf(buf + len, sizeof(buf) - len,
+				"%s{\"stage\": %d, \"phase\": \"%s\", \"start\": %llu, \"duration\": %llu}",
+				i ? ", " : "", t->stage, t->phase, (unsigned long long)t->start,
+				(unsigned long long)t->duration);
+	}
+	if (len < sizeof(buf))
+		len += snprintf(buf + len, sizeof(buf) - len, "]}\n");
+	if (len >= sizeof(buf))
+		bail("timings do not fit in the message buffer");
+
+	if (write(pipenum, buf, len) != len)
+		bail("unable to send timings");
+}
+
+/*
+ * sysbox-runc: the /proc of the host, opened by stage 0 before it joins any
+ * namespace and inherited by the other stages. We write the procfs knobs
+ * through it rather than through a path, which saves the lookup of /proc on
+ * every write and gets us the right files even if /proc has been remounted (or
+ * isn't mounted at all) in the mount-ns we've joined. Being the host's procfs,
+ * "self" resolves to the (host) pid of whichever stage uses it.
+ */
+static int procfd = -1;
+
+/* openat2(2) bits (Linux 5.6+), from <linux/openat2.h>. */
+#ifndef SYS_openat2
+#  ifdef __NR_openat2
+#    define SYS_openat2 __NR_openat2
+#  endif
+#endif
+#ifndef RESOLVE_NO_XDEV
+#  define RESOLVE_NO_XDEV 0x01
+#endif
+#ifndef RESOLVE_NO_MAGICLINKS
+#  define RESOLVE_NO_MAGICLINKS 0x02
+#endif
+#ifndef RESOLVE_BENEATH
+#  define RESOLVE_BENEATH 0x08
+#endif
 
-static int write_file(char *data, size_t data_len, char *pathfmt, ...)
+struct proc_open_how {
+	uint64_t flags;
+	uint64_t mode;
+	uint64_t resolve;
+};
+
+/*
+ * Opens @path below the procfs directory @dirfd, without following magic links
+ * or leaving procfs. Falls back to plain openat(2) on kernels without
+ * openat2(2).
+ */
+static int proc_openat(int dirfd, const char *path, int flags)
 {
-	int fd, len, ret = 0;
-	char path[PATH_MAX];
+#ifdef SYS_openat2
+	struct proc_open_how how = {
+		.flags = flags | O_CLOEXEC,
+		.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS | RESOLVE_NO_XDEV,
+	};
+	int fd;
 
-	va_list ap;
-	va_start(ap, pathfmt);
-	len = vsnprintf(path, PATH_MAX, pathfmt, ap);
-	va_end(ap);
-	if (len < 0)
-		return -1;
+	fd = syscall(SYS_openat2, dirfd, path, &how, sizeof(how));
+	if (fd >= 0 || errno != ENOSYS)
+		return fd;
+#endif
+	return openat(dirfd, path, flags | O_CLOEXEC);
+}
+
+static void setup_procfd(void)
+{
+	procfd = open("/proc", O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (procfd < 0)
+		bail("failed to open /proc");
+}
+
+/* The /proc/<pid> directory of @pid, for writing its knobs with write_file(). */
+static int open_procdir(int pid)
+{
+	char path[16];
+	int fd;
+
+	snprintf(path, sizeof(path), "%d", pid);
+	fd = proc_openat(procfd, path, O_PATH | O_DIRECTORY);
+	if (fd < 0)
+		bail("failed to open /proc/%d", pid);
+	return fd;
+}
+
+/* Writes @data to @path, relative to the procfs directory @dirfd. */
+static int write_file(int dirfd, char *data, size_t data_len, const char *path)
+{
+	int fd, len, ret = 0;
 
-	fd = open(path, O_RDWR);
+	fd = proc_openat(dirfd, path, O_RDWR);
 	if (fd < 0) {
 		return -1;
 	}
@@ -216,8 +461,8 @@ enum policy_t {
 	SETGROUPS_DENY,
 };
 
-/* This *must* be called before we touch gid_map. */
-static void update_setgroups(int pid, enum policy_t setgroup)
+/* This *must* be called before we touch gid_map. @dirfd is /proc/@pid. */
+static void update_setgroups(int pid, int dirfd, enum policy_t setgroup)
 {
 	char *policy;
 
@@ -234,7 +479,7 @@ static void update_setgroups(int pid, enum policy_t setgroup)
 		return;
 	}
 
-	if (write_file(policy, strlen(policy), "/proc/%d/setgroups", pid) < 0) {
+	if (write_file(dirfd, policy, strlen(policy), "setgroups") < 0) {
 		/*
 		 * If the kernel is too old to support /proc/pid/setgroups,
 		 * open(2) or write(2) will return ENOENT. This is fine.
@@ -252,10 +497,52 @@ static void update_setgroups(int pid, enum policy_t setgroup)
  * performs the container's rootfs setup.
  */
 
-static int try_mapping_tool(const char *app, int pid, char *map, size_t map_len)
+/*
+ * sysbox-runc: starts @app with @argv (and an empty environment), and returns
+ * its pid, or -1 with errno set if it could not be started. The child is
+ * created with vfork(2) (i.e., CLONE_VM | CLONE_VFORK): it only execs @app, so
+ * there's no need to copy our page tables for it, and we are suspended only
+ * until the exec. The child records an exec failure in our memory (which it
+ * shares) before exiting.
+ */
+static int spawn_tool(const char *app, char **argv)
 {
+	char *envp[] = { NULL };
+	volatile int exec_errno = 0;
 	int child;
 
+	log_flush();
+	child = vfork();
+	if (child < 0)
+		return -1;
+
+	if (!child) {
+		execve(app, argv, envp);
+		exec_errno = errno;
+		_exit(127);
+	}
+
+	if (exec_errno) {
+		while (waitpid(child, NULL, 0) < 0 && errno == EINTR)
+			;
+		errno = exec_errno;
+		return -1;
+	}
+	return child;
+}
+
+/*
+ * Starts @app (newuidmap or newgidmap) to install @map for @pid, and returns the
+ * pid of the tool without waiting for it (see wait_mapping_tool()), so that the
+ * uid and gid mapping tools can run at the same time.
+ */
+static int spawn_mapping_tool(const char *app, int pid, char *map, size_t map_len)
+{
+	char **argv;
+	char pid_fmt[16];
+	int argc = 0, max_argc = 4, child;
+	char *args, *next;
+
 	/*
 	 * If @app is NULL, execve will segfault. Just check it here and bail (if
 	 * we're in this path, the caller is already getting desperate and there
@@ -265,94 +552,135 @@ static int try_mapping_tool(const char *app, int pid, char *map, size_t map_len)
 	if (!app)
 		bail("mapping tool not present");
 
-	child = fork();
-	if (child < 0)
-		bail("failed to fork");
+	/*
+	 * Room for @app, the pid, the terminating NULL and one argument per
+	 * map field (i.e., at most one more than there are separators).
+	 */
+	for (next = map; next < map + map_len && *next; next++)
+		if (*next == ' ' || *next == '\n')
+			max_argc++;
 
-	if (!child) {
-#define MAX_ARGV 20
-		char *argv[MAX_ARGV];
-		char *envp[] = { NULL };
-		char pid_fmt[16];
-		int argc = 0;
-		char *next;
+	/* The argv is built here, before the vfork, on a copy of @map. */
+	argv = calloc(max_argc, sizeof(char *));
+	args = strndup(map, map_len);
+	if (!argv || !args)
+		bail("failed to allocate mapping tool argv");
 
-		snprintf(pid_fmt, 16, "%d", pid);
+	snprintf(pid_fmt, 16, "%d", pid);
 
-		argv[argc++] = (char *)app;
-		argv[argc++] = pid_fmt;
-		/*
-		 * Convert the map string into a list of argument that
-		 * newuidmap/newgidmap can understand.
-		 */
+	argv[argc++] = (char *)app;
+	argv[argc++] = pid_fmt;
+	/*
+	 * Convert the map string into a list of argument that
+	 * newuidmap/newgidmap can understand.
+	 */
 
-		while (argc < MAX_ARGV) {
-			if (*map == '\0') {
-				argv[argc++] = NULL;
-				break;
-			}
-			argv[argc++] = map;
-			next = strpbrk(map, "\n ");
-			if (next == NULL)
-				break;
-			*next++ = '\0';
-			map = next + strspn(next, "\n ");
-		}
+	map = args;
+	while (argc < max_argc - 1) {
+		if (*map == '\0')
+			break;
+		argv[argc++] = map;
+		next = strpbrk(map, "\n ");
+		if (next == NULL)
+			break;
+		*next++ = '\0';
+		map = next + strspn(next, "\n ");
+	}
+	argv[argc] = NULL;
 
-		execve(app, argv, envp);
+	child = spawn_tool(app, argv);
+	if (child < 0)
 		bail("failed to execv");
-	} else {
-		int status;
 
-		while (true) {
-			if (waitpid(child, &status, 0) < 0) {
-				if (errno == EINTR)
-					continue;
-				bail("failed to waitpid");
-			}
-			if (WIFEXITED(status) || WIFSIGNALED(status))
-				return WEXITSTATUS(status);
+	free(args);
+	free(argv);
+	return child;
+}
+
+static int wait_mapping_tool(int child)
+{
+	int status;
+
+	log_flush();
+	while (true) {
+		if (waitpid(child, &status, 0) < 0) {
+			if (errno == EINTR)
+				continue;
+			bail("failed to waitpid");
 		}
+		if (WIFEXITED(status))
+			return WEXITSTATUS(status);
+		if (WIFSIGNALED(status))
+			return -1;
 	}
-
-	return -1;
 }
 
-static void update_uidmap(const char *path, int pid, char *map, size_t map_len)
+/*
+ * Writes @map to /proc/@pid/@file (@dirfd being /proc/@pid). Returns 0 if done,
+ * or the pid of the mapping tool (@path) it had to fall back to when we aren't
+ * allowed to write it directly; the caller must reap it with
+ * wait_mapping_tool().
+ */
+static int update_map(const char *path, int pid, int dirfd, char *map, size_t map_len, const char *file)
 {
 	if (map == NULL || map_len <= 0)
-		return;
+		return 0;
 
-	if (write_file(map, map_len, "/proc/%d/uid_map", pid) < 0) {
+	if (write_file(dirfd, map, map_len, file) < 0) {
 		if (errno != EPERM)
-			bail("failed to update /proc/%d/uid_map", pid);
-		if (try_mapping_tool(path, pid, map, map_len))
-			bail("failed to use newuid map on %d", pid);
+			bail("failed to update /proc/%d/%s", pid, file);
+		return spawn_mapping_tool(path, pid, map, map_len);
 	}
+	return 0;
 }
 
-static void update_gidmap(const char *path, int pid, char *map, size_t map_len)
+/*
+ * Sets up the uid and gid mappings of @pid. When the mapping tools are needed,
+ * both run at the same time rather than one after the other.
+ */
+static void update_idmaps(struct nlconfig_t *config, int pid, int dirfd)
 {
-	if (map == NULL || map_len <= 0)
-		return;
+	int uid_tool, gid_tool;
 
-	if (write_file(map, map_len, "/proc/%d/gid_map", pid) < 0) {
-		if (errno != EPERM)
-			bail("failed to update /proc/%d/gid_map", pid);
-		if (try_mapping_tool(path, pid, map, map_len))
-			bail("failed to use newgid map on %d", pid);
+	uid_tool = update_map(config->uidmappath, pid, dirfd, config->uidmap, config->uidmap_len, "uid_map");
+	gid_tool = update_map(config->gidmappath, pid, dirfd, config->gidmap, config->gidmap_len, "gid_map");
+
+	if (uid_tool > 0 && wait_mapping_tool(uid_tool)) {
+		if (gid_tool > 0)
+			wait_mapping_tool(gid_tool);
+		bail("failed to use newuid map on %d", pid);
 	}
+	if (gid_tool > 0 && wait_mapping_tool(gid_tool))
+		bail("failed to use newgid map on %d", pid);
 }
 
+/*
+ * sysbox-runc: whether stage 1 has already set the configured oom score
+ * adjustment (which stage 2 inherits). Not a local of nsexec(), as it must
+ * survive the longjmp() into stage 2.
+ */
+static bool oom_score_adj_done = false;
+
 static void update_oom_score_adj(char *data, size_t len)
 {
 	if (data == NULL || len <= 0)
 		return;
 
-	if (write_file(data, len, "/proc/self/oom_score_adj") < 0)
+	if (write_file(procfd, data, len, "self/oom_score_adj") < 0)
 		bail("failed to update /proc/self/oom_score_adj");
 }
 
+/* sysbox-runc: unshare(2), between the unshare_enter and unshare_exit probes. */
+static int unshare_ns(int flags)
+{
+	int ret;
+
+	PROBE1(unshare_enter, flags);
+	ret = unshare(flags);
+	PROBE2(unshare_exit, flags, ret < 0 ? -errno : 0);
+	return ret;
+}
+
 /* A dummy function that just jumps to the given jumpval. */
 static int child_func(void *arg) __attribute__ ((noinline));
 static int child_func(void *arg)
@@ -368,8 +696,70 @@ static int clone_parent(jmp_buf *env, int jmpval)
 		.env = env,
 		.jmpval = jmpval,
 	};
+	int child;
+
+	log_flush();
+	PROBE1(clone_parent_enter, jmpval);
+	child = clone(child_func, ca.stack_ptr, CLONE_PARENT | SIGCHLD, &ca);
+	PROBE2(clone_parent_exit, jmpval, child);
+	return child;
+}
+
+/* clone3(2) bits, from <linux/sched.h>. */
+#ifndef SYS_clone3
+#  ifdef __NR_clone3
+#    define SYS_clone3 __NR_clone3
+#  endif
+#endif
+#ifndef CLONE_INTO_CGROUP
+#  define CLONE_INTO_CGROUP 0x200000000ULL
+#endif
+
+struct clone3_args {
+	uint64_t flags;
+	uint64_t pidfd;
+	uint64_t child_tid;
+	uint64_t parent_tid;
+	uint64_t exit_signal;
+	uint64_t stack;
+	uint64_t stack_size;
+	uint64_t tls;
+	uint64_t set_tid;
+	uint64_t set_tid_size;
+	uint64_t cgroup;
+};
 
-	return clone(child_func, ca.stack_ptr, CLONE_PARENT | SIGCHLD, &ca);
+/*
+ * sysbox-runc: like clone_parent(), but has the child created directly in the
+ * cgroup v2 directory referred to by cgroupfd (CLONE_INTO_CGROUP, Linux 5.7+).
+ * clone3(2) without a new stack behaves like fork(2), so the child just jumps
+ * from here. Returns -1 with errno set (e.g., ENOSYS, E2BIG or EINVAL on older
+ * kernels, EBUSY if the cgroup has domain controllers enabled and children of
+ * its own) if the child could not be created that way; the caller is expected
+ * to fall back to clone_parent() then.
+ */
+static int clone_parent_into_cgroup(jmp_buf *env, int jmpval, int cgroupfd) __attribute__ ((noinline));
+static int clone_parent_into_cgroup(jmp_buf *env, int jmpval, int cgroupfd)
+{
+#ifdef SYS_clone3
+	/* With CLONE_PARENT, the exit signal is the one we were created with. */
+	struct clone3_args args = {
+		.flags = CLONE_PARENT | CLONE_INTO_CGROUP,
+		.cgroup = cgroupfd,
+	};
+	long child;
+
+	log_flush();
+	PROBE1(clone_parent_enter, jmpval);
+	child = syscall(SYS_clone3, &args, sizeof(args));
+	if (child == 0)
+		longjmp(*env, jmpval);
+	PROBE2(clone_parent_exit, jmpval, child);
+	return child;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
 }
 
 /*
@@ -393,23 +783,6 @@ static int initpipe(void)
 	return pipenum;
 }
 
-static void setup_logpipe(void)
-{
-	char *logpipe, *endptr;
-
-	logpipe = getenv("_LIBCONTAINER_LOGPIPE");
-	if (logpipe == NULL || *logpipe == '\0') {
-		return;
-	}
-
-	logfd = strtol(logpipe, &endptr, 10);
-	if (logpipe == endptr || *endptr != '\0') {
-		fprintf(stderr, "unable to parse _LIBCONTAINER_LOGPIPE, value: %s\n", logpipe);
-		/* It is too early to use bail */
-		exit(1);
-	}
-}
-
 /* Returns the clone(2) flag for a namespace, given the name of a namespace. */
 static int nsflag(char *name)
 {
@@ -442,14 +815,93 @@ static uint8_t readint8(char *buf)
 	return *(uint8_t *) buf;
 }
 
+/*
+ * sysbox-runc: reads the netlink header off the init pipe, along with the
+ * memfd holding the whole message if our parent sent one (see
+ * sendBootstrapData() on the Go side). *datafd is -1 if it didn't.
+ */
+static ssize_t read_nlhdr(int fd, struct nlmsghdr *hdr, int *datafd)
+{
+	char buf[CMSG_SPACE(sizeof(int))] = { 0 };
+	struct iovec iov = {
+		.iov_base = hdr,
+		.iov_len = NLMSG_HDRLEN,
+	};
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = buf,
+		.msg_controllen = sizeof(buf),
+	};
+	struct cmsghdr *cmsg;
+	ssize_t len;
+
+	*datafd = -1;
+	len = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+	if (len < 0 && errno == ENOTSOCK)
+		return read(fd, hdr, NLMSG_HDRLEN);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (len > 0 && cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+	    cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+		memcpy(datafd, CMSG_DATA(cmsg), sizeof(int));
+	return len;
+}
+
+/* From <linux/fcntl.h>. */
+#ifndef F_LINUX_SPECIFIC_BASE
+#  define F_LINUX_SPECIFIC_BASE 1024
+#endif
+#ifndef F_GET_SEALS
+#  define F_GET_SEALS (F_LINUX_SPECIFIC_BASE + 10)
+#endif
+#ifndef F_SEAL_SHRINK
+#  define F_SEAL_SHRINK 0x0002
+#endif
+#ifndef F_SEAL_WRITE
+#  define F_SEAL_WRITE  0x0008
+#endif
+
+/*
+ * sysbox-runc: maps the bootstrap message in @datafd, which must be sealed
+ * against changes, and returns its payload. The mapping is private, as
+ * join_namespaces() and mount_shiftfs() tokenize their lists in place; only
+ * the pages they touch get copied.
+ */
+static char *map_nlpayload(int datafd, struct nlmsghdr *hdr, struct nlconfig_t *config)
+{
+	const int seals = F_SEAL_SHRINK | F_SEAL_WRITE;
+	struct stat st;
+	char *map;
+	int got;
+
+	got = fcntl(datafd, F_GET_SEALS);
+	if (got < 0 || (got & seals) != seals)
+		bail("bootstrap memfd is not sealed");
+	if (fstat(datafd, &st) < 0 || st.st_size != hdr->nlmsg_len)
+		bail("bootstrap memfd doesn't match the netlink header");
+
+	map = mmap(NULL, hdr->nlmsg_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, datafd, 0);
+	if (map == MAP_FAILED)
+		bail("failed to map bootstrap memfd");
+	if (memcmp(map, hdr, NLMSG_HDRLEN))
+		bail("bootstrap memfd doesn't match the netlink header");
+
+	config->map = map;
+	config->map_len = hdr->nlmsg_len;
+	return map + NLMSG_HDRLEN;
+}
+
 static void nl_parse(int fd, struct nlconfig_t *config)
 {
 	size_t len, size;
 	struct nlmsghdr hdr;
 	char *data, *current;
+	int datafd;
 
 	/* Retrieve the netlink header. */
-	len = read(fd, &hdr, NLMSG_HDRLEN);
+	log_flush();
+	len = read_nlhdr(fd, &hdr, &datafd);
 	if (len != NLMSG_HDRLEN)
 		bail("invalid netlink header length %zu", len);
 
@@ -461,16 +913,23 @@ static void nl_parse(int fd, struct nlconfig_t *config)
 
 	/* Retrieve data. */
 	size = NLMSG_PAYLOAD(&hdr, 0);
-	current = data = malloc(size);
-	if (!data)
-		bail("failed to allocate %zu bytes of memory for nl_payload", size);
+	if (datafd >= 0) {
+		current = data = map_nlpayload(datafd, &hdr, config);
+		close(datafd);
+	} else {
+		current = data = malloc(size);
+		if (!data)
+			bail("failed to allocate %zu bytes of memory for nl_payload", size);
 
-	len = read(fd, data, size);
-	if (len != size)
-		bail("failed to read netlink payload, %zu != %zu", len, size);
+		len = read(fd, data, size);
+		if (len != size)
+			bail("failed to read netlink payload, %zu != %zu", len, size);
+	}
 
 	/* Parse the netlink payload. */
 	config->data = data;
+	config->cgroup_fd = -1;
+	config->ns_pidfd = -1;
 	while (current < data + size) {
 		struct nlattr *nlattr = (struct nlattr *)current;
 		size_t payload_len = nlattr->nla_len - NLA_HDRLEN;
@@ -536,6 +995,29 @@ static void nl_parse(int fd, struct nlconfig_t *config)
 			config->shiftfs_mounts = current;
 			config->shiftfs_mounts_len = payload_len;
 			break;
+		case CGROUP_FD_ATTR:
+			config->cgroup_fd = readint32(current);
+			break;
+		case CGROUPNS_NOSYNC_ATTR:
+			config->cgroupns_nosync = readint8(current);
+			break;
+		case NS_PIDFD_ATTR:
+			config->ns_pidfd = readint32(current);
+			break;
+		case IDMAP_MOUNTS_ATTR:
+			config->idmap_mounts = current;
+			config->idmap_mounts_len = payload_len;
+			break;
+		case BATCH_FDS_ATTR:
+			config->batch_fds = current;
+			config->batch_fds_len = payload_len;
+			break;
+		case CPUSET_CPUS_ATTR:
+			config->cpuset_cpus = current;
+			break;
+		case CPUSET_MEMS_ATTR:
+			config->cpuset_mems = current;
+			break;
 
 		default:
 			bail("unknown netlink message type %d", nlattr->nla_type);
@@ -547,7 +1029,10 @@ static void nl_parse(int fd, struct nlconfig_t *config)
 
 void nl_free(struct nlconfig_t *config)
 {
-	free(config->data);
+	if (config->map)
+		munmap(config->map, config->map_len);
+	else
+		free(config->data);
 }
 
 void join_namespaces(char *nslist)
@@ -616,6 +1101,47 @@ void join_namespaces(char *nslist)
 	free(namespaces);
 }
 
+/*
+ * sysbox-runc: join all of the namespaces in nslist at once, with a setns(2) on
+ * the pidfd of a process that is in all of them (Linux 5.8+). Unlike one
+ * setns(2) per namespace path, this is atomic and doesn't have to resolve any
+ * paths. Returns -1 with errno set if that can't be done (and nothing has been
+ * joined then), in which case the caller falls back to join_namespaces().
+ */
+static int join_namespaces_pidfd(int pidfd, const char *nslist)
+{
+	int flags = 0;
+	const char *namespace = nslist;
+
+	while (namespace && *namespace) {
+		char name[16] = { 0 };
+		size_t len = strcspn(namespace, ":,");
+		int flag;
+
+		if (len >= sizeof(name))
+			goto invalid;
+		memcpy(name, namespace, len);
+
+		/* We need to know all the types to join. */
+		flag = nsflag(name);
+		if (!flag)
+			goto invalid;
+		flags |= flag;
+
+		namespace = strchr(namespace, ',');
+		if (namespace)
+			namespace++;
+	}
+	if (!flags)
+		goto invalid;
+
+	return setns(pidfd, flags);
+
+invalid:
+	errno = EINVAL;
+	return -1;
+}
+
 /* sysbox-runc */
 int mount_shiftfs(struct nlconfig_t *config) {
 	char *saveptr = NULL;
@@ -625,6 +1151,7 @@ int mount_shiftfs(struct nlconfig_t *config) {
 	if (!mntpath || !strlen(mntpath) || !strlen(mntlist))
 		return 0;
 
+	PROBE0(mount_shiftfs_enter);
 	do {
 		// For shiftfs mounts over the container's rootfs, we use "." (cwd)
 		// instead of the mount path because the container may no longer have
@@ -634,26 +1161,502 @@ int mount_shiftfs(struct nlconfig_t *config) {
 
 		if (strcmp(mntpath, config->rootfs) == 0) {
 			if (mount(".", ".", "shiftfs", 0, "") < 0)
-				return -1;
+				goto fail;
 		} else {
 			if (mount(mntpath, mntpath, "shiftfs", 0, "") < 0)
-				return -1;
+				goto fail;
 		}
 
 	} while ((mntpath = strtok_r(NULL, ",", &saveptr)) != NULL);
 
+	PROBE1(mount_shiftfs_exit, 0);
+	return 0;
+
+fail:
+	PROBE1(mount_shiftfs_exit, -errno);
+	return -1;
+}
+
+/*
+ * sysbox-runc: ID-mapped mounts (Linux 5.12+). Use the raw syscalls since
+ * glibc has no wrappers for them.
+ */
+#ifndef SYS_open_tree
+#  ifdef __NR_open_tree
+#    define SYS_open_tree __NR_open_tree
+#  endif
+#endif
+#ifndef SYS_move_mount
+#  ifdef __NR_move_mount
+#    define SYS_move_mount __NR_move_mount
+#  endif
+#endif
+#ifndef SYS_mount_setattr
+#  ifdef __NR_mount_setattr
+#    define SYS_mount_setattr __NR_mount_setattr
+#  endif
+#endif
+#ifndef OPEN_TREE_CLONE
+#  define OPEN_TREE_CLONE 1
+#endif
+#ifndef OPEN_TREE_CLOEXEC
+#  define OPEN_TREE_CLOEXEC O_CLOEXEC
+#endif
+#ifndef AT_RECURSIVE
+#  define AT_RECURSIVE 0x8000
+#endif
+#ifndef MOVE_MOUNT_F_EMPTY_PATH
+#  define MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#endif
+#ifndef MOUNT_ATTR_IDMAP
+#  define MOUNT_ATTR_IDMAP 0x00100000
+#endif
+
+struct idmap_mount_attr {
+	uint64_t attr_set;
+	uint64_t attr_clr;
+	uint64_t propagation;
+	uint64_t userns_fd;
+};
+
+/*
+ * Returns a detached, recursive clone of the mount at path, ID-mapped with the
+ * user namespace referred to by usernsfd.
+ */
+static int idmapped_tree(const char *path, int usernsfd)
+{
+#if defined(SYS_open_tree) && defined(SYS_mount_setattr)
+	struct idmap_mount_attr attr = {
+		.attr_set = MOUNT_ATTR_IDMAP,
+		.userns_fd = usernsfd,
+	};
+	int fd;
+
+	fd = syscall(SYS_open_tree, AT_FDCWD, path, OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC | AT_RECURSIVE);
+	if (fd < 0)
+		return -1;
+
+	if (syscall(SYS_mount_setattr, fd, "", AT_EMPTY_PATH | AT_RECURSIVE, &attr, sizeof(attr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static int attach_tree(int fd, const char *target)
+{
+#ifdef SYS_move_mount
+	return syscall(SYS_move_mount, fd, "", AT_FDCWD, target, MOVE_MOUNT_F_EMPTY_PATH);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static void send_fd(int sockfd, int fd)
+{
+	struct msghdr msg = {0};
+	struct iovec iov[1] = {0};
+	struct cmsghdr *cmsg;
+	char null_byte = '\0', buf[CMSG_SPACE(sizeof(fd))] = {0};
+
+	iov[0].iov_base = &null_byte;
+	iov[0].iov_len = 1;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = buf;
+	msg.msg_controllen = sizeof(buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fd));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+
+	if (sendmsg(sockfd, &msg, 0) < 0)
+		bail("failed to send fd %d", fd);
+}
+
+static int receive_fd(int sockfd)
+{
+	struct msghdr msg = {0};
+	struct iovec iov[1] = {0};
+	struct cmsghdr *cmsg;
+	char null_byte, buf[CMSG_SPACE(sizeof(int))] = {0};
+	int fd;
+
+	iov[0].iov_base = &null_byte;
+	iov[0].iov_len = 1;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = buf;
+	msg.msg_controllen = sizeof(buf);
+
+	log_flush();
+	if (recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC) != 1)
+		bail("failed to receive fd from peer");
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(int)))
+		bail("received unexpected control message from peer");
+
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+	return fd;
+}
+
+/*
+ * sysbox-runc: host uid or gid that the container's root maps to (i.e., the
+ * host id in the first line of the given mapping).
+ */
+static int map_root_host_id(const char *map, unsigned int *id)
+{
+	if (!map || sscanf(map, "%*u %u", id) != 1)
+		return -1;
 	return 0;
 }
 
+/*
+ * sysbox-runc: called by stage 0 once the child's user-ns mappings are in
+ * place. ID-maps each of the config.idmap_mounts paths using the child's
+ * user-ns and sends the resulting (detached) mounts to the child, which
+ * attaches them in its mount-ns (see attach_idmap_mounts()).
+ *
+ * Doing this here (rather than from the runc parent via the init helper
+ * process) saves a round-trip through the init sync pipe and the remounting of
+ * procfs that comes with it. @dirfd is /proc/@child.
+ */
+static void send_idmap_mounts(struct nlconfig_t *config, int child, int dirfd, int sockfd)
+{
+	char *saveptr = NULL, *mntlist, *mntpath;
+	unsigned int uid, gid;
+	int usernsfd, fd;
+
+	if (map_root_host_id(config->uidmap, &uid) < 0 || map_root_host_id(config->gidmap, &gid) < 0)
+		bail("failed to get container root host uid:gid");
+
+	/* A magic link, so proc_openat() won't do. */
+	usernsfd = openat(dirfd, "ns/user", O_RDONLY | O_CLOEXEC);
+	if (usernsfd < 0)
+		bail("failed to open /proc/%d/ns/user", child);
+
+	mntlist = strndup(config->idmap_mounts, config->idmap_mounts_len);
+	if (!mntlist)
+		bail("failed to allocate idmap mounts list");
+
+	for (mntpath = strtok_r(mntlist, ",", &saveptr); mntpath; mntpath = strtok_r(NULL, ",", &saveptr)) {
+		fd = idmapped_tree(mntpath, usernsfd);
+		if (fd < 0)
+			bail("failed to setup ID-mapped mount on %s", mntpath);
+
+		// ID-mapping by itself won't allow the container to write to "/"; must
+		// chown the rootfs dir so that it can write there.
+		if (config->rootfs && strcmp(mntpath, config->rootfs) == 0) {
+			if (fchownat(fd, "", uid, gid, AT_EMPTY_PATH) < 0)
+				bail("failed to chown %s to %u:%u", mntpath, uid, gid);
+		}
+
+		send_fd(sockfd, fd);
+		close(fd);
+	}
+
+	free(mntlist);
+	close(usernsfd);
+}
+
+/*
+ * sysbox-runc: called by stage 1 to receive the ID-mapped mounts prepared by
+ * send_idmap_mounts() and attach them over their original paths. As with
+ * shiftfs, the rootfs is referred to by "." (cwd) since we may no longer have
+ * search permission into its full path; we then chdir into the ID-mapped
+ * rootfs since our cwd still refers to the mount underneath it.
+ */
+static void attach_idmap_mounts(struct nlconfig_t *config, int sockfd)
+{
+	char *saveptr = NULL, *mntlist, *mntpath;
+	bool is_rootfs;
+	int fd;
+
+	mntlist = strndup(config->idmap_mounts, config->idmap_mounts_len);
+	if (!mntlist)
+		bail("failed to allocate idmap mounts list");
+
+	for (mntpath = strtok_r(mntlist, ",", &saveptr); mntpath; mntpath = strtok_r(NULL, ",", &saveptr)) {
+		is_rootfs = config->rootfs && strcmp(mntpath, config->rootfs) == 0;
+
+		fd = receive_fd(sockfd);
+		if (attach_tree(fd, is_rootfs ? "." : mntpath) < 0)
+			bail("failed to attach ID-mapped mount on %s", mntpath);
+		if (is_rootfs && fchdir(fd) < 0)
+			bail("failed to chdir into ID-mapped rootfs");
+		close(fd);
+	}
+
+	free(mntlist);
+}
+
 /* Defined in cloned_binary.c. */
 extern int ensure_cloned_binary(void);
 
+/*
+ * sysbox-runc: CPU and memory placement. The container's cpuset only applies
+ * to the init once it's in its cgroup, by which time it (and the nsexec stages
+ * before it) may have allocated memory on another NUMA node. So stage 1 moves
+ * itself to the container's CPUs and memory nodes before forking stage 2,
+ * which (along with the Go runtime that follows) inherits them. The init
+ * restores the caller's once it's in the cgroup (see restorePlacement() on the
+ * Go side), so that they don't outlive an update of the cpuset.
+ *
+ * This is best effort: the cgroup's cpuset is what's enforced eventually.
+ */
+#define MAX_PLACEMENT_CPUS	8192
+#define MAX_PLACEMENT_NODES	1024
+#define LONG_BITS		(8 * sizeof(unsigned long))
+
+/* Not in the uapi headers of older kernels. */
+#define NSEXEC_MPOL_PREFERRED		1
+#define NSEXEC_MPOL_PREFERRED_MANY	5
+
+/*
+ * Parses a cpuset list ("0-3,8,10-11", as in cpuset.cpus and cpuset.mems)
+ * into @mask, which has room for @nbits bits. Returns the highest bit set plus
+ * one, or -1 if the list is invalid or doesn't fit.
+ */
+static int parse_list(const char *list, unsigned long *mask, size_t nbits)
+{
+	const char *p = list;
+	unsigned long lo, hi;
+	char *end;
+	int max = 0;
+
+	memset(mask, 0, nbits / 8);
+	while (*p) {
+		lo = hi = strtoul(p, &end, 10);
+		if (end == p)
+			return -1;
+		if (*end == '-') {
+			p = end + 1;
+			hi = strtoul(p, &end, 10);
+			if (end == p || hi < lo)
+				return -1;
+		}
+		if (hi >= nbits)
+			return -1;
+		for (; lo <= hi; lo++)
+			mask[lo / LONG_BITS] |= 1UL << (lo % LONG_BITS);
+		if (hi + 1 > max)
+			max = hi + 1;
+
+		p = end;
+		if (*p == ',')
+			p++;
+		else if (*p == '\n')
+			break;
+		else if (*p)
+			return -1;
+	}
+	return max;
+}
+
+static void set_placement(struct nlconfig_t *config)
+{
+	static unsigned long cpus[MAX_PLACEMENT_CPUS / LONG_BITS];
+	static unsigned long nodes[MAX_PLACEMENT_NODES / LONG_BITS];
+	int max, i, n = 0;
+
+	if (config->cpuset_cpus) {
+		max = parse_list(config->cpuset_cpus, cpus, MAX_PLACEMENT_CPUS);
+		if (max <= 0)
+			write_log(WARNING, "ignoring invalid cpuset cpus %s", config->cpuset_cpus);
+		else if (sched_setaffinity(0, (max + LONG_BITS - 1) / LONG_BITS * sizeof(unsigned long),
+					   (cpu_set_t *) cpus) < 0)
+			write_log(DEBUG, "unable to set CPU affinity to %s: %m", config->cpuset_cpus);
+	}
+
+	if (config->cpuset_mems) {
+		max = parse_list(config->cpuset_mems, nodes, MAX_PLACEMENT_NODES);
+		if (max <= 0) {
+			write_log(WARNING, "ignoring invalid cpuset mems %s", config->cpuset_mems);
+			return;
+		}
+
+		/*
+		 * Prefer (rather than bind to) the nodes, so that the policy never
+		 * gets in the way of the cgroup's cpuset.mems (e.g., once it's
+		 * updated). The kernel ignores the last bit of the node mask, hence
+		 * the +1.
+		 */
+		if (syscall(SYS_set_mempolicy, NSEXEC_MPOL_PREFERRED_MANY, nodes, max + 1) == 0)
+			return;
+
+		/* Kernels before 5.15 can only prefer a single node. */
+		for (i = 0; i < max; i++)
+			if (nodes[i / LONG_BITS] & (1UL << (i % LONG_BITS)))
+				n++;
+		if (n != 1 || syscall(SYS_set_mempolicy, NSEXEC_MPOL_PREFERRED, nodes, max + 1) < 0)
+			write_log(DEBUG, "unable to set memory policy to nodes %s: %m", config->cpuset_mems);
+	}
+}
+
+/*
+ * sysbox-runc: batch exec. When our parent asks for several processes at once
+ * (see StartBatch() on the Go side), stage 1 joins the namespaces once and then
+ * forks one stage 2 per process, rather than one stage 0 and 1 per process.
+ * Each process comes with its own init pipe and stdio (BATCH_FDS_ATTR, as
+ * "initpipe:stdin:stdout:stderr,..." fd numbers), which its stage 2 moves in
+ * place of ours before returning to the Go runtime.
+ */
+struct batch_proc_t {
+	int fds[4];		/* init pipe, stdin, stdout, stderr */
+};
+
+static struct batch_proc_t *batch;
+static int batch_len = 0;	/* 0 unless this is a batch */
+static int batch_index = -1;	/* the process of the batch a stage 2 is for */
+
+static void parse_batch(struct nlconfig_t *config)
+{
+	char *saveptr = NULL, *proc;
+	int n = 1, i;
+
+	if (!config->batch_fds || config->batch_fds_len == 0)
+		return;
+
+	for (i = 0; i < config->batch_fds_len && config->batch_fds[i]; i++)
+		if (config->batch_fds[i] == ',')
+			n++;
+	batch = calloc(n, sizeof(*batch));
+	if (!batch)
+		bail("failed to allocate batch");
+
+	for (proc = strtok_r(config->batch_fds, ",", &saveptr); proc; proc = strtok_r(NULL, ",", &saveptr)) {
+		struct batch_proc_t *b = &batch[batch_len];
+
+		if (batch_len == n ||
+		    sscanf(proc, "%d:%d:%d:%d", &b->fds[0], &b->fds[1], &b->fds[2], &b->fds[3]) != 4)
+			bail("invalid batch process %s", proc);
+		batch_len++;
+	}
+	if (batch_len == 0)
+		bail("batch is empty");
+}
+
+/*
+ * Called by the stage 2 of a batch process to take its own init pipe (in
+ * place of ours, as _LIBCONTAINER_INITPIPE says) and stdio, and to close those
+ * of the other processes.
+ */
+static void setup_batch_proc(int pipenum)
+{
+	struct batch_proc_t *b = &batch[batch_index];
+	int i, j;
+
+	if (dup2(b->fds[0], pipenum) < 0)
+		bail("failed to set up init pipe of batch process %d", batch_index);
+	for (i = 0; i < 3; i++) {
+		if (dup2(b->fds[i + 1], i) < 0)
+			bail("failed to set up stdio of batch process %d", batch_index);
+	}
+
+	for (i = 0; i < batch_len; i++)
+		for (j = 0; j < 4; j++)
+			if (batch[i].fds[j] > 2 && batch[i].fds[j] != pipenum)
+				close(batch[i].fds[j]);
+}
+
+/*
+ * Sends the pids of the @n stage 2 processes we've created to stage 0,
+ * followed by SYNC_CHILD_READY, in one go.
+ */
+static int send_pids(int fd, pid_t *pids, int n)
+{
+	struct sync_msg_t *msgs;
+	struct iovec *iov;
+	struct mmsghdr *mmsgs;
+	int i, sent = 0, ret;
+
+	msgs = calloc(n + 1, sizeof(*msgs));
+	iov = calloc(n + 1, sizeof(*iov));
+	mmsgs = calloc(n + 1, sizeof(*mmsgs));
+	if (!msgs || !iov || !mmsgs)
+		bail("failed to allocate sync messages");
+
+	for (i = 0; i <= n; i++) {
+		msgs[i].type = i < n ? SYNC_RECVPID_PLS : SYNC_CHILD_READY;
+		msgs[i].pid = i < n ? pids[i] : 0;
+		iov[i] = (struct iovec) { .iov_base = &msgs[i], .iov_len = sizeof(msgs[i]) };
+		mmsgs[i].msg_hdr.msg_iov = &iov[i];
+		mmsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* sendmmsg() may send fewer messages than asked when the socket's full. */
+	while (sent <= n) {
+		ret = sendmmsg(fd, mmsgs + sent, n + 1 - sent, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		sent += ret;
+	}
+
+	free(msgs);
+	free(iov);
+	free(mmsgs);
+	return sent == n + 1 ? 0 : -1;
+}
+
+/*
+ * Sends the pids of a batch to our parent, along with the pid of the first
+ * child (see SYNC_RECVPID_PLS). "pid" is that of the first process, as for a
+ * single exec.
+ */
+static int report_batch_pids(int pipenum, pid_t *pids, int n, pid_t first_child, bool into_cgroup)
+{
+	char buf[4096];
+	int i, len;
+
+	len = snprintf(buf, sizeof(buf), "{\"pid\": %d, \"pid_first\": %d, \"into_cgroup\": %s, \"pids\": [",
+		       pids[0], first_child, into_cgroup ? "true" : "false");
+	for (i = 0; i < n && len < sizeof(buf); i++)
+		len += snprintf(buf + len, sizeof(buf) - len, "%s%d", i ? ", " : "", pids[i]);
+	if (len < sizeof(buf))
+		len += snprintf(buf + len, sizeof(buf) - len, "]}\n");
+	if (len >= sizeof(buf)) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	return write(pipenum, buf, len) == len ? len : -1;
+}
+
+/*
+ * Kills the @npids stage 2 processes whose pids stage 0 has received (all of
+ * a batch's), or the stage 1 @child if it hasn't received any yet.
+ */
+static void kill_children(pid_t child, pid_t *pids, int npids)
+{
+	int i;
+
+	if (npids == 0) {
+		kill(child, SIGKILL);
+		return;
+	}
+	for (i = 0; i < npids; i++)
+		kill(pids[i], SIGKILL);
+}
+
 void nsexec(void)
 {
 	int pipenum;
 	jmp_buf env;
 	int sync_child_pipe[2], sync_grandchild_pipe[2];
 	struct nlconfig_t config = { 0 };
+	uint64_t t;
 
 	/*
 	 * Setup a pipe to send logs to the parent. This should happen
@@ -669,6 +1672,14 @@ void nsexec(void)
 	if (pipenum == -1)
 		return;
 
+	/* sysbox-runc: remember when we started, across the re-exec below. */
+	if (!getenv(NSEXEC_START_ENV)) {
+		char start[32];
+
+		snprintf(start, sizeof(start), "%llu", (unsigned long long)now_ns());
+		setenv(NSEXEC_START_ENV, start, 1);
+	}
+
 	/*
 	 * We need to re-exec if we are not in a cloned binary. This is necessary
 	 * to ensure that containers won't be able to access the host binary
@@ -677,10 +1688,20 @@ void nsexec(void)
 	if (ensure_cloned_binary() < 0)
 		bail("could not ensure we are a cloned binary");
 
+	/* sysbox-runc: before we join any namespace; see procfd. */
+	setup_procfd();
+
+	timings_init();
+	if (timings)
+		timing_record(0, "cloned_binary", timings->base);
+
 	write_log(DEBUG, "nsexec started");
 
 	/* Parse all of the netlink configuration. */
+	t = now_ns();
 	nl_parse(pipenum, &config);
+	parse_batch(&config);
+	timing_record(0, "nl_parse", t);
 
 	/* Set oom_score_adj. This has to be done before !dumpable because
 	 * /proc/self/oom_score_adj is not writeable unless you're an privileged
@@ -714,18 +1735,20 @@ void nsexec(void)
 	}
 
 	/* Pipe so we can tell the child when we've finished setting up. */
-	if (socketpair(AF_LOCAL, SOCK_STREAM, 0, sync_child_pipe) < 0)
+	if (socketpair(AF_LOCAL, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sync_child_pipe) < 0)
 		bail("failed to setup sync pipe between parent and child");
 
 	/*
 	 * We need a new socketpair to sync with grandchild so we don't have
 	 * race condition with child.
+	 *
+	 * sysbox-runc: each stage closes the ends of these it doesn't use as
+	 * soon as it can, so that the death of a peer is seen as EOF (see
+	 * sync_recv()).
 	 */
-	if (socketpair(AF_LOCAL, SOCK_STREAM, 0, sync_grandchild_pipe) < 0)
+	if (socketpair(AF_LOCAL, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sync_grandchild_pipe) < 0)
 		bail("failed to setup sync pipe between parent and grandchild");
 
-	/* TODO: Currently we aren't dealing with child deaths properly. */
-
 	/*
 	 * Okay, so this is quite annoying.
 	 *
@@ -782,17 +1805,48 @@ void nsexec(void)
 		 *          process.
 		 */
 	case JUMP_PARENT:{
-			int len;
+			int len, i;
 			pid_t child, first_child = -1;
 			bool ready = false;
+			bool into_cgroup = false;
+			/* sysbox-runc: the stage 2 pids (one per batch process). */
+			int nprocs = batch_len ? batch_len : 1, npids = 0;
+			pid_t *pids;
+
+			PROBE1(nsexec_stage_enter, 0);
+
+			pids = calloc(nprocs, sizeof(*pids));
+			if (!pids)
+				bail("failed to allocate pids");
 
 			/* For debugging. */
 			prctl(PR_SET_NAME, (unsigned long)"runc:[0:PARENT]", 0, 0, 0);
 
-			/* Start the process of getting a container. */
-			child = clone_parent(&env, JUMP_CHILD);
+			/*
+			 * Start the process of getting a container.
+			 *
+			 * sysbox-runc: if we've been given a cgroup, have the child (and
+			 * thus the init, which inherits it) born into it. Otherwise (or if
+			 * the kernel can't do that) our parent moves the init there once
+			 * it knows its pid.
+			 */
+			t = now_ns();
+			child = -1;
+			if (config.cgroup_fd >= 0) {
+				child = clone_parent_into_cgroup(&env, JUMP_CHILD, config.cgroup_fd);
+				if (child < 0)
+					write_log(DEBUG, "unable to clone into cgroup, falling back to clone: %m");
+				into_cgroup = (child >= 0);
+			}
+			if (child < 0)
+				child = clone_parent(&env, JUMP_CHILD);
 			if (child < 0)
 				bail("unable to fork: child_func");
+			if (config.cgroup_fd >= 0)
+				close(config.cgroup_fd);
+			if (config.ns_pidfd >= 0)
+				close(config.ns_pidfd);
+			timing_record(0, "clone_child", t);
 
 			/*
 			 * State machine for synchronisation with the children.
@@ -803,15 +1857,20 @@ void nsexec(void)
 			 */
 			syncfd = sync_child_pipe[1];
 			close(sync_child_pipe[0]);
+			close(sync_grandchild_pipe[0]);
 
 			while (!ready) {
-				enum sync_t s;
+				struct sync_msg_t msg;
 
-				if (read(syncfd, &s, sizeof(s)) != sizeof(s))
+				if (sync_recv(syncfd, &msg) < 0) {
+					kill_children(child, pids, npids);
 					bail("failed to sync with child: next state");
+				}
+
+				switch (msg.type) {
+				case SYNC_USERMAP_PLS:{
+					int childfd;
 
-				switch (s) {
-				case SYNC_USERMAP_PLS:
 					/*
 					 * Enable setgroups(2) if we've been asked to. But we also
 					 * have to explicitly disable setgroups(2) if we're
@@ -823,35 +1882,41 @@ void nsexec(void)
 					 * newuidmap/newgidmap shall be used.
 					 */
 
+					t = now_ns();
+					childfd = open_procdir(child);
 					if (config.is_rootless_euid && !config.is_setgroup)
-						update_setgroups(child, SETGROUPS_DENY);
+						update_setgroups(child, childfd, SETGROUPS_DENY);
 
-					update_uidmap(config.uidmappath, child, config.uidmap, config.uidmap_len);
-					update_gidmap(config.gidmappath, child, config.gidmap, config.gidmap_len);
+					update_idmaps(&config, child, childfd);
+					timing_record(0, "usermap", t);
 
-					s = SYNC_USERMAP_ACK;
-					if (write(syncfd, &s, sizeof(s)) != sizeof(s)) {
-						kill(child, SIGKILL);
+					if (sync_send(syncfd, SYNC_USERMAP_ACK, 0) < 0) {
+						kill_children(child, pids, npids);
 						bail("failed to sync with child: write(SYNC_USERMAP_ACK)");
 					}
-					break;
 
-				case SYNC_RECVPID_PLS:{
-					first_child = child;
-
-					/* Get the init_func pid. */
-					if (read(syncfd, &child, sizeof(child)) != sizeof(child)) {
-						kill(first_child, SIGKILL);
-						bail("failed to sync with child: read(childpid)");
+					/* sysbox-runc: ID-map the rootfs with the child's new mappings. */
+					if (config.idmap_mounts_len > 0) {
+						t = now_ns();
+						send_idmap_mounts(&config, child, childfd, syncfd);
+						timing_record(0, "idmap_mounts", t);
 					}
+					close(childfd);
+					break;
+				}
 
-					/* Send ACK. */
-					s = SYNC_RECVPID_ACK;
-					if (write(syncfd, &s, sizeof(s)) != sizeof(s)) {
-						kill(first_child, SIGKILL);
-						kill(child, SIGKILL);
-						bail("failed to sync with child: write(SYNC_RECVPID_ACK)");
-					}
+				case SYNC_RECVPID_PLS:{
+					/* The init_func pid comes along with the message. */
+					if (first_child < 0)
+						first_child = child;
+					child = msg.pid;
+					if (npids == nprocs)
+						bail("child sent more pids than processes");
+					pids[npids++] = child;
+
+					/* sysbox-runc: a batch is reported once we have all of its pids. */
+					if (npids < nprocs)
+						break;
 
 					/* Send the init_func pid back to our parent.
 					 *
@@ -859,48 +1924,63 @@ void nsexec(void)
 					 * We need to send both back because we can't reap the first child we created (CLONE_PARENT).
 					 * It becomes the responsibility of our parent to reap the first child.
 					 */
-					len = dprintf(pipenum, "{\"pid\": %d, \"pid_first\": %d}\n", child, first_child);
+					if (batch_len)
+						len = report_batch_pids(pipenum, pids, npids, first_child, into_cgroup);
+					else
+						len = dprintf(pipenum, "{\"pid\": %d, \"pid_first\": %d, \"into_cgroup\": %s}\n", child,
+							      first_child, into_cgroup ? "true" : "false");
 					if (len < 0) {
-						kill(child, SIGKILL);
+						kill_children(child, pids, npids);
 						bail("unable to generate JSON for child pid");
 					}
+
+					/*
+					 * sysbox-runc: the grandchild only waits for its pid to
+					 * have been sent to our parent, so let it go right away
+					 * rather than after the child is done.
+					 */
+					for (i = 0; i < nprocs; i++) {
+						if (sync_send(sync_grandchild_pipe[1], SYNC_GRANDCHILD, 0) < 0) {
+							kill_children(child, pids, npids);
+							bail("failed to sync with child: write(SYNC_GRANDCHILD)");
+						}
+					}
 				}
 					break;
 				case SYNC_CHILD_READY:
 					ready = true;
 					break;
 				default:
-					bail("unexpected sync value: %u", s);
+					bail("unexpected sync value: %u", msg.type);
 				}
 			}
 
-			/* Now sync with grandchild. */
-
-			syncfd = sync_grandchild_pipe[1];
-			close(sync_grandchild_pipe[0]);
+			if (first_child < 0 || npids < nprocs)
+				bail("child is ready but did not send the grandchild pid");
 
-			ready = false;
-			while (!ready) {
-				enum sync_t s;
+			/* Now sync with grandchild (or, for a batch, all of them). */
 
-				s = SYNC_GRANDCHILD;
-				if (write(syncfd, &s, sizeof(s)) != sizeof(s)) {
-					kill(child, SIGKILL);
-					bail("failed to sync with child: write(SYNC_GRANDCHILD)");
-				}
-
-				if (read(syncfd, &s, sizeof(s)) != sizeof(s))
-					bail("failed to sync with child: next state");
+			close(sync_child_pipe[1]);
+			syncfd = sync_grandchild_pipe[1];
+			for (i = 0; i < nprocs; i++) {
+				struct sync_msg_t msg;
 
-				switch (s) {
-				case SYNC_CHILD_READY:
-					ready = true;
-					break;
-				default:
-					bail("unexpected sync value: %u", s);
+				if (sync_recv(syncfd, &msg) < 0) {
+					kill_children(child, pids, npids);
+					bail("failed to sync with grandchild: next state");
 				}
+				if (msg.type != SYNC_CHILD_READY)
+					bail("unexpected sync value: %u", msg.type);
 			}
 
+			/*
+			 * sysbox-runc: the stage 2s of a batch don't have our init pipe
+			 * (see setup_batch_proc()), so we report the timings for them.
+			 */
+			if (batch_len)
+				report_timings(pipenum);
+
+			PROBE1(nsexec_stage_exit, 0);
 			exit(0);
 	}
 
@@ -914,27 +1994,50 @@ void nsexec(void)
 		 *          child's PID to our parent (stage 0).
 		 */
 	case JUMP_CHILD:{
-			pid_t child;
-			enum sync_t s;
+			pid_t child, *pids;
+			struct sync_msg_t msg;
+			int nprocs, i;
          bool new_userns = false;
 			bool make_parent_priv_done = false;
 			bool shiftfs_mounts_done = false;
 
+			PROBE1(nsexec_stage_enter, 1);
+
 			/* We're in a child and thus need to tell the parent if we die. */
 			syncfd = sync_child_pipe[0];
 			close(sync_child_pipe[1]);
+			sync_child_pipe[1] = -1;
+			close(sync_grandchild_pipe[1]);
+			sync_grandchild_pipe[1] = -1;
 
 			/* For debugging. */
 			prctl(PR_SET_NAME, (unsigned long)"runc:[1:CHILD]", 0, 0, 0);
 
+			/* sysbox-runc: the cgroup fd must not leak into the container. */
+			if (config.cgroup_fd >= 0)
+				close(config.cgroup_fd);
+
 			/*
 			 * We need to setns first. We cannot do this earlier (in stage 0)
 			 * because of the fact that we forked to get here (the PID of
 			 * [stage 2: JUMP_INIT]) would be meaningless). We could send it
 			 * using cmsg(3) but that's just annoying.
 			 */
-			if (config.namespaces)
-				join_namespaces(config.namespaces);
+			if (config.namespaces) {
+				t = now_ns();
+				PROBE1(join_namespaces_enter, config.ns_pidfd);
+				if (config.ns_pidfd < 0 || join_namespaces_pidfd(config.ns_pidfd, config.namespaces) < 0) {
+					if (config.ns_pidfd >= 0)
+						write_log(DEBUG, "unable to setns via pidfd, falling back to ns paths: %m");
+					join_namespaces(config.namespaces);
+				}
+				PROBE0(join_namespaces_exit);
+				timing_record(1, "join_namespaces", t);
+			}
+
+			/* sysbox-runc: the pidfd must not leak into the container. */
+			if (config.ns_pidfd >= 0)
+				close(config.ns_pidfd);
 
 			/*
 			 * Deal with user namespaces first. They are quite special, as they
@@ -956,8 +2059,10 @@ void nsexec(void)
 			 * problem.
 			 */
 			if (config.cloneflags & CLONE_NEWUSER) {
-				if (unshare(CLONE_NEWUSER) < 0)
+				t = now_ns();
+				if (unshare_ns(CLONE_NEWUSER) < 0)
 					bail("failed to unshare user namespace");
+				timing_record(1, "unshare_user", t);
 
             config.cloneflags &= ~CLONE_NEWUSER;
             new_userns = true;
@@ -968,8 +2073,10 @@ void nsexec(void)
 			 * step).
 			 */
 			if (config.cloneflags & CLONE_NEWNS) {
-				if (unshare(CLONE_NEWNS) < 0)
+				t = now_ns();
+				if (unshare_ns(CLONE_NEWNS) < 0)
 					bail("failed to unshare mount namespace");
+				timing_record(1, "unshare_mnt", t);
 
 				config.cloneflags &= ~CLONE_NEWNS;
 			}
@@ -983,9 +2090,11 @@ void nsexec(void)
 			// *before* uid(gid) mappings for the container's user-ns are set, as
 			// otherwise we may loose permission to perform the mounts (i.e., the
 			// bind mount sources may not longer be accessible once the user-ns
-			// mappings are configured).
+			// mappings are configured). For the same reason the container can't
+			// join a user-ns that was created and mapped ahead of time.
 
 			if (config.prep_rootfs) {
+				t = now_ns();
 				if (mount("", "/", "", (unsigned long)(config.rootfs_prop), "") < 0)
 					bail("failed to set rootfs mount propagation");
 
@@ -1004,6 +2113,7 @@ void nsexec(void)
 					if (mount_shiftfs(&config) == 0)
 						shiftfs_mounts_done = true;
 				}
+				timing_record(1, "prep_rootfs", t);
 			}
 
 			/*
@@ -1019,16 +2129,28 @@ void nsexec(void)
 					bail("failed to set process as dumpable");
 			  }
 
-			  s = SYNC_USERMAP_PLS;
-			  if (write(syncfd, &s, sizeof(s)) != sizeof(s))
+			  t = now_ns();
+			  if (sync_send(syncfd, SYNC_USERMAP_PLS, 0) < 0)
 				 bail("failed to sync with parent: write(SYNC_USERMAP_PLS)");
 
 			  /* ... wait for mapping ... */
 
-			  if (read(syncfd, &s, sizeof(s)) != sizeof(s))
+			  if (sync_recv(syncfd, &msg) < 0)
 				 bail("failed to sync with parent: read(SYNC_USERMAP_ACK)");
-			  if (s != SYNC_USERMAP_ACK)
-				 bail("failed to sync with parent: SYNC_USERMAP_ACK: got %u", s);
+			  if (msg.type != SYNC_USERMAP_ACK)
+				 bail("failed to sync with parent: SYNC_USERMAP_ACK: got %u", msg.type);
+			  timing_record(1, "usermap_wait", t);
+
+			  /*
+			   * sysbox-runc: we are dumpable here (and won't be after the
+			   * setresuid() below), so set the configured oom score adjustment
+			   * now rather than in stage 2, which inherits it; that spares stage
+			   * 2 a dumpable toggle of its own.
+			   */
+			  t = now_ns();
+			  update_oom_score_adj(config.oom_score_adj, config.oom_score_adj_len);
+			  oom_score_adj_done = true;
+			  timing_record(1, "oom_score_adj", t);
 
 			  /* Switching is only necessary if we joined namespaces. */
 			  if (config.namespaces) {
@@ -1047,6 +2169,7 @@ void nsexec(void)
 			 * permission to do so).
 			 */
 
+			t = now_ns();
 			if (config.make_parent_priv && !make_parent_priv_done) {
 				if (mount("", config.parent_mount, "", MS_PRIVATE, "") < 0)
 					bail("failed to set rootfs parent mount propagation to private");
@@ -1060,6 +2183,19 @@ void nsexec(void)
 					bail("failed to setup shiftfs mounts");
 				}
 			}
+			if ((config.make_parent_priv && !make_parent_priv_done) || (config.prep_rootfs && !shiftfs_mounts_done))
+				timing_record(1, "prep_rootfs_mapped", t);
+
+			/*
+			 * sysbox-runc: attach the ID-mapped mounts our parent prepared (see
+			 * send_idmap_mounts()). This goes after the bind-to-self mount on the
+			 * rootfs so that the ID-mapped rootfs stacks on top of it.
+			 */
+			if (new_userns && config.idmap_mounts_len > 0) {
+				t = now_ns();
+				attach_idmap_mounts(&config, syncfd);
+				timing_record(1, "idmap_mounts", t);
+			}
 
 			/*
 			 * Unshare the remaining namespaces (except the cgroup ns
@@ -1072,8 +2208,10 @@ void nsexec(void)
 			 * some old kernel versions where clone(CLONE_PARENT | CLONE_NEWPID)
 			 * was broken, so we'll just do it the long way anyway.
 			 */
-			if (unshare(config.cloneflags & ~CLONE_NEWCGROUP) < 0)
+			t = now_ns();
+			if (unshare_ns(config.cloneflags & ~CLONE_NEWCGROUP) < 0)
 			  bail("failed to unshare namespaces");
+			timing_record(1, "unshare", t);
 
 			/*
 			 * TODO: What about non-namespace clone flags that we're dropping here?
@@ -1084,39 +2222,51 @@ void nsexec(void)
 			 * which would break many applications and libraries, so we must fork
 			 * to actually enter the new PID namespace.
 			 */
-			child = clone_parent(&env, JUMP_INIT);
-			if (child < 0)
-				bail("unable to fork: init_func");
-
-			/* Send the child to our parent, which knows what it's doing. */
-			s = SYNC_RECVPID_PLS;
-			if (write(syncfd, &s, sizeof(s)) != sizeof(s)) {
-				kill(child, SIGKILL);
-				bail("failed to sync with parent: write(SYNC_RECVPID_PLS)");
-			}
-			if (write(syncfd, &child, sizeof(child)) != sizeof(child)) {
-				kill(child, SIGKILL);
-				bail("failed to sync with parent: write(childpid)");
+			/*
+			 * sysbox-runc: set the placement of stage 2 (and the init that
+			 * follows) before forking it, so that it allocates all of its
+			 * memory where the container's cpuset wants it.
+			 */
+			if (config.cpuset_cpus || config.cpuset_mems) {
+				t = now_ns();
+				set_placement(&config);
+				timing_record(1, "placement", t);
 			}
 
-			/* ... wait for parent to get the pid ... */
-
-			if (read(syncfd, &s, sizeof(s)) != sizeof(s)) {
-				kill(child, SIGKILL);
-				bail("failed to sync with parent: read(SYNC_RECVPID_ACK)");
-			}
-			if (s != SYNC_RECVPID_ACK) {
-				kill(child, SIGKILL);
-				bail("failed to sync with parent: SYNC_RECVPID_ACK: got %u", s);
+			t = now_ns();
+			nprocs = batch_len ? batch_len : 1;
+			pids = calloc(nprocs, sizeof(*pids));
+			if (!pids)
+				bail("failed to allocate pids");
+			for (i = 0; i < nprocs; i++) {
+				/* sysbox-runc: tell the stage 2 which batch process it's for. */
+				batch_index = i;
+				child = clone_parent(&env, JUMP_INIT);
+				if (child < 0)
+					bail("unable to fork: init_func");
+				pids[i] = child;
 			}
+			close(sync_grandchild_pipe[0]);
+			timing_record(1, "clone_init", t);
 
-			s = SYNC_CHILD_READY;
-			if (write(syncfd, &s, sizeof(s)) != sizeof(s)) {
-				kill(child, SIGKILL);
-				bail("failed to sync with parent: write(SYNC_CHILD_READY)");
+			/*
+			 * Send the child to our parent, which knows what it's doing.
+			 *
+			 * sysbox-runc: that's all we had left to do, so we say we're ready in
+			 * the same go. The messages stay queued on the socket after we exit,
+			 * so there's no need to wait for our parent to ack the pid.
+			 *
+			 * This isn't timed: once the pids are sent, stage 2 may report the
+			 * timings before we could record it.
+			 */
+			if (send_pids(syncfd, pids, nprocs) < 0) {
+				for (i = 0; i < nprocs; i++)
+					kill(pids[i], SIGKILL);
+				bail("failed to sync with parent: write(SYNC_RECVPID_PLS, SYNC_CHILD_READY)");
 			}
 
 			/* Our work is done. [Stage 2: JUMP_INIT] is doing the rest of the work. */
+			PROBE1(nsexec_stage_exit, 1);
 			exit(0);
 		}
 
@@ -1131,42 +2281,56 @@ void nsexec(void)
 			 * We're inside the child now, having jumped from the
 			 * start_child() code after forking in the parent.
 			 */
-			enum sync_t s;
+			struct sync_msg_t msg;
 
-			/* We're in a child and thus need to tell the parent if we die. */
+			PROBE1(nsexec_stage_enter, 2);
+
+			/*
+			 * We're in a child and thus need to tell the parent if we die.
+			 * (The sync ends we don't use were closed by stage 1 already.)
+			 */
 			syncfd = sync_grandchild_pipe[0];
-			close(sync_grandchild_pipe[1]);
 			close(sync_child_pipe[0]);
-			close(sync_child_pipe[1]);
 
 			/* For debugging. */
 			prctl(PR_SET_NAME, (unsigned long)"runc:[2:INIT]", 0, 0, 0);
 
+			if (batch_len)
+				setup_batch_proc(pipenum);
+
 			/*
 			 * sysbox-runc: set the oom score adjustment to the
-			 * configured value.  Note that this operation relies on
-			 * /proc being mounted (which should be the case both when
-			 * creating a new container and when joining one).  Also, we
+			 * configured value, unless stage 1 did it already (when it
+			 * created a user-ns). This goes through procfd, so it doesn't
+			 * depend on /proc being mounted where we are.  Also, we
 			 * have to temporarily set dumpable because it may have been
-			 * reset to 0 when we created the user-ns and its uid(gid)s
-			 * were mapped (which in turn removes permissions to access
-			 * /proc when creating a new container as described in
-			 * procfs(5)).
+			 * reset to 0 when we joined the user-ns (which in turn
+			 * removes permissions to access /proc as described in
+			 * procfs(5)). Either way, we end up non-dumpable.
 			 */
-			if (prctl(PR_SET_DUMPABLE, 1, 0, 0, 0) < 0)
-				bail("failed to set process as dumpable");
+			if (oom_score_adj_done) {
+				if (prctl(PR_SET_DUMPABLE, 0, 0, 0, 0) < 0)
+					bail("failed to set process as dumpable");
+			} else {
+				t = now_ns();
+				if (prctl(PR_SET_DUMPABLE, 1, 0, 0, 0) < 0)
+					bail("failed to set process as dumpable");
 
-			update_oom_score_adj(config.oom_score_adj, config.oom_score_adj_len);
+				update_oom_score_adj(config.oom_score_adj, config.oom_score_adj_len);
 
-			if (prctl(PR_SET_DUMPABLE, 0, 0, 0, 0) < 0)
-				bail("failed to set process as dumpable");
+				if (prctl(PR_SET_DUMPABLE, 0, 0, 0, 0) < 0)
+					bail("failed to set process as dumpable");
+				timing_record(2, "oom_score_adj", t);
+			}
 
 			/* Perform the sync with our grandparent */
-			if (read(syncfd, &s, sizeof(s)) != sizeof(s))
+			t = now_ns();
+			if (sync_recv(syncfd, &msg) < 0)
 				bail("failed to sync with parent: read(SYNC_GRANDCHILD)");
 
-			if (s != SYNC_GRANDCHILD)
-				bail("failed to sync with parent: SYNC_GRANDCHILD: got %u", s);
+			if (msg.type != SYNC_GRANDCHILD)
+				bail("failed to sync with parent: SYNC_GRANDCHILD: got %u", msg.type);
+			timing_record(2, "grandchild_wait", t);
 
 			if (setsid() < 0)
 				bail("setsid failed");
@@ -1182,29 +2346,53 @@ void nsexec(void)
 					bail("setgroups failed");
 			}
 
-			/* ... wait until our topmost parent has finished cgroup setup in p.manager.Apply() ... */
+			/*
+			 * ... wait until our topmost parent has finished cgroup setup in p.manager.Apply() ...
+			 *
+			 * sysbox-runc: unless we've been told that we already are in our final
+			 * cgroup (in which case our parent doesn't send CREATECGROUPNS).
+			 */
 			if (config.cloneflags & CLONE_NEWCGROUP) {
-				uint8_t value;
-				if (read(pipenum, &value, sizeof(value)) != sizeof(value))
+				uint8_t value = CREATECGROUPNS;
+				t = now_ns();
+				log_flush();
+				if (!config.cgroupns_nosync && read(pipenum, &value, sizeof(value)) != sizeof(value))
 					bail("read synchronisation value failed");
 				if (value == CREATECGROUPNS) {
-					if (unshare(CLONE_NEWCGROUP) < 0)
+					if (unshare_ns(CLONE_NEWCGROUP) < 0)
 						bail("failed to unshare cgroup namespace");
 				} else
 					bail("received unknown synchronisation value");
+				timing_record(2, "cgroupns", t);
 			}
 
-			s = SYNC_CHILD_READY;
-			if (write(syncfd, &s, sizeof(s)) != sizeof(s))
+			/*
+			 * sysbox-runc: all other stages are done by now (they are waiting for
+			 * SYNC_CHILD_READY or have exited), so report the timings. This must
+			 * happen before we return to the Go runtime, which uses the init
+			 * pipe as well.
+			 */
+			if (!batch_len)
+				report_timings(pipenum);
+
+			if (sync_send(syncfd, SYNC_CHILD_READY, 0) < 0)
 				bail("failed to sync with patent: write(SYNC_CHILD_READY)");
 
 			/* Close sync pipes. */
 			close(sync_grandchild_pipe[0]);
+			syncfd = -1;
 
 			/* Free netlink data. */
 			nl_free(&config);
+			close(procfd);
+			procfd = -1;
 
-			/* Finish executing, let the Go runtime take over. */
+			/*
+			 * Finish executing, let the Go runtime take over (it logs to the same
+			 * pipe, so our records must go out first).
+			 */
+			log_flush();
+			PROBE1(nsexec_stage_exit, 2);
 			return;
 		}
 	default:
@@ -0,0 +1,88 @@
+#ifndef NSENTER_PROBE_H
+#define NSENTER_PROBE_H
+
+/*
+ * sysbox-runc: static tracepoints (USDT probes, as in systemtap's <sys/sdt.h>)
+ * in the nsenter bootstrap and the Go init (see libcontainer/usdt). A probe is
+ * a nop, plus an ELF note telling tracers where the nop is and where to find
+ * its arguments; it costs nothing until a tracer attaches to it, e.g.:
+ *
+ *	bpftrace -e 'usdt:/usr/bin/sysbox-runc:sysbox:nsexec_stage_enter { printf("%d stage %d\n", pid, arg0); }'
+ *
+ * "bpftrace -l 'usdt:/usr/bin/sysbox-runc:*'" lists them. The provider of all
+ * of them is "sysbox". Arguments are passed as longs; strings as pointers (use
+ * str(argN) in bpftrace).
+ *
+ * A probe may also come with a semaphore (declared with PROBE_SEMA()), which
+ * tracers increment while attached to it, so that its caller can skip building
+ * the arguments when nobody's listening (see PROBE_ENABLED()).
+ *
+ * We don't depend on <sys/sdt.h> itself, which isn't always installed. Probes
+ * are only compiled in on x86_64 and aarch64; elsewhere they're no-ops.
+ */
+
+#define _PROBE_SEMA_NAME(name)	sysbox_##name##_semaphore
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+#define _PROBE_ARG(n, x)	[_probe_a##n] "r" ((long)(x))
+
+#define _PROBE(name, sema, args, ...)                                                  \
+	__asm__ __volatile__(                                                          \
+		"990:\tnop\n"                                                          \
+		".pushsection .note.stapsdt,\"?\",\"note\"\n"                          \
+		".balign 4\n"                                                          \
+		".4byte 992f-991f, 994f-993f, 3\n"                                     \
+		"991:\t.asciz \"stapsdt\"\n"                                           \
+		"992:\t.balign 4\n"                                                    \
+		"993:\t.8byte 990b\n"                                                  \
+		".8byte _.stapsdt.base\n"                                              \
+		".8byte " sema "\n"                                                    \
+		".asciz \"sysbox\"\n"                                                  \
+		".asciz \"" #name "\"\n"                                               \
+		".asciz \"" args "\"\n"                                                \
+		"994:\t.balign 4\n"                                                    \
+		".popsection\n"                                                        \
+		".ifndef _.stapsdt.base\n"                                             \
+		".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+		".weak _.stapsdt.base\n"                                               \
+		".hidden _.stapsdt.base\n"                                             \
+		"_.stapsdt.base:\t.space 1\n"                                          \
+		".size _.stapsdt.base, 1\n"                                            \
+		".popsection\n"                                                        \
+		".endif\n"                                                             \
+		: : __VA_ARGS__)
+
+#define PROBE0(name)		_PROBE(name, "0", "")
+#define PROBE1(name, a)		_PROBE(name, "0", "-8@%[_probe_a1]", _PROBE_ARG(1, a))
+#define PROBE2(name, a, b)	_PROBE(name, "0", "-8@%[_probe_a1] -8@%[_probe_a2]", \
+				       _PROBE_ARG(1, a), _PROBE_ARG(2, b))
+#define PROBE3(name, a, b, c)	_PROBE(name, "0", "-8@%[_probe_a1] -8@%[_probe_a2] -8@%[_probe_a3]", \
+				       _PROBE_ARG(1, a), _PROBE_ARG(2, b), _PROBE_ARG(3, c))
+
+/*
+ * Defines the semaphore of probe name (as <sys/sdt.h> does, in the .probes
+ * section), which must then be fired with the PROBEn_SEMA() variants.
+ */
+#define PROBE_SEMA(name)	\
+	__extension__ unsigned short _PROBE_SEMA_NAME(name) __attribute__((used, section(".probes")))
+#define PROBE_ENABLED(name)	__builtin_expect(_PROBE_SEMA_NAME(name) != 0, 0)
+
+#define PROBE0_SEMA(name)	_PROBE(name, "sysbox_" #name "_semaphore", "")
+#define PROBE1_SEMA(name, a)	_PROBE(name, "sysbox_" #name "_semaphore", "-8@%[_probe_a1]", _PROBE_ARG(1, a))
+
+#else
+
+#define PROBE_SEMA(name)	unsigned short _PROBE_SEMA_NAME(name)
+#define PROBE_ENABLED(name)	0
+#define PROBE0_SEMA(name)	do { } while (0)
+#define PROBE1_SEMA(name, a)	do { (void)(a); } while (0)
+
+#define PROBE0(name)		do { } while (0)
+#define PROBE1(name, a)		do { (void)(a); } while (0)
+#define PROBE2(name, a, b)	do { (void)(a); (void)(b); } while (0)
+#define PROBE3(name, a, b, c)	do { (void)(a); (void)(b); (void)(c); } while (0)
+
+#endif
+
+#endif /* NSENTER_PROBE_H */
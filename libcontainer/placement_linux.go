@@ -0,0 +1,224 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"fmt"
+	"io/ioutil"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"unsafe"
+
+	"github.com/opencontainers/runc/libcontainer/configs"
+	"github.com/sirupsen/logrus"
+	"github.com/vishvananda/netlink/nl"
+	"golang.org/x/sys/unix"
+)
+
+// sysbox-runc: sysfs dir with the host's NUMA nodes.
+var numaNodesDir = "/sys/devices/system/node"
+
+// placementData returns the bootstrap attributes that have nsexec place the
+// container's processes on the CPUs and memory nodes of its cpuset before they
+// start running (see set_placement() in nsexec.c), rather than once they've
+// joined the container's cgroup. If the cpuset has CPUs but no memory nodes,
+// the nodes those CPUs are on are used.
+func (c *linuxContainer) placementData() []nl.NetlinkRequestData {
+	if c.config.Cgroups == nil || c.config.Cgroups.Resources == nil {
+		return nil
+	}
+	cpus := c.config.Cgroups.Resources.CpusetCpus
+	mems := c.config.Cgroups.Resources.CpusetMems
+	if mems == "" && cpus != "" {
+		mems = cpuNodes(numaNodesDir, cpus)
+	}
+
+	var data []nl.NetlinkRequestData
+	if cpus != "" {
+		data = append(data, &Bytemsg{
+			Type:  CpusetCpusAttr,
+			Value: []byte(cpus),
+		})
+	}
+	if mems != "" {
+		data = append(data, &Bytemsg{
+			Type:  CpusetMemsAttr,
+			Value: []byte(mems),
+		})
+	}
+	return data
+}
+
+// Sizes of the CPU and memory node masks (as MAX_PLACEMENT_CPUS and
+// MAX_PLACEMENT_NODES in nsexec.c).
+const (
+	maxPlacementCpus  = 8192
+	maxPlacementNodes = 1024
+)
+
+// callerPlacement is the CPU affinity and memory policy of the caller of
+// sysbox-runc, which the container's processes would have inherited if nsexec
+// hadn't placed them (see placementData()).
+type callerPlacement struct {
+	Cpus      []uint64 `json:"cpus"`
+	MemPolicy int32    `json:"mem_policy"`
+	MemNodes  []uint64 `json:"mem_nodes,omitempty"`
+}
+
+func hasPlacement(config *configs.Config) bool {
+	if config.Cgroups == nil || config.Cgroups.Resources == nil {
+		return false
+	}
+	r := config.Cgroups.Resources
+	return r.CpusetCpus != "" || r.CpusetMems != ""
+}
+
+// getCallerPlacement returns the placement of the calling thread (whose
+// affinity and memory policy are those of all of our threads, and thus of the
+// caller), for the container's process to restore (see restorePlacement()).
+// It returns nil if nsexec won't place the process, or if the placement can't
+// be read.
+func getCallerPlacement(config *configs.Config) *callerPlacement {
+	if !hasPlacement(config) {
+		return nil
+	}
+
+	var cpus [maxPlacementCpus / 64]uint64
+	n, _, errno := unix.RawSyscall(unix.SYS_SCHED_GETAFFINITY, 0, unsafe.Sizeof(cpus), uintptr(unsafe.Pointer(&cpus)))
+	if errno != 0 {
+		logrus.Debugf("unable to get CPU affinity: %v", errno)
+		return nil
+	}
+	p := &callerPlacement{Cpus: append([]uint64(nil), cpus[:n/8]...)}
+
+	var nodes [maxPlacementNodes / 64]uint64
+	if _, _, errno := unix.RawSyscall6(unix.SYS_GET_MEMPOLICY, uintptr(unsafe.Pointer(&p.MemPolicy)),
+		uintptr(unsafe.Pointer(&nodes)), maxPlacementNodes, 0, 0, 0); errno != 0 {
+		logrus.Debugf("unable to get memory policy: %v", errno)
+		return nil
+	}
+	for n := len(nodes); n > 0; n-- {
+		if nodes[n-1] != 0 {
+			p.MemNodes = append([]uint64(nil), nodes[:n]...)
+			break
+		}
+	}
+	return p
+}
+
+// restorePlacement undoes the placement nsexec did for the container's process
+// (see placementData()), once the process is in the container's cgroup and
+// thus under its cpuset: it restores the caller's affinity and memory policy,
+// as recorded in the init config. Otherwise, the ones nsexec set would be
+// inherited by the container's processes and outlive changes to the cpuset
+// (e.g., on kernels 6.2 and later, a later "update" that widens the cpuset's
+// CPUs would leave them on the original ones). Both are per-thread, so this
+// must be called from the (locked) thread that execs the process.
+//
+// Like the placement, this is best effort. Without the caller's placement, it
+// falls back to all of the CPUs and the default memory policy.
+func restorePlacement(config *initConfig) {
+	if !hasPlacement(config.Config) {
+		return
+	}
+
+	p := config.Placement
+	if p == nil {
+		// All of the CPUs, of which the kernel keeps those in the cpuset.
+		var mask [maxPlacementCpus / 64]uint64
+		for i := range mask {
+			mask[i] = ^uint64(0)
+		}
+		// MPOL_DEFAULT
+		p = &callerPlacement{Cpus: mask[:]}
+	}
+
+	if len(p.Cpus) > 0 {
+		if _, _, errno := unix.RawSyscall(unix.SYS_SCHED_SETAFFINITY, 0, uintptr(len(p.Cpus)*8), uintptr(unsafe.Pointer(&p.Cpus[0]))); errno != 0 {
+			logrus.Debugf("unable to restore CPU affinity: %v", errno)
+		}
+	}
+	// The kernel ignores the last bit of the node mask, hence the +1.
+	var nodes, maxnode uintptr
+	if len(p.MemNodes) > 0 {
+		nodes = uintptr(unsafe.Pointer(&p.MemNodes[0]))
+		maxnode = uintptr(len(p.MemNodes)*64 + 1)
+	}
+	if _, _, errno := unix.RawSyscall(unix.SYS_SET_MEMPOLICY, uintptr(p.MemPolicy), nodes, maxnode); errno != 0 {
+		logrus.Debugf("unable to restore memory policy: %v", errno)
+	}
+}
+
+// cpuNodes returns the list of the NUMA nodes (in nodesDir) the given CPUs are
+// on. It returns "" if that can't be told, or if the CPUs are on all of the
+// nodes (i.e., there's no point in a memory policy).
+func cpuNodes(nodesDir, cpus string) string {
+	want, err := parseList(cpus)
+	if err != nil {
+		return ""
+	}
+	dirs, err := filepath.Glob(filepath.Join(nodesDir, "node[0-9]*"))
+	if err != nil {
+		return ""
+	}
+
+	var all, nodes []int
+	for _, dir := range dirs {
+		node, err := strconv.Atoi(strings.TrimPrefix(filepath.Base(dir), "node"))
+		if err != nil {
+			continue
+		}
+		data, err := ioutil.ReadFile(filepath.Join(dir, "cpulist"))
+		if err != nil {
+			return ""
+		}
+		nodeCpus, err := parseList(strings.TrimSpace(string(data)))
+		if err != nil {
+			return ""
+		}
+		all = append(all, node)
+		for cpu := range nodeCpus {
+			if want[cpu] {
+				nodes = append(nodes, node)
+				break
+			}
+		}
+	}
+	if len(nodes) == 0 || len(nodes) == len(all) {
+		return ""
+	}
+
+	sort.Ints(nodes)
+	list := make([]string, len(nodes))
+	for i, node := range nodes {
+		list[i] = strconv.Itoa(node)
+	}
+	return strings.Join(list, ",")
+}
+
+// parseList parses a cpuset list (e.g., "0-3,8,10-11") into a set.
+func parseList(list string) (map[int]bool, error) {
+	set := make(map[int]bool)
+	if list == "" {
+		return set, nil
+	}
+	for _, r := range strings.Split(list, ",") {
+		bounds := strings.SplitN(r, "-", 2)
+		lo, err := strconv.Atoi(bounds[0])
+		if err != nil || lo < 0 {
+			return nil, fmt.Errorf("invalid list %q", list)
+		}
+		hi := lo
+		if len(bounds) == 2 {
+			if hi, err = strconv.Atoi(bounds[1]); err != nil || hi < lo {
+				return nil, fmt.Errorf("invalid list %q", list)
+			}
+		}
+		for i := lo; i <= hi; i++ {
+			set[i] = true
+		}
+	}
+	return set, nil
+}
@@ -0,0 +1,106 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"runtime"
+	"testing"
+
+	"github.com/opencontainers/runc/libcontainer/configs"
+	"golang.org/x/sys/unix"
+)
+
+func TestParseList(t *testing.T) {
+	set, err := parseList("0-2,5,7-8")
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, cpu := range []int{0, 1, 2, 5, 7, 8} {
+		if !set[cpu] {
+			t.Errorf("expected %d in the set", cpu)
+		}
+	}
+	if len(set) != 6 {
+		t.Errorf("expected 6 entries, got %v", set)
+	}
+
+	for _, list := range []string{"a", "1-", "3-1", "1,,2", "-1"} {
+		if _, err := parseList(list); err == nil {
+			t.Errorf("expected %q to be invalid", list)
+		}
+	}
+}
+
+func TestCpuNodes(t *testing.T) {
+	dir, err := ioutil.TempDir("", "numa")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	for node, cpus := range map[string]string{"node0": "0-3\n", "node1": "4-7\n", "node2": "8-11\n"} {
+		if err := os.Mkdir(filepath.Join(dir, node), 0755); err != nil {
+			t.Fatal(err)
+		}
+		if err := ioutil.WriteFile(filepath.Join(dir, node, "cpulist"), []byte(cpus), 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+
+	for cpus, expected := range map[string]string{
+		"1-2":    "0",
+		"3-4":    "0,1",
+		"9,4":    "1,2",
+		"0,5,10": "", // all nodes
+		"16":     "", // no node
+		"x":      "",
+	} {
+		if nodes := cpuNodes(dir, cpus); nodes != expected {
+			t.Errorf("cpus %s: expected nodes %q, got %q", cpus, expected, nodes)
+		}
+	}
+}
+
+func TestRestorePlacement(t *testing.T) {
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	var orig unix.CPUSet
+	if err := unix.SchedGetaffinity(0, &orig); err != nil {
+		t.Fatal(err)
+	}
+	defer unix.SchedSetaffinity(0, &orig)
+
+	config := &configs.Config{
+		Cgroups: &configs.Cgroup{
+			Resources: &configs.Resources{CpusetCpus: "0"},
+		},
+	}
+	p := getCallerPlacement(config)
+	if p == nil {
+		t.Fatal("no caller placement")
+	}
+
+	// As nsexec would for the cpuset.
+	var cpu0 unix.CPUSet
+	cpu0.Set(0)
+	if err := unix.SchedSetaffinity(0, &cpu0); err != nil {
+		t.Fatal(err)
+	}
+
+	restorePlacement(&initConfig{Config: config, Placement: p})
+	var cur unix.CPUSet
+	if err := unix.SchedGetaffinity(0, &cur); err != nil {
+		t.Fatal(err)
+	}
+	if cur != orig {
+		t.Fatalf("expected the CPU affinity to be restored to %v, got %v", orig, cur)
+	}
+
+	if getCallerPlacement(&configs.Config{}) != nil {
+		t.Fatal("expected no caller placement without a cpuset")
+	}
+}
@@ -6,7 +6,6 @@ import (
 	"encoding/json"
 	"errors"
 	"fmt"
-	"io"
 	"os"
 	"os/exec"
 	"path/filepath"
@@ -74,9 +73,11 @@ type setnsProcess struct {
 	config          *initConfig
 	fds             []string
 	process         *Process
-	bootstrapData   io.Reader
+	bootstrapData   []byte
 	initProcessPid  int
 	container       *linuxContainer
+	bootstrapFiles  []*os.File
+	intoCgroup      bool
 }
 
 func (p *setnsProcess) startTime() (uint64, error) {
@@ -94,10 +95,13 @@ func (p *setnsProcess) signal(sig os.Signal) error {
 
 func (p *setnsProcess) start() (retErr error) {
 	defer p.messageSockPair.parent.Close()
-	err := p.cmd.Start()
+	err := startCmd(p.cmd)
 	// close the write-side of the pipes (controlled by child)
 	p.messageSockPair.child.Close()
 	p.logFilePair.child.Close()
+	for _, f := range p.bootstrapFiles {
+		f.Close()
+	}
 	if err != nil {
 		return newSystemErrorWithCause(err, "starting setns process")
 	}
@@ -110,14 +114,21 @@ func (p *setnsProcess) start() (retErr error) {
 		}
 	}()
 	if p.bootstrapData != nil {
-		if _, err := io.Copy(p.messageSockPair.parent, p.bootstrapData); err != nil {
+		if err := sendBootstrapData(p.messageSockPair.parent, p.bootstrapData); err != nil {
 			return newSystemErrorWithCause(err, "copying bootstrap data to pipe")
 		}
 	}
 	if err := p.execSetns(); err != nil {
 		return newSystemErrorWithCause(err, "executing setns process")
 	}
-	if len(p.cgroupPaths) > 0 {
+	return p.setup()
+}
+
+// setup sets up the process once nsexec is done with it, and sends it its
+// config.
+func (p *setnsProcess) setup() error {
+	// sysbox-runc: no need to move the process if nsexec created it in its cgroup.
+	if len(p.cgroupPaths) > 0 && !p.intoCgroup {
 		if err := cgroups.EnterPid(p.cgroupPaths, p.pid()); err != nil && !p.rootlessCgroups {
 			// On cgroup v2 + nesting + domain controllers, EnterPid may fail with EBUSY.
 			// https://github.com/opencontainers/runc/issues/2356#issuecomment-621277643
@@ -219,10 +230,14 @@ func (p *setnsProcess) execSetns() error {
 		return newSystemError(&exec.ExitError{ProcessState: status})
 	}
 	var pid *pid
-	if err := json.NewDecoder(p.messageSockPair.parent).Decode(&pid); err != nil {
+	dec := json.NewDecoder(p.messageSockPair.parent)
+	if err := dec.Decode(&pid); err != nil {
 		p.cmd.Wait()
 		return newSystemErrorWithCause(err, "reading pid from init pipe")
 	}
+	if err := readNsexecTimings(dec); err != nil {
+		return newSystemErrorWithCause(err, "reading nsexec timings from init pipe")
+	}
 
 	// Clean up the zombie parent process
 	// On Unix systems FindProcess always succeeds.
@@ -237,9 +252,120 @@ func (p *setnsProcess) execSetns() error {
 	}
 	p.cmd.Process = process
 	p.process.ops = p
+	p.intoCgroup = pid.IntoCgroup
+	return nil
+}
+
+// batchSetnsProcess starts the processes of a batch exec (see StartBatch())
+// with a single nsexec bootstrap: nsexec joins the container's namespaces once
+// and forks one child per process, each with its own init pipe and stdio.
+// Once nsexec is done, each process is set up like any other setns process.
+type batchSetnsProcess struct {
+	cmd             *exec.Cmd
+	messageSockPair filePair
+	logFilePair     filePair
+	bootstrapData   []byte
+	bootstrapFiles  []*os.File
+	procs           []*setnsProcess
+}
+
+func (b *batchSetnsProcess) start() (retErr error) {
+	defer b.messageSockPair.parent.Close()
+	for _, p := range b.procs {
+		defer p.messageSockPair.parent.Close()
+	}
+	err := startCmd(b.cmd)
+	// close the write-side of the pipes (controlled by child)
+	b.messageSockPair.child.Close()
+	b.logFilePair.child.Close()
+	for _, f := range b.bootstrapFiles {
+		f.Close()
+	}
+	for _, p := range b.procs {
+		p.messageSockPair.child.Close()
+	}
+	if err != nil {
+		return newSystemErrorWithCause(err, "starting batch setns process")
+	}
+	defer func() {
+		if retErr != nil {
+			b.terminate()
+		}
+	}()
+	if err := sendBootstrapData(b.messageSockPair.parent, b.bootstrapData); err != nil {
+		return newSystemErrorWithCause(err, "copying bootstrap data to pipe")
+	}
+	if err := b.execSetns(); err != nil {
+		return newSystemErrorWithCause(err, "executing batch setns process")
+	}
+	for _, p := range b.procs {
+		if err := p.setup(); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// execSetns waits on nsexec and receives the pids of the batch's processes.
+func (b *batchSetnsProcess) execSetns() error {
+	status, err := b.cmd.Process.Wait()
+	if err != nil {
+		b.cmd.Wait()
+		return newSystemErrorWithCause(err, "waiting on batch setns process to finish")
+	}
+	if !status.Success() {
+		b.cmd.Wait()
+		return newSystemError(&exec.ExitError{ProcessState: status})
+	}
+	var pid *pid
+	dec := json.NewDecoder(b.messageSockPair.parent)
+	if err := dec.Decode(&pid); err != nil {
+		return newSystemErrorWithCause(err, "reading pids from init pipe")
+	}
+	if err := readNsexecTimings(dec); err != nil {
+		return newSystemErrorWithCause(err, "reading nsexec timings from init pipe")
+	}
+
+	// Clean up the zombie parent process
+	firstChildProcess, _ := os.FindProcess(pid.PidFirstChild)
+	_, _ = firstChildProcess.Wait()
+
+	// Hand the processes over to their setnsProcess, even if we didn't get
+	// all of them, so that terminate() cleans up those we got.
+	for i, p := range b.procs {
+		if i == len(pid.Pids) {
+			break
+		}
+		process, err := os.FindProcess(pid.Pids[i])
+		if err != nil {
+			return err
+		}
+		p.cmd.Process = process
+		p.process.ops = p
+		p.intoCgroup = pid.IntoCgroup
+	}
+	if len(pid.Pids) != len(b.procs) {
+		return newSystemError(fmt.Errorf("expected %d pids from init pipe, got %d", len(b.procs), len(pid.Pids)))
+	}
 	return nil
 }
 
+func (b *batchSetnsProcess) terminate() {
+	// nsexec is gone already, unless we failed before it was done
+	_ = b.cmd.Process.Kill()
+	_, _ = b.cmd.Process.Wait()
+
+	for _, p := range b.procs {
+		if err := ignoreTerminateErrors(p.terminate()); err != nil {
+			logrus.WithError(err).Warn("unable to terminate setnsProcess")
+		}
+	}
+}
+
+func (b *batchSetnsProcess) forwardChildLogs() {
+	go logs.ForwardLogs(b.logFilePair.parent)
+}
+
 // terminate sends a SIGKILL to the forked process for the setns routine then waits to
 // avoid the process becoming a zombie.
 func (p *setnsProcess) terminate() error {
@@ -286,8 +412,9 @@ type initProcess struct {
 	container       *linuxContainer
 	fds             []string
 	process         *Process
-	bootstrapData   io.Reader
+	bootstrapData   []byte
 	sharePidns      bool
+	cgroupnsNoSync  bool
 }
 
 func (p *initProcess) pid() int {
@@ -299,9 +426,9 @@ func (p *initProcess) externalDescriptors() []string {
 }
 
 // getChildPid receives the final child's pid over the provided pipe.
-func (p *initProcess) getChildPid() (int, error) {
+func (p *initProcess) getChildPid(dec *json.Decoder) (int, error) {
 	var pid pid
-	if err := json.NewDecoder(p.messageSockPair.parent).Decode(&pid); err != nil {
+	if err := dec.Decode(&pid); err != nil {
 		p.cmd.Wait()
 		return -1, err
 	}
@@ -316,6 +443,31 @@ func (p *initProcess) getChildPid() (int, error) {
 	return pid.Pid, nil
 }
 
+// readNsexecTimings receives the per-phase timings of the nsexec bootstrap,
+// which follow the child's pid over the init pipe, and logs them as a single
+// structured entry (one field per phase).
+func readNsexecTimings(dec *json.Decoder) error {
+	var t nsexecTimings
+	if err := dec.Decode(&t); err != nil {
+		return err
+	}
+	if !logrus.IsLevelEnabled(logrus.DebugLevel) {
+		return nil
+	}
+
+	var total uint64
+	fields := make(logrus.Fields, len(t.Timings)+1)
+	for _, timing := range t.Timings {
+		fields[fmt.Sprintf("nsexec.%d.%s", timing.Stage, timing.Phase)] = time.Duration(timing.Duration)
+		if end := timing.Start + timing.Duration; end > total {
+			total = end
+		}
+	}
+	fields["nsexec.total"] = time.Duration(total)
+	logrus.WithFields(fields).Debug("nsexec timings")
+	return nil
+}
+
 func (p *initProcess) waitForChildExit(childPid int) error {
 	status, err := p.cmd.Process.Wait()
 	if err != nil {
@@ -338,7 +490,7 @@ func (p *initProcess) waitForChildExit(childPid int) error {
 
 func (p *initProcess) start() (retErr error) {
 	defer p.messageSockPair.parent.Close()
-	err := p.cmd.Start()
+	err := startCmd(p.cmd)
 	p.process.ops = p
 	// close the write-side of the pipes (controlled by child)
 	p.messageSockPair.child.Close()
@@ -361,10 +513,20 @@ func (p *initProcess) start() (retErr error) {
 		}
 	}()
 
+	// sysbox-runc: the host-side setup steps that don't depend on the child's
+	// pid run in the background while nsexec creates the namespaces and the
+	// child; they are joined where their results are needed. The deferred
+	// finish() runs before the cleanup above, so no step is still running when
+	// the cgroups are destroyed.
+	pl := newSetupPipeline()
+	defer pl.finish()
+
 	// Do this before syncing with child so that no children can escape the
 	// cgroup. We don't need to worry about not doing this and not being root
 	// because we'd be using the rootless cgroup manager in that case.
-	if err := p.manager.Apply(p.pid()); err != nil {
+	if err := pl.step("cgroup.apply", func() error {
+		return p.manager.Apply(p.pid())
+	}); err != nil {
 		return newSystemErrorWithCause(err, "applying cgroup configuration for process")
 	}
 
@@ -372,35 +534,67 @@ func (p *initProcess) start() (retErr error) {
 	// the system container's cgroup root. This way the child cgroup will inherit
 	// the cgroup resources. Also, do this before the prestart hook so that the
 	// prestart hook may apply cgroup permissions.
-	if err := p.manager.Set(p.config.Config); err != nil {
-		return newSystemErrorWithCause(err, "setting cgroup config for ready process")
-	}
+	pl.goStep("cgroup.set", func() error {
+		if err := p.manager.Set(p.config.Config); err != nil {
+			return newSystemErrorWithCause(err, "setting cgroup config for ready process")
+		}
+		return nil
+	})
 
 	// sysbox-runc: create a child cgroup that will serve as the system container's
 	// cgroup root.
 	cgType := p.manager.GetType()
 
 	if cgType == cgroups.Cgroup_v1_fs || cgType == cgroups.Cgroup_v1_systemd {
-		if err := p.manager.CreateChildCgroup(p.config.Config); err != nil {
-			return newSystemErrorWithCause(err, "creating container child cgroup")
-		}
+		pl.goStep("cgroup.child", func() error {
+			if err := pl.wait("cgroup.set"); err != nil {
+				return err
+			}
+			if err := p.manager.CreateChildCgroup(p.config.Config); err != nil {
+				return newSystemErrorWithCause(err, "creating container child cgroup")
+			}
+			return nil
+		})
 	}
 
-	if err := p.setupDevSubdir(); err != nil {
-		return newSystemErrorWithCause(err, "setup up dev subdir under rootfs")
-	}
+	pl.goStep("devsubdir", func() error {
+		if err := p.setupDevSubdir(); err != nil {
+			return newSystemErrorWithCause(err, "setup up dev subdir under rootfs")
+		}
+		return nil
+	})
 
 	if p.intelRdtManager != nil {
-		if err := p.intelRdtManager.Apply(p.pid()); err != nil {
-			return newSystemErrorWithCause(err, "applying Intel RDT configuration for process")
-		}
+		pl.goStep("intelrdt.apply", func() error {
+			if err := p.intelRdtManager.Apply(p.pid()); err != nil {
+				return newSystemErrorWithCause(err, "applying Intel RDT configuration for process")
+			}
+			return nil
+		})
 	}
-	if _, err := io.Copy(p.messageSockPair.parent, p.bootstrapData); err != nil {
+
+	// sysbox-runc: the seccomp filters are compiled (or read from the cache)
+	// here rather than when the init config is created, so that it overlaps
+	// with nsexec; they are only needed once the config is sent to the init.
+	pl.goStep("seccomp", func() error {
+		p.container.compileSeccomp(p.config)
+		return nil
+	})
+
+	if err := pl.step("bootstrap", func() error {
+		return sendBootstrapData(p.messageSockPair.parent, p.bootstrapData)
+	}); err != nil {
 		return newSystemErrorWithCause(err, "copying bootstrap data to pipe")
 	}
 
-	childPid, err := p.getChildPid()
-	if err != nil {
+	// The same decoder must be used for the pid and the nsexec timings that
+	// follow it, as it may have buffered (part of) the latter.
+	dec := json.NewDecoder(p.messageSockPair.parent)
+	var childPid int
+	if err := pl.step("nsexec.pid", func() (err error) {
+		childPid, err = p.getChildPid(dec)
+		return err
+	}); err != nil {
 		return newSystemErrorWithCause(err, "getting the final child's pid from pipe")
 	}
 
@@ -413,6 +607,12 @@ func (p *initProcess) start() (retErr error) {
 	}
 	p.setExternalDescriptors(fds)
 
+	// The cgroups must be fully set up before the child joins the child cgroup
+	// or creates its cgroup namespace.
+	if err := pl.wait("cgroup.set", "cgroup.child", "intelrdt.apply"); err != nil {
+		return err
+	}
+
 	// sysbox-runc: place the system container's init process in the child cgroup. Do
 	// this before syncing with child so that no children can escape the cgroup
 	if cgType == cgroups.Cgroup_v1_fs || cgType == cgroups.Cgroup_v1_systemd {
@@ -428,7 +628,7 @@ func (p *initProcess) start() (retErr error) {
 	}
 
 	// Now it's time to setup cgroup namespace
-	if p.config.Config.Namespaces.Contains(configs.NEWCGROUP) && p.config.Config.Namespaces.PathOf(configs.NEWCGROUP) == "" {
+	if p.config.Config.Namespaces.Contains(configs.NEWCGROUP) && p.config.Config.Namespaces.PathOf(configs.NEWCGROUP) == "" && !p.cgroupnsNoSync {
 		if _, err := p.messageSockPair.parent.Write([]byte{createCgroupns}); err != nil {
 			return newSystemErrorWithCause(err, "sending synchronization value to init process")
 		}
@@ -439,6 +639,10 @@ func (p *initProcess) start() (retErr error) {
 		return newSystemErrorWithCause(err, "waiting for our first child to exit")
 	}
 
+	if err := readNsexecTimings(dec); err != nil {
+		return newSystemErrorWithCause(err, "reading nsexec timings from init pipe")
+	}
+
 	if err := p.createNetworkInterfaces(); err != nil {
 		return newSystemErrorWithCause(err, "creating network interfaces")
 	}
@@ -447,6 +651,10 @@ func (p *initProcess) start() (retErr error) {
 		return newSystemErrorWithCause(err, "updating the spec state")
 	}
 
+	if err := pl.wait("devsubdir", "seccomp"); err != nil {
+		return err
+	}
+
 	if err := p.sendConfig(); err != nil {
 		return newSystemErrorWithCause(err, "sending config to init process")
 	}
@@ -529,7 +737,9 @@ func (p *initProcess) start() (retErr error) {
 				}
 			}
 			// Register container with sysbox-fs.
-			if err = p.registerWithSysboxfs(childPid); err != nil {
+			if err = pl.step("sysboxfs.register", func() error {
+				return p.registerWithSysboxfs(childPid)
+			}); err != nil {
 				return err
 			}
 			// Sync with child.
@@ -626,14 +836,19 @@ func (p *initProcess) start() (retErr error) {
 // childPid is obtained and all container mounts are present, but before prestart
 // hooks so that sysbox-fs is ready to respond by the time the hooks run.
 func (p *initProcess) registerWithSysboxfs(childPid int) error {
+	return p.container.registerWithSysboxfs(childPid)
+}
+
+// sysbox-runc: register the container, whose init process is pid, with
+// sysbox-fs (see initProcess.registerWithSysboxfs(); on restore, it's done by
+// criuNotifications()).
+func (c *linuxContainer) registerWithSysboxfs(pid int) error {
 
-	sysFs := p.container.sysFs
+	sysFs := c.sysFs
 	if !sysFs.Enabled() {
 		return nil
 	}
 
-	c := p.container
-
 	procRoPaths := []string{}
 	for _, p := range c.config.ReadonlyPaths {
 		if strings.HasPrefix(p, "/proc") {
@@ -650,7 +865,7 @@ func (p *initProcess) registerWithSysboxfs(childPid int) error {
 
 	info := &sysbox.FsRegInfo{
 		Hostname:      c.config.Hostname,
-		Pid:           childPid,
+		Pid:           pid,
 		Uid:           c.config.UidMappings[0].HostID,
 		Gid:           c.config.GidMappings[0].HostID,
 		IdSize:        c.config.UidMappings[0].Size,
@@ -369,25 +369,22 @@ func (l *linuxRootfsInit) Init() error {
 		usernsPath := "/proc/1/ns/user"
 		fsuidMapFailOnErr := l.reqs[0].FsuidMapFailOnErr
 
-		for _, req := range l.reqs {
+		mounts := make([]*configs.Mount, 0, len(l.reqs))
+		for i := range l.reqs {
+			mounts = append(mounts, &l.reqs[i].Mount)
+		}
+		plan := newMountPlan(rootfs, mounts)
+		defer plan.report()
+
+		for i, req := range l.reqs {
 
-			m := &req.Mount
+			m := mounts[i]
 			mountLabel := req.Label
 
-			if err := doBindMount(rootfs, m); err != nil {
+			if err := plan.steps[i].setup(rootfs); err != nil {
 				return newSystemErrorWithCausef(err, "bind mounting %s to %s", m.Source, m.Destination)
 			}
 
-			// The bind mount won't change mount options, we need remount to make mount options effective.
-			// first check that we have non-default options required before attempting a remount
-			if m.Flags&^(unix.MS_REC|unix.MS_REMOUNT|unix.MS_BIND) != 0 {
-				// only remount if unique mount options are set
-				if err := remount(m); err != nil {
-					return newSystemErrorWithCausef(err, "remount of %s with flags %#x",
-						m.Destination, m.Flags)
-				}
-			}
-
 			// Apply label
 			if m.Relabel != "" {
 				if err := label.Validate(m.Relabel); err != nil {
@@ -56,7 +56,9 @@ func needsSetupDev(config *configs.Config) bool {
 func prepareRootfs(pipe io.ReadWriter, iConfig *initConfig) (err error) {
 	config := iConfig.Config
 
-	if config.RootfsUidShiftType == sh.IDMappedMount {
+	// sysbox-runc: nsexec may have ID-mapped the rootfs already (see
+	// setupIDMappedMounts()).
+	if config.RootfsUidShiftType == sh.IDMappedMount && !rootfsIDMappedByNsexec(config) {
 		if err := doRootfsIDMapping(config, pipe); err != nil {
 			return newSystemErrorWithCause(err, "ID-mapping rootfs")
 		}
@@ -1168,6 +1170,17 @@ func doRootfsIDMapping(config *configs.Config, pipe io.ReadWriter) error {
 	return nil
 }
 
+// sysbox-runc: rootfsIDMappedByNsexec returns true if nsexec ID-mapped the
+// container's rootfs during the init process bootstrap.
+func rootfsIDMappedByNsexec(config *configs.Config) bool {
+	for _, p := range config.IDMappedMounts {
+		if p == config.Rootfs {
+			return true
+		}
+	}
+	return false
+}
+
 // sysbox-runc: doMounts sets up all of the container's mounts as specified in the given config.
 func doMounts(config *configs.Config, pipe io.ReadWriter) error {
 
@@ -1176,9 +1189,11 @@ func doMounts(config *configs.Config, pipe io.ReadWriter) error {
 	// Do non-bind mounts
 	for _, m := range config.Mounts {
 		if m.Device != "bind" {
+			start := time.Now()
 			if err := mountToRootfs(m, config, true, pipe); err != nil {
 				return newSystemErrorWithCausef(err, "mounting %q to rootfs %q at %q", m.Source, config.Rootfs, m.Destination)
 			}
+			logrus.Debugf("%s mount %s -> %s: %v", m.Device, m.Source, m.Destination, time.Since(start))
 
 			// Change ownership of the container's /proc to match the container's
 			// root user. This prevents /proc showing up as nobody:nogroup
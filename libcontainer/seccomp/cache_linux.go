@@ -0,0 +1,218 @@
+// +build linux,cgo,seccomp
+
+package seccomp
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"encoding/hex"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"unsafe"
+
+	libseccomp "github.com/nestybox/sysbox-libs/libseccomp-golang"
+	"github.com/opencontainers/runc/libcontainer/configs"
+
+	"golang.org/x/sys/unix"
+)
+
+// sysbox-runc: seccomp filters are compiled (to BPF programs) once per seccomp
+// config, rather than by the init of every container: the sysbox-runc parent
+// compiles the filter of a config the first time it's used, caches the program
+// in a directory shared by all containers, and passes it to the init, which
+// loads it as is (see LoadSeccompBPF()). Containers with the same seccomp
+// config (i.e., most of them) then share the compiled program.
+
+const (
+	seccompSetModeFilter         = 1      // SECCOMP_SET_MODE_FILTER
+	seccompFilterFlagNewListener = 1 << 3 // SECCOMP_FILTER_FLAG_NEW_LISTENER
+	bpfInstructionSize           = 8      // sizeof(struct sock_filter)
+
+	// The version of the format of the cached programs (and of their keys),
+	// to be bumped whenever either changes.
+	cacheFormat = 2
+)
+
+// buildVersion is the version and commit of the sysbox-runc build (set by the
+// Makefile), which the compiled programs are keyed on: another build may build
+// the filters differently.
+var buildVersion string
+
+// Compile returns the BPF program of the seccomp filter for the given config.
+func Compile(config *configs.Seccomp) ([]byte, error) {
+	filter, _, err := newFilter(config)
+	if err != nil {
+		return nil, err
+	}
+	defer filter.Release()
+
+	fd, err := unix.MemfdCreate("seccomp-bpf", unix.MFD_CLOEXEC)
+	if err != nil {
+		return nil, fmt.Errorf("error creating memfd for seccomp filter: %s", err)
+	}
+	f := os.NewFile(uintptr(fd), "seccomp-bpf")
+	defer f.Close()
+
+	if err := filter.ExportBPF(f); err != nil {
+		return nil, fmt.Errorf("error exporting seccomp filter: %s", err)
+	}
+	if _, err := f.Seek(0, 0); err != nil {
+		return nil, err
+	}
+	prog, err := ioutil.ReadAll(f)
+	if err != nil {
+		return nil, err
+	}
+	if len(prog) == 0 || len(prog)%bpfInstructionSize != 0 {
+		return nil, fmt.Errorf("invalid seccomp filter program (%d bytes)", len(prog))
+	}
+	return prog, nil
+}
+
+// CompileCached returns the BPF program of the seccomp filter for the given
+// config, from the cache in dir if the config's filter was compiled before, or
+// compiling it (and adding it to the cache) otherwise.
+func CompileCached(config *configs.Seccomp, dir string) ([]byte, error) {
+	key, err := cacheKey(config)
+	if err != nil {
+		return nil, err
+	}
+	path := filepath.Join(dir, key+".bpf")
+
+	if data, err := ioutil.ReadFile(path); err == nil {
+		if prog, ok := cachedProgram(data); ok {
+			return prog, nil
+		}
+	}
+
+	prog, err := Compile(config)
+	if err != nil {
+		return nil, err
+	}
+	if err := writeCache(dir, path, prog); err != nil {
+		return nil, fmt.Errorf("error caching seccomp filter: %s", err)
+	}
+	return prog, nil
+}
+
+// A cached program is stored after the SHA-256 checksum of the program, which
+// is verified before the program is used.
+
+// cachedProgram returns the program in the given cache file data, and whether
+// it's valid.
+func cachedProgram(data []byte) ([]byte, bool) {
+	if len(data) < sha256.Size {
+		return nil, false
+	}
+	sum, prog := data[:sha256.Size], data[sha256.Size:]
+	if len(prog) == 0 || len(prog)%bpfInstructionSize != 0 {
+		return nil, false
+	}
+	if actual := sha256.Sum256(prog); !bytes.Equal(sum, actual[:]) {
+		return nil, false
+	}
+	return prog, true
+}
+
+func writeCache(dir, path string, prog []byte) (retErr error) {
+	if err := os.MkdirAll(dir, 0700); err != nil {
+		return err
+	}
+	tmpFile, err := ioutil.TempFile(dir, ".tmp-")
+	if err != nil {
+		return err
+	}
+	defer func() {
+		if retErr != nil {
+			tmpFile.Close()
+			os.Remove(tmpFile.Name())
+		}
+	}()
+	sum := sha256.Sum256(prog)
+	if _, err := tmpFile.Write(append(sum[:], prog...)); err != nil {
+		return err
+	}
+	if err := tmpFile.Close(); err != nil {
+		return err
+	}
+	return os.Rename(tmpFile.Name(), path)
+}
+
+// cacheKey returns the key of the compiled filter of config in the cache: a
+// hash of the config (normalized, so that the order of its syscalls and
+// architectures doesn't matter), and of what else the program depends on: the
+// cache format, the sysbox-runc build (or, if its version isn't known, the
+// identity of its binary), libseccomp and the hot syscalls.
+func cacheKey(config *configs.Seccomp) (string, error) {
+	if config == nil {
+		return "", errors.New("cannot initialize Seccomp - nil config passed")
+	}
+	norm := *config
+	norm.Architectures = append([]string(nil), config.Architectures...)
+	sort.Strings(norm.Architectures)
+	// The rules of a syscall are kept in their order (the sort is stable),
+	// as the filter built from them can depend on it.
+	norm.Syscalls = append([]*configs.Syscall(nil), config.Syscalls...)
+	sort.SliceStable(norm.Syscalls, func(i, j int) bool {
+		if norm.Syscalls[i] == nil || norm.Syscalls[j] == nil {
+			return false
+		}
+		return norm.Syscalls[i].Name < norm.Syscalls[j].Name
+	})
+	data, err := json.Marshal(&norm)
+	if err != nil {
+		return "", err
+	}
+
+	build := buildVersion
+	if build == "" {
+		var st unix.Stat_t
+		if err := unix.Stat("/proc/self/exe", &st); err != nil {
+			return "", err
+		}
+		build = fmt.Sprintf("%x-%x-%x-%x.%x", st.Dev, st.Ino, st.Size, st.Mtim.Sec, st.Mtim.Nsec)
+	}
+
+	major, minor, micro := libseccomp.GetLibraryVersion()
+	h := sha256.New()
+	fmt.Fprintf(h, "format %d\n", cacheFormat)
+	fmt.Fprintf(h, "build %s\n", build)
+	fmt.Fprintf(h, "libseccomp %d.%d.%d %s\n", major, minor, micro, runtime.GOARCH)
+	fmt.Fprintf(h, "hot %q\n", hotSyscalls)
+	h.Write(data)
+	return hex.EncodeToString(h.Sum(nil)), nil
+}
+
+// LoadSeccompBPF loads the given seccomp filter program (as returned by
+// Compile()), the same way LoadSeccomp() loads a filter: the no new privs bit
+// isn't set, and thread sync isn't used. If notify is set, the filter contains
+// a seccomp notify action, and the file descriptor that a tracer process can
+// retrieve its notifications from is returned.
+func LoadSeccompBPF(prog []byte, notify bool) (int32, error) {
+	if len(prog) == 0 || len(prog)%bpfInstructionSize != 0 {
+		return -1, fmt.Errorf("invalid seccomp filter program (%d bytes)", len(prog))
+	}
+	fprog := unix.SockFprog{
+		Len:    uint16(len(prog) / bpfInstructionSize),
+		Filter: (*unix.SockFilter)(unsafe.Pointer(&prog[0])),
+	}
+	flags := uintptr(0)
+	if notify {
+		flags |= seccompFilterFlagNewListener
+	}
+	fd, _, errno := unix.Syscall(unix.SYS_SECCOMP, seccompSetModeFilter, flags, uintptr(unsafe.Pointer(&fprog)))
+	runtime.KeepAlive(prog)
+	if errno != 0 {
+		return -1, fmt.Errorf("error loading seccomp filter into kernel: %s", errno)
+	}
+	if !notify {
+		return -1, nil
+	}
+	return int32(fd), nil
+}
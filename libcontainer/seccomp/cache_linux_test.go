@@ -0,0 +1,129 @@
+// +build linux,cgo,seccomp
+
+package seccomp
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/opencontainers/runc/libcontainer/configs"
+)
+
+func testConfig() *configs.Seccomp {
+	return &configs.Seccomp{
+		DefaultAction: configs.Errno,
+		Architectures: []string{"x86", "amd64"},
+		Syscalls: []*configs.Syscall{
+			{Name: "write", Action: configs.Allow},
+			{Name: "read", Action: configs.Allow},
+			{Name: "personality", Action: configs.Allow, Args: []*configs.Arg{{Index: 0, Value: 8, Op: configs.EqualTo}}},
+		},
+	}
+}
+
+func TestCacheKey(t *testing.T) {
+	config := testConfig()
+	key, err := cacheKey(config)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// The order of the syscalls and architectures doesn't matter.
+	reordered := testConfig()
+	reordered.Architectures[0], reordered.Architectures[1] = reordered.Architectures[1], reordered.Architectures[0]
+	reordered.Syscalls[0], reordered.Syscalls[2] = reordered.Syscalls[2], reordered.Syscalls[0]
+	if k, err := cacheKey(reordered); err != nil || k != key {
+		t.Fatalf("expected key %s for the reordered config, got %s (%v)", key, k, err)
+	}
+	if len(config.Syscalls) != 3 || config.Syscalls[0].Name != "write" {
+		t.Fatal("the config was changed by computing its key")
+	}
+
+	changed := testConfig()
+	changed.Syscalls[2].Args[0].Value = 0
+	if k, err := cacheKey(changed); err != nil || k == key {
+		t.Fatalf("expected a key other than %s for a different config, got %s (%v)", key, k, err)
+	}
+}
+
+func TestCompileCached(t *testing.T) {
+	dir, err := ioutil.TempDir("", "seccomp_cache_test")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+	dir = filepath.Join(dir, "seccomp")
+
+	config := testConfig()
+	prog, err := CompileCached(config, dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	expected, err := Compile(config)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(prog, expected) {
+		t.Fatal("the cached program differs from the compiled one")
+	}
+
+	key, err := cacheKey(config)
+	if err != nil {
+		t.Fatal(err)
+	}
+	path := filepath.Join(dir, key+".bpf")
+	cached, err := ioutil.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if p, ok := cachedProgram(cached); !ok || !bytes.Equal(p, prog) {
+		t.Fatal("the program wasn't cached")
+	}
+
+	// The cached program is used, rather than compiling it again.
+	fake := make([]byte, bpfInstructionSize)
+	sum := sha256.Sum256(fake)
+	if err := ioutil.WriteFile(path, append(sum[:], fake...), 0600); err != nil {
+		t.Fatal(err)
+	}
+	if prog, err := CompileCached(config, dir); err != nil || !bytes.Equal(prog, fake) {
+		t.Fatalf("expected the cached program, got %v (%v)", prog, err)
+	}
+
+	// Unless its checksum doesn't match, in which case it's compiled again.
+	for _, data := range [][]byte{
+		append(sum[:], 1, 2, 3, 4, 5, 6, 7, 8),
+		fake,
+		nil,
+	} {
+		if err := ioutil.WriteFile(path, data, 0600); err != nil {
+			t.Fatal(err)
+		}
+		if prog, err := CompileCached(config, dir); err != nil || !bytes.Equal(prog, expected) {
+			t.Fatalf("expected the compiled program for cache data %v, got %v (%v)", data, prog, err)
+		}
+	}
+}
+
+func TestCacheKeyBuild(t *testing.T) {
+	defer func(v string) { buildVersion = v }(buildVersion)
+
+	config := testConfig()
+	buildVersion = "0.6.0-abcdef"
+	key, err := cacheKey(config)
+	if err != nil {
+		t.Fatal(err)
+	}
+	buildVersion = "0.6.1-123456"
+	if k, err := cacheKey(config); err != nil || k == key {
+		t.Fatalf("expected a key other than %s for another build, got %s (%v)", key, k, err)
+	}
+	buildVersion = ""
+	if k, err := cacheKey(config); err != nil || k == key {
+		t.Fatalf("expected a key other than %s for an unversioned build, got %s (%v)", key, k, err)
+	}
+}
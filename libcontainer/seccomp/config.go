@@ -76,3 +76,16 @@ func ConvertStringToArch(in string) (string, error) {
 	}
 	return "", fmt.Errorf("string %s is not a valid arch for seccomp", in)
 }
+
+// HasNotify returns whether the given config contains a seccomp notify action.
+func HasNotify(config *configs.Seccomp) bool {
+	if config == nil {
+		return false
+	}
+	for _, call := range config.Syscalls {
+		if call != nil && call.Action == configs.Notify {
+			return true
+		}
+	}
+	return false
+}
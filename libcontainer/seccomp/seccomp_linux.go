@@ -36,70 +36,144 @@ const (
 func LoadSeccomp(config *configs.Seccomp) (int32, error) {
 	var notifyFd libseccomp.ScmpFd
 
+	filter, notify, err := newFilter(config)
+	if err != nil {
+		return -1, err
+	}
+
+	if err = filter.Load(); err != nil {
+		return -1, fmt.Errorf("error loading seccomp filter into kernel: %s", err)
+	}
+
+	// If the filter contains a notify action, get the notification file-descriptor
+	if notify {
+		fd, err := filter.GetNotifFd()
+		if err != nil {
+			return -1, fmt.Errorf("error getting filter notification fd: %s", err)
+		}
+		notifyFd = fd
+	}
+
+	return int32(notifyFd), nil
+}
+
+// newFilter builds the seccomp filter for the given seccomp config. Returns
+// whether the filter contains a seccomp notify action.
+func newFilter(config *configs.Seccomp) (*libseccomp.ScmpFilter, bool, error) {
 	if config == nil {
-		return -1, errors.New("cannot initialize Seccomp - nil config passed")
+		return nil, false, errors.New("cannot initialize Seccomp - nil config passed")
 	}
 
 	defaultAction, err := getAction(config.DefaultAction, nil)
 	if err != nil {
-		return -1, errors.New("error initializing seccomp - invalid default action")
+		return nil, false, errors.New("error initializing seccomp - invalid default action")
 	}
 
 	filter, err := libseccomp.NewFilter(defaultAction)
 	if err != nil {
-		return -1, fmt.Errorf("error creating filter: %s", err)
+		return nil, false, fmt.Errorf("error creating filter: %s", err)
 	}
 
 	// Add extra architectures
 	for _, arch := range config.Architectures {
 		scmpArch, err := libseccomp.GetArchFromString(arch)
 		if err != nil {
-			return -1, fmt.Errorf("error validating Seccomp architecture: %s", err)
+			return nil, false, fmt.Errorf("error validating Seccomp architecture: %s", err)
 		}
 
 		if err := filter.AddArch(scmpArch); err != nil {
-			return -1, fmt.Errorf("error adding architecture to seccomp filter: %s", err)
+			return nil, false, fmt.Errorf("error adding architecture to seccomp filter: %s", err)
 		}
 	}
 
 	// Unset no new privs bit (i.e., libseccomp won't touch it when loading the filter)
 	if err := filter.SetNoNewPrivsBit(false); err != nil {
-		return -1, fmt.Errorf("error setting no new privileges: %s", err)
+		return nil, false, fmt.Errorf("error setting no new privileges: %s", err)
 	}
 
 	// Add a rule for each syscall
 	notify := false
 	for _, call := range config.Syscalls {
 		if call == nil {
-			return -1, errors.New("encountered nil syscall while initializing Seccomp")
+			return nil, false, errors.New("encountered nil syscall while initializing Seccomp")
 		}
 
 		if call.Action == configs.Notify && notify == false {
 			if err := prepNotify(filter); err != nil {
-				return -1, fmt.Errorf("error preparing seccomp notifications: %s", err)
+				return nil, false, fmt.Errorf("error preparing seccomp notifications: %s", err)
 			}
 			notify = true
 		}
 
 		if err = matchCall(filter, call); err != nil {
-			return -1, err
+			return nil, false, err
 		}
 	}
 
-	if err = filter.Load(); err != nil {
-		return -1, fmt.Errorf("error loading seccomp filter into kernel: %s", err)
-	}
+	setHotSyscallPriorities(filter)
 
-	// If the filter contains a notify action, get the notification file-descriptor
-	if notify {
-		fd, err := filter.GetNotifFd()
+	return filter, notify, nil
+}
+
+// sysbox-runc: hotSyscalls are the syscalls most workloads make the most, from
+// the hottest down. The filter checks the syscalls it has rules for in order of
+// priority (and then of syscall number), so these are given the highest
+// priorities for most syscalls made in the container to be matched by the
+// first few checks of the filter, rather than after walking most of it.
+var hotSyscalls = []string{
+	"read",
+	"write",
+	"futex",
+	"epoll_wait",
+	"epoll_pwait",
+	"recvfrom",
+	"sendto",
+	"recvmsg",
+	"sendmsg",
+	"poll",
+	"ppoll",
+	"nanosleep",
+	"clock_nanosleep",
+	"clock_gettime",
+	"gettimeofday",
+	"writev",
+	"readv",
+	"pread64",
+	"pwrite64",
+	"lseek",
+	"fstat",
+	"newfstatat",
+	"statx",
+	"openat",
+	"close",
+	"mmap",
+	"munmap",
+	"mprotect",
+	"brk",
+	"madvise",
+	"sched_yield",
+	"getpid",
+	"gettid",
+	"rt_sigprocmask",
+	"rt_sigreturn",
+	"select",
+	"pselect6",
+	"epoll_ctl",
+	"accept4",
+	"ioctl",
+}
+
+// setHotSyscallPriorities gives the hot syscalls the highest priorities in
+// filter. A priority is only a hint (and has no effect on syscalls that the
+// filter has no rules for), so errors are ignored.
+func setHotSyscallPriorities(filter *libseccomp.ScmpFilter) {
+	for i, name := range hotSyscalls {
+		call, err := libseccomp.GetSyscallFromName(name)
 		if err != nil {
-			return -1, fmt.Errorf("error getting filter notification fd: %s", err)
+			continue
 		}
-		notifyFd = fd
+		_ = filter.SetSyscallPriority(call, uint8(255-i))
 	}
-
-	return int32(notifyFd), nil
 }
 
 // IsEnabled returns if the kernel has been configured to support seccomp.
@@ -18,6 +18,21 @@ func LoadSeccomp(config *configs.Seccomp) (int32, error) {
 	return -1, nil
 }
 
+// Compile does nothing because seccomp is not supported.
+func Compile(config *configs.Seccomp) ([]byte, error) {
+	return nil, ErrSeccompNotEnabled
+}
+
+// CompileCached does nothing because seccomp is not supported.
+func CompileCached(config *configs.Seccomp, dir string) ([]byte, error) {
+	return nil, ErrSeccompNotEnabled
+}
+
+// LoadSeccompBPF does nothing because seccomp is not supported.
+func LoadSeccompBPF(prog []byte, notify bool) (int32, error) {
+	return -1, ErrSeccompNotEnabled
+}
+
 // IsEnabled returns false, because it is not supported.
 func IsEnabled() bool {
 	return false
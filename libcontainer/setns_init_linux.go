@@ -8,8 +8,8 @@ import (
 
 	"github.com/opencontainers/runc/libcontainer/apparmor"
 	"github.com/opencontainers/runc/libcontainer/keys"
-	"github.com/opencontainers/runc/libcontainer/seccomp"
 	"github.com/opencontainers/runc/libcontainer/system"
+	"github.com/opencontainers/runc/libcontainer/usdt"
 	"github.com/opencontainers/runc/libcontainer/utils"
 	"github.com/opencontainers/selinux/go-selinux"
 	"github.com/pkg/errors"
@@ -32,6 +32,11 @@ func (l *linuxSetnsInit) Init() error {
 	runtime.LockOSThread()
 	defer runtime.UnlockOSThread()
 
+	// sysbox-runc: we're in the container's cgroup by now, so let its cpuset
+	// (and the caller's own placement) decide where we (and the container's
+	// processes) run.
+	restorePlacement(l.config)
+
 	if !l.config.Config.NoNewKeyring {
 		if err := selinux.SetKeyLabel(l.config.ProcessLabel); err != nil {
 			return err
@@ -87,7 +92,7 @@ func (l *linuxSetnsInit) Init() error {
 		}
 
 		if l.config.Config.Seccomp != nil {
-			if _, err := seccomp.LoadSeccomp(l.config.Config.Seccomp); err != nil {
+			if _, err := loadSeccomp(l.config.Config.Seccomp, l.config.SeccompBPF); err != nil {
 				return newSystemErrorWithCause(err, "loading seccomp filtering rules")
 			}
 			seccompFiltDone = true
@@ -110,10 +115,11 @@ func (l *linuxSetnsInit) Init() error {
 		}
 	}
 	if l.config.Config.Seccomp != nil && !seccompFiltDone {
-		if _, err := seccomp.LoadSeccomp(l.config.Config.Seccomp); err != nil {
+		if _, err := loadSeccomp(l.config.Config.Seccomp, l.config.SeccompBPF); err != nil {
 			return newSystemErrorWithCause(err, "loading seccomp filtering rules")
 		}
 	}
 
+	usdt.InitExec(l.config.Args[0])
 	return system.Execv(l.config.Args[0], l.config.Args[0:], os.Environ())
 }
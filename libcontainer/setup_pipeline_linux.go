@@ -0,0 +1,113 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"fmt"
+	"sync"
+	"time"
+
+	"github.com/sirupsen/logrus"
+)
+
+// sysbox-runc: a setupPipeline runs the host-side steps of the setup of a
+// container that are independent of each other (and of the container's init
+// process) concurrently, while nsexec creates the container's namespaces, and
+// joins them where their results are needed (see initProcess.start()). It
+// records when each step started and how long it took, so that the critical
+// path of the setup is visible in the debug log.
+type setupPipeline struct {
+	start time.Time
+
+	mu    sync.Mutex
+	steps map[string]*setupStep
+	order []string
+}
+
+type setupStep struct {
+	done  chan struct{}
+	err   error
+	start time.Duration
+	took  time.Duration
+}
+
+func newSetupPipeline() *setupPipeline {
+	return &setupPipeline{
+		start: time.Now(),
+		steps: make(map[string]*setupStep),
+	}
+}
+
+func (p *setupPipeline) newStep(name string) *setupStep {
+	s := &setupStep{
+		done:  make(chan struct{}),
+		start: time.Since(p.start),
+	}
+	p.mu.Lock()
+	p.steps[name] = s
+	p.order = append(p.order, name)
+	p.mu.Unlock()
+	return s
+}
+
+func (p *setupPipeline) run(s *setupStep, fn func() error) {
+	defer close(s.done)
+	begin := time.Now()
+	s.err = fn()
+	s.took = time.Since(begin)
+}
+
+// goStep starts step name, which runs fn, in the background. Its error is
+// returned by wait().
+func (p *setupPipeline) goStep(name string, fn func() error) {
+	s := p.newStep(name)
+	go p.run(s, fn)
+}
+
+// step runs step name, which runs fn, and returns its error.
+func (p *setupPipeline) step(name string, fn func() error) error {
+	s := p.newStep(name)
+	p.run(s, fn)
+	return s.err
+}
+
+// wait waits for the given steps to finish, and returns the error of the first
+// of them (in argument order) that failed, if any. A step that was never
+// started is taken to have succeeded.
+func (p *setupPipeline) wait(names ...string) error {
+	for _, name := range names {
+		p.mu.Lock()
+		s, ok := p.steps[name]
+		p.mu.Unlock()
+		if !ok {
+			continue
+		}
+		<-s.done
+		if s.err != nil {
+			return s.err
+		}
+	}
+	return nil
+}
+
+// finish waits for all the steps to finish (so that none of them is still
+// running when the setup is undone on failure), and logs their timings.
+func (p *setupPipeline) finish() {
+	p.mu.Lock()
+	order := append([]string(nil), p.order...)
+	p.mu.Unlock()
+	for _, name := range order {
+		<-p.steps[name].done
+	}
+	if !logrus.IsLevelEnabled(logrus.DebugLevel) {
+		return
+	}
+
+	fields := make(logrus.Fields, len(order)+1)
+	for _, name := range order {
+		s := p.steps[name]
+		fields["setup."+name] = fmt.Sprintf("%v (at %v)", s.took, s.start)
+	}
+	fields["setup.total"] = time.Since(p.start)
+	logrus.WithFields(fields).Debug("host setup timings")
+}
@@ -0,0 +1,64 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"errors"
+	"testing"
+	"time"
+)
+
+func TestSetupPipeline(t *testing.T) {
+	errStep := errors.New("step failed")
+	errSerial := errors.New("the steps didn't run concurrently")
+
+	// Each of a, b and d waits for the others to have started, which they
+	// can only do if they run concurrently.
+	aStarted := make(chan struct{})
+	bStarted := make(chan struct{})
+	dStarted := make(chan struct{})
+	waitFor := func(chs ...chan struct{}) error {
+		timeout := time.After(10 * time.Second)
+		for _, ch := range chs {
+			select {
+			case <-ch:
+			case <-timeout:
+				return errSerial
+			}
+		}
+		return nil
+	}
+
+	pl := newSetupPipeline()
+	pl.goStep("a", func() error { close(aStarted); return waitFor(dStarted) })
+	pl.goStep("b", func() error {
+		close(bStarted)
+		if err := waitFor(dStarted); err != nil {
+			return err
+		}
+		return errStep
+	})
+	pl.goStep("c", func() error {
+		if err := pl.wait("a"); err != nil {
+			return err
+		}
+		return nil
+	})
+	if err := pl.step("d", func() error { close(dStarted); return waitFor(aStarted, bStarted) }); err != nil {
+		t.Fatal(err)
+	}
+
+	if err := pl.wait("a", "c", "unknown"); err != nil {
+		t.Fatal(err)
+	}
+	if err := pl.wait("a", "b"); err != errStep {
+		t.Fatalf("expected error %v, got %v", errStep, err)
+	}
+	pl.finish()
+
+	for _, name := range []string{"a", "b", "c", "d"} {
+		if _, ok := pl.steps[name]; !ok {
+			t.Fatalf("step %s not recorded", name)
+		}
+	}
+}
@@ -10,8 +10,8 @@ import (
 	"github.com/opencontainers/runc/libcontainer/apparmor"
 	"github.com/opencontainers/runc/libcontainer/configs"
 	"github.com/opencontainers/runc/libcontainer/keys"
-	"github.com/opencontainers/runc/libcontainer/seccomp"
 	"github.com/opencontainers/runc/libcontainer/system"
+	"github.com/opencontainers/runc/libcontainer/usdt"
 	"github.com/opencontainers/runc/libcontainer/utils"
 	"github.com/opencontainers/runtime-spec/specs-go"
 	"github.com/opencontainers/selinux/go-selinux"
@@ -80,6 +80,11 @@ func (l *linuxStandardInit) Init() error {
 	runtime.LockOSThread()
 	defer runtime.UnlockOSThread()
 
+	// sysbox-runc: we're in the container's cgroup by now, so let its cpuset
+	// (and the caller's own placement) decide where we (and the container's
+	// processes) run.
+	restorePlacement(l.config)
+
 	if err := validateCwd(l.config.Config.Rootfs); err != nil {
 		return newSystemErrorWithCause(err, "validating cwd")
 	}
@@ -242,7 +247,7 @@ func (l *linuxStandardInit) Init() error {
 		}
 
 		if l.config.Config.Seccomp != nil {
-			if _, err := seccomp.LoadSeccomp(l.config.Config.Seccomp); err != nil {
+			if _, err := loadSeccomp(l.config.Config.Seccomp, l.config.SeccompBPF); err != nil {
 				return newSystemErrorWithCause(err, "loading seccomp filtering rules")
 			}
 			seccompFiltDone = true
@@ -311,7 +316,7 @@ func (l *linuxStandardInit) Init() error {
 	// syscalls take place afterward (reducing the amount of syscalls that users need to
 	// enable in their seccomp profiles).
 	if l.config.Config.Seccomp != nil && !seccompFiltDone {
-		if _, err := seccomp.LoadSeccomp(l.config.Config.Seccomp); err != nil {
+		if _, err := loadSeccomp(l.config.Config.Seccomp, l.config.SeccompBPF); err != nil {
 			return newSystemErrorWithCause(err, "loading seccomp filtering rules")
 		}
 	}
@@ -323,6 +328,7 @@ func (l *linuxStandardInit) Init() error {
 		return err
 	}
 
+	usdt.InitExec(name)
 	if err := unix.Exec(name, l.config.Args[0:], os.Environ()); err != nil {
 		return newSystemErrorWithCausef(err, "exec user process: name = %v, args = %v, environ = %v", name, l.config.Args[0:], os.Environ())
 	}
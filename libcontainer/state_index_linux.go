@@ -0,0 +1,263 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/json"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"sort"
+	"syscall"
+	"time"
+
+	"github.com/opencontainers/runc/libcontainer/system"
+	"github.com/opencontainers/runc/libcontainer/utils"
+	"github.com/sirupsen/logrus"
+	"golang.org/x/sys/unix"
+)
+
+// sysbox-runc: the state index is a file in the root directory of the factory
+// with the little of the state of each container that "list" and "state" show,
+// so that they read a single file rather than load the state.json of every
+// container (see ReadStateIndex()).
+//
+// The index is a log of JSON entries, one per line, appended to (atomically,
+// with a single write to the file opened O_APPEND) each time the state of a
+// container is saved, the container is paused or resumed, or it's destroyed;
+// the last entry of a container is its current one. Once the log is large
+// enough it's compacted to the current entries, replacing the file (under an
+// exclusive lock, whereas appends take a shared one).
+const (
+	stateIndexFilename = "state-index.json"
+
+	// The index is compacted when it grows past this size.
+	stateIndexCompactSize = 1 << 20
+)
+
+// StateIndexEntry is the entry of a container in the state index.
+type StateIndexEntry struct {
+	ID                   string            `json:"id"`
+	Version              string            `json:"ociVersion,omitempty"`
+	InitProcessPid       int               `json:"pid,omitempty"`
+	InitProcessStartTime uint64            `json:"pid_start,omitempty"`
+	Status               string            `json:"status,omitempty"`
+	Bundle               string            `json:"bundle,omitempty"`
+	Rootfs               string            `json:"rootfs,omitempty"`
+	Created              time.Time         `json:"created"`
+	Annotations          map[string]string `json:"annotations,omitempty"`
+	Owner                int               `json:"owner"`
+	Removed              bool              `json:"removed,omitempty"`
+}
+
+// CurrentStatus returns the status of the container, checked the way
+// runType() does (based on its init process and exec fifo in containerRoot),
+// except for a paused container which is taken to be paused as long as it's
+// indexed as such, rather than by checking its cgroup.
+func (e *StateIndexEntry) CurrentStatus(containerRoot string) Status {
+	if e.InitProcessPid <= 0 {
+		return Stopped
+	}
+	stat, err := system.Stat(e.InitProcessPid)
+	if err != nil {
+		return Stopped
+	}
+	if stat.StartTime != e.InitProcessStartTime || stat.State == system.Zombie || stat.State == system.Dead {
+		return Stopped
+	}
+	if e.Status == Paused.String() {
+		return Paused
+	}
+	if _, err := os.Stat(filepath.Join(containerRoot, execFifoFilename)); err == nil {
+		return Created
+	}
+	return Running
+}
+
+// ReadStateIndex returns the current entries of the state index in root, by
+// container ID. A root without an index has no entries.
+func ReadStateIndex(root string) (map[string]*StateIndexEntry, error) {
+	data, err := ioutil.ReadFile(filepath.Join(root, stateIndexFilename))
+	if os.IsNotExist(err) {
+		return map[string]*StateIndexEntry{}, nil
+	}
+	if err != nil {
+		return nil, err
+	}
+	return parseStateIndex(data), nil
+}
+
+func parseStateIndex(data []byte) map[string]*StateIndexEntry {
+	entries := make(map[string]*StateIndexEntry)
+	for len(data) > 0 {
+		line := data
+		if i := bytes.IndexByte(data, '\n'); i >= 0 {
+			line, data = data[:i], data[i+1:]
+		} else {
+			// A partial entry, written only in part when its writer died.
+			break
+		}
+		e := &StateIndexEntry{}
+		if err := json.Unmarshal(line, e); err != nil || e.ID == "" {
+			continue
+		}
+		if e.Removed {
+			delete(entries, e.ID)
+			continue
+		}
+		entries[e.ID] = e
+	}
+	return entries
+}
+
+// appendStateIndex appends e to the state index in root.
+func appendStateIndex(root string, e *StateIndexEntry) error {
+	line, err := json.Marshal(e)
+	if err != nil {
+		return err
+	}
+	line = append(line, '\n')
+
+	path := filepath.Join(root, stateIndexFilename)
+	for {
+		f, err := os.OpenFile(path, os.O_WRONLY|os.O_APPEND|os.O_CREATE|unix.O_CLOEXEC, 0600)
+		if err != nil {
+			return err
+		}
+		if err := unix.Flock(int(f.Fd()), unix.LOCK_SH); err != nil {
+			f.Close()
+			return err
+		}
+		// The index may have been compacted (i.e., replaced) since it was opened.
+		if replaced, err := fileReplaced(f, path); err != nil || replaced {
+			f.Close()
+			if err != nil {
+				return err
+			}
+			continue
+		}
+		_, err = f.Write(line)
+		var size int64
+		if fi, serr := f.Stat(); serr == nil {
+			size = fi.Size()
+		}
+		f.Close()
+		if err != nil {
+			return err
+		}
+		if size > stateIndexCompactSize {
+			if err := compactStateIndex(root); err != nil {
+				logrus.Warnf("compacting the state index in %s: %v", root, err)
+			}
+		}
+		return nil
+	}
+}
+
+func fileReplaced(f *os.File, path string) (bool, error) {
+	fi, err := f.Stat()
+	if err != nil {
+		return false, err
+	}
+	pi, err := os.Stat(path)
+	if os.IsNotExist(err) {
+		return true, nil
+	}
+	if err != nil {
+		return false, err
+	}
+	return !os.SameFile(fi, pi), nil
+}
+
+// compactStateIndex rewrites the state index in root with its current entries.
+func compactStateIndex(root string) (retErr error) {
+	path := filepath.Join(root, stateIndexFilename)
+	f, err := os.OpenFile(path, os.O_RDONLY|unix.O_CLOEXEC, 0)
+	if err != nil {
+		return err
+	}
+	defer f.Close()
+	if err := unix.Flock(int(f.Fd()), unix.LOCK_EX); err != nil {
+		return err
+	}
+	if replaced, err := fileReplaced(f, path); err != nil || replaced {
+		// Compacted by someone else meanwhile.
+		return err
+	}
+	data, err := ioutil.ReadAll(f)
+	if err != nil {
+		return err
+	}
+	entries := parseStateIndex(data)
+	ids := make([]string, 0, len(entries))
+	for id := range entries {
+		ids = append(ids, id)
+	}
+	sort.Strings(ids)
+
+	tmpFile, err := ioutil.TempFile(root, "state-index-")
+	if err != nil {
+		return err
+	}
+	defer func() {
+		if retErr != nil {
+			tmpFile.Close()
+			os.Remove(tmpFile.Name())
+		}
+	}()
+	w := bufio.NewWriter(tmpFile)
+	for _, id := range ids {
+		line, err := json.Marshal(entries[id])
+		if err != nil {
+			return err
+		}
+		w.Write(line)
+		w.WriteByte('\n')
+	}
+	if err := w.Flush(); err != nil {
+		return err
+	}
+	if err := tmpFile.Close(); err != nil {
+		return err
+	}
+	return os.Rename(tmpFile.Name(), path)
+}
+
+// newStateIndexEntry returns the state index entry for the container with the
+// given state and status.
+func (c *linuxContainer) newStateIndexEntry(s *State, status Status) *StateIndexEntry {
+	bundle, annotations := utils.Annotations(s.Config.Labels)
+	e := &StateIndexEntry{
+		ID:                   s.ID,
+		Version:              s.Config.Version,
+		InitProcessPid:       s.InitProcessPid,
+		InitProcessStartTime: s.InitProcessStartTime,
+		Status:               status.String(),
+		Bundle:               bundle,
+		Rootfs:               s.Config.Rootfs,
+		Created:              s.Created,
+		Annotations:          annotations,
+	}
+	if fi, err := os.Stat(c.root); err == nil {
+		e.Owner = int(fi.Sys().(*syscall.Stat_t).Uid)
+	}
+	return e
+}
+
+// indexState records the container's state and status in the state index. The
+// index is a cache of the state saved in the container's state.json, so
+// failing to update it isn't an error of the operation that changed the state.
+func (c *linuxContainer) indexState(s *State, status Status) {
+	if err := appendStateIndex(filepath.Dir(c.root), c.newStateIndexEntry(s, status)); err != nil {
+		logrus.Warnf("updating the state index of container %s: %v", c.id, err)
+	}
+}
+
+// unindexState removes the container from the state index.
+func (c *linuxContainer) unindexState() {
+	if err := appendStateIndex(filepath.Dir(c.root), &StateIndexEntry{ID: c.id, Removed: true}); err != nil {
+		logrus.Warnf("removing container %s from the state index: %v", c.id, err)
+	}
+}
@@ -0,0 +1,77 @@
+// +build linux
+
+package libcontainer
+
+import (
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+func TestStateIndex(t *testing.T) {
+	root, err := ioutil.TempDir("", "state_index_test")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(root)
+
+	for _, e := range []*StateIndexEntry{
+		{ID: "a", InitProcessPid: 1, Status: "created"},
+		{ID: "b", InitProcessPid: 2, Status: "running"},
+		{ID: "a", InitProcessPid: 1, Status: "paused"},
+		{ID: "b", Removed: true},
+		{ID: "c", InitProcessPid: 3, Status: "running"},
+	} {
+		if err := appendStateIndex(root, e); err != nil {
+			t.Fatal(err)
+		}
+	}
+
+	// An entry written only in part is ignored.
+	f, err := os.OpenFile(filepath.Join(root, stateIndexFilename), os.O_WRONLY|os.O_APPEND, 0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	f.WriteString(`{"id":"d","pid":4`)
+	f.Close()
+
+	check := func() {
+		index, err := ReadStateIndex(root)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if len(index) != 2 || index["a"] == nil || index["c"] == nil {
+			t.Fatalf("expected containers a and c in the index, got %v", index)
+		}
+		if index["a"].Status != "paused" {
+			t.Fatalf("expected the last entry of a, got %+v", index["a"])
+		}
+	}
+	check()
+
+	if err := compactStateIndex(root); err != nil {
+		t.Fatal(err)
+	}
+	check()
+	data, err := ioutil.ReadFile(filepath.Join(root, stateIndexFilename))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if n := len(parseStateIndex(data)); n != 2 {
+		t.Fatalf("expected 2 entries in the compacted index, got %d", n)
+	}
+}
+
+func TestStateIndexMissing(t *testing.T) {
+	root, err := ioutil.TempDir("", "state_index_test")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(root)
+
+	index, err := ReadStateIndex(root)
+	if err != nil || len(index) != 0 {
+		t.Fatalf("expected an empty index, got %v (%v)", index, err)
+	}
+}
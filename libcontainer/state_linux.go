@@ -55,6 +55,7 @@ func destroy(c *linuxContainer) error {
 	if rerr := os.RemoveAll(c.root); err == nil {
 		err = rerr
 	}
+	c.unindexState()
 	c.initProcess = nil
 	if herr := runPoststopHooks(c); err == nil {
 		err = herr
@@ -6,6 +6,7 @@ import (
 	"fmt"
 	"io"
 
+	"github.com/opencontainers/runc/libcontainer/usdt"
 	"github.com/opencontainers/runc/libcontainer/utils"
 )
 
@@ -63,6 +64,7 @@ type syncT struct {
 // writeSync is used to write to a synchronisation pipe. An error is returned
 // if there was a problem writing the payload.
 func writeSync(pipe io.Writer, sync syncType) error {
+	usdt.SyncWrite(string(sync))
 	return utils.WriteJSON(pipe, syncT{sync})
 }
 
@@ -76,6 +78,7 @@ func readSync(pipe io.Reader, expected syncType) error {
 		}
 		return fmt.Errorf("failed reading error from parent: %v", err)
 	}
+	usdt.SyncRead(string(procSync.Type))
 
 	if procSync.Type == procError {
 		var ierr genericError
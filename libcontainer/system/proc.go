@@ -57,6 +57,17 @@ type Stat_t struct {
 	// State is the state of the process.
 	State State
 
+	// PPID is the parent process ID.
+	PPID uint
+
+	// TTY is the device number of the controlling terminal of the process
+	// (0 if it has none).
+	TTY uint64
+
+	// UTime and STime are the clock ticks the process has been scheduled
+	// in user and kernel mode.
+	UTime, STime uint64
+
 	// StartTime is the number of clock ticks after system boot (since
 	// Linux 2.6).
 	StartTime uint64
@@ -71,6 +82,11 @@ func Stat(pid int) (stat Stat_t, err error) {
 	return parseStat(string(bytes))
 }
 
+// sysbox-runc: ParseStat parses the contents of a /proc/<pid>/stat file.
+func ParseStat(data string) (Stat_t, error) {
+	return parseStat(data)
+}
+
 func parseStat(data string) (stat Stat_t, err error) {
 	// From proc(5), field 2 could contain space and is inside `(` and `)`.
 	// The following is an example:
@@ -98,6 +114,12 @@ func parseStat(data string) (stat Stat_t, err error) {
 	var state int
 	fmt.Sscanf(parts[3-3], "%c", &state)
 	stat.State = State(state)
+	if len(parts) > 22-3 {
+		fmt.Sscanf(parts[4-3], "%d", &stat.PPID)
+		fmt.Sscanf(parts[7-3], "%d", &stat.TTY)
+		fmt.Sscanf(parts[14-3], "%d", &stat.UTime)
+		fmt.Sscanf(parts[15-3], "%d", &stat.STime)
+	}
 	fmt.Sscanf(parts[22-3], "%d", &stat.StartTime)
 	return stat, nil
 }
@@ -8,12 +8,17 @@ func TestParseStartTime(t *testing.T) {
 			PID:       4902,
 			Name:      "gunicorn: maste",
 			State:     'S',
+			PPID:      4885,
+			UTime:     78,
+			STime:     16,
 			StartTime: 9126532,
 		},
 		"9534 (cat) R 9323 9534 9323 34828 9534 4194304 95 0 0 0 0 0 0 0 20 0 1 0 9214966 7626752 168 18446744073709551615 4194304 4240332 140732237651568 140732237650920 140570710391216 0 0 0 0 0 0 0 17 1 0 0 0 0 0 6340112 6341364 21553152 140732237653865 140732237653885 140732237653885 140732237656047 0": {
 			PID:       9534,
 			Name:      "cat",
 			State:     'R',
+			PPID:      9323,
+			TTY:       34828,
 			StartTime: 9214966,
 		},
 
@@ -21,6 +26,7 @@ func TestParseStartTime(t *testing.T) {
 			PID:       24767,
 			Name:      "irq/44-mei_me",
 			State:     'S',
+			PPID:      2,
 			StartTime: 8722075,
 		},
 	}
@@ -38,6 +44,12 @@ func TestParseStartTime(t *testing.T) {
 		if st.Name != expected.Name {
 			t.Fatalf("expected name %q but received %q", expected.Name, st.Name)
 		}
+		if st.PPID != expected.PPID || st.TTY != expected.TTY {
+			t.Fatalf("expected ppid %d and tty %d but received %d and %d", expected.PPID, expected.TTY, st.PPID, st.TTY)
+		}
+		if st.UTime != expected.UTime || st.STime != expected.STime {
+			t.Fatalf("expected times %d/%d but received %d/%d", expected.UTime, expected.STime, st.UTime, st.STime)
+		}
 		if st.StartTime != expected.StartTime {
 			t.Fatalf("expected start time %q but received %q", expected.StartTime, st.StartTime)
 		}
@@ -0,0 +1,21 @@
+// Package usdt has the static tracepoints (USDT probes) of the Go side of the
+// container's bootstrap; they pick up where those of nsenter (see
+// nsenter/probe.h) leave off, so that a trace can follow a container from the
+// sysbox-runc command that creates it all the way to the execve(2) of its
+// process:
+//
+//	cli_start(command)          sysbox-runc runs a command
+//	nsexec_*, sync_send/recv    the nsenter bootstrap (see nsexec.c)
+//	init_start(init type)       the init is back in Go, and has its config
+//	sync_write/read(sync type)  sync messages between the init and its parent
+//	init_finalize()             the init is about to drop its privileges
+//	init_exec(path)             the init is about to exec the process
+//
+// All probes are in the "sysbox" provider, and their string arguments are C
+// strings, e.g.:
+//
+//	bpftrace -e 'usdt:/usr/bin/sysbox-runc:sysbox:init_exec { printf("%d %s\n", pid, str(arg0)); }'
+//
+// Until a tracer attaches to it, a probe is only a check of its semaphore. The
+// probes are no-ops if sysbox-runc is built without cgo.
+package usdt
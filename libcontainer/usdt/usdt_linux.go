@@ -0,0 +1,79 @@
+// +build linux,cgo
+
+package usdt
+
+/*
+#cgo CFLAGS: -I${SRCDIR}/../nsenter
+#include <stdlib.h>
+#include "probe.h"
+
+PROBE_SEMA(cli_start);
+PROBE_SEMA(init_start);
+PROBE_SEMA(sync_write);
+PROBE_SEMA(sync_read);
+PROBE_SEMA(init_finalize);
+PROBE_SEMA(init_exec);
+
+static void probe_cli_start(const char *command) { PROBE1_SEMA(cli_start, command); }
+static void probe_init_start(const char *type) { PROBE1_SEMA(init_start, type); }
+static void probe_sync_write(const char *type) { PROBE1_SEMA(sync_write, type); }
+static void probe_sync_read(const char *type) { PROBE1_SEMA(sync_read, type); }
+static void probe_init_finalize(void) { PROBE0_SEMA(init_finalize); }
+static void probe_init_exec(const char *path) { PROBE1_SEMA(init_exec, path); }
+*/
+import "C"
+
+import "unsafe"
+
+// Each probe checks its semaphore (a plain load, which tracers increment while
+// attached to the probe) before the cgo call, so that an untraced probe costs
+// neither the call nor the C copy of its string argument.
+
+// withCString calls fn with s as a C string.
+func withCString(s string, fn func(*C.char)) {
+	cs := C.CString(s)
+	defer C.free(unsafe.Pointer(cs))
+	fn(cs)
+}
+
+// CliStart fires when sysbox-runc starts running a command.
+func CliStart(command string) {
+	if C.sysbox_cli_start_semaphore != 0 {
+		withCString(command, func(cs *C.char) { C.probe_cli_start(cs) })
+	}
+}
+
+// InitStart fires when the init (of the given type) has read its config.
+func InitStart(initType string) {
+	if C.sysbox_init_start_semaphore != 0 {
+		withCString(initType, func(cs *C.char) { C.probe_init_start(cs) })
+	}
+}
+
+// SyncWrite fires when a sync message is sent to the init's peer.
+func SyncWrite(syncType string) {
+	if C.sysbox_sync_write_semaphore != 0 {
+		withCString(syncType, func(cs *C.char) { C.probe_sync_write(cs) })
+	}
+}
+
+// SyncRead fires when a sync message is received from the init's peer.
+func SyncRead(syncType string) {
+	if C.sysbox_sync_read_semaphore != 0 {
+		withCString(syncType, func(cs *C.char) { C.probe_sync_read(cs) })
+	}
+}
+
+// InitFinalize fires when the init is about to drop its privileges.
+func InitFinalize() {
+	if C.sysbox_init_finalize_semaphore != 0 {
+		C.probe_init_finalize()
+	}
+}
+
+// InitExec fires when the init is about to exec the given path.
+func InitExec(path string) {
+	if C.sysbox_init_exec_semaphore != 0 {
+		withCString(path, func(cs *C.char) { C.probe_init_exec(cs) })
+	}
+}
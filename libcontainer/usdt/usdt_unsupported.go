@@ -0,0 +1,10 @@
+// +build !linux !cgo
+
+package usdt
+
+func CliStart(command string)   {}
+func InitStart(initType string) {}
+func SyncWrite(syncType string) {}
+func SyncRead(syncType string)  {}
+func InitFinalize()             {}
+func InitExec(path string)      {}
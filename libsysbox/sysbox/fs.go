@@ -58,6 +58,7 @@ func (fs *Fs) Enabled() bool {
 }
 
 func (fs *Fs) GetConfig() error {
+	defer ipcCall(fsDaemon, "GetConfig")()
 
 	mp, err := sysboxFsGrpc.GetMountpoint()
 	if err != nil {
@@ -70,6 +71,7 @@ func (fs *Fs) GetConfig() error {
 
 // Pre-registers container with sysbox-fs.
 func (fs *Fs) PreRegister(linuxNamespaces []specs.LinuxNamespace) error {
+	defer ipcCall(fsDaemon, "PreRegister")()
 	if fs.PreReg {
 		return fmt.Errorf("container %v already pre-registered", fs.Id)
 	}
@@ -99,6 +101,7 @@ func (fs *Fs) PreRegister(linuxNamespaces []specs.LinuxNamespace) error {
 
 // Registers container with sysbox-fs.
 func (fs *Fs) Register(info *FsRegInfo) error {
+	defer ipcCall(fsDaemon, "Register")()
 
 	if !fs.PreReg {
 		return fmt.Errorf("container %v was not pre-registered", fs.Id)
@@ -131,6 +134,7 @@ func (fs *Fs) Register(info *FsRegInfo) error {
 
 // Sends container creation time to sysbox-fs
 func (fs *Fs) SendCreationTime(t time.Time) error {
+	defer ipcCall(fsDaemon, "SendCreationTime")()
 	if !fs.Reg {
 		return fmt.Errorf("must register container %v before", fs.Id)
 	}
@@ -147,6 +151,7 @@ func (fs *Fs) SendCreationTime(t time.Time) error {
 // Sends the seccomp-notification fd to sysbox-fs (tracer) to setup syscall
 // trapping and waits for its response (ack).
 func (fs *Fs) SendSeccompInit(pid int, id string, seccompFd int32) error {
+	defer ipcCall(fsDaemon, "SendSeccompInit")()
 
 	// TODO: Think about a better location for this one.
 	const seccompTracerSockAddr = "/run/sysbox/sysfs-seccomp.sock"
@@ -170,6 +175,7 @@ func (fs *Fs) SendSeccompInit(pid int, id string, seccompFd int32) error {
 // Unregisters the container with sysbox-fs
 func (fs *Fs) Unregister() error {
 	if fs.PreReg || fs.Reg {
+		defer ipcCall(fsDaemon, "Unregister")()
 		data := &sysboxFsGrpc.ContainerData{
 			Id: fs.Id,
 		}
@@ -0,0 +1,122 @@
+//
+// Copyright 2019-2020 Nestybox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Latency metrics of the calls to sysbox-mgr and sysbox-fs
+
+package sysbox
+
+import (
+	"sort"
+	"sync"
+	"time"
+
+	"github.com/sirupsen/logrus"
+)
+
+const (
+	mgrDaemon = "sysbox-mgr"
+	fsDaemon  = "sysbox-fs"
+)
+
+// IpcStat is the number of calls made to a sysbox daemon and their latency.
+type IpcStat struct {
+	Calls int
+	Total time.Duration
+	Max   time.Duration
+}
+
+var ipcStats = struct {
+	sync.Mutex
+	daemons map[string]*IpcStat
+}{
+	daemons: make(map[string]*IpcStat),
+}
+
+// ipcCall is called at the start of a call to a sysbox daemon, and returns the
+// function to call at its end, which records (and logs) its latency:
+//
+//	defer ipcCall(mgrDaemon, "Register")()
+func ipcCall(daemon, call string) func() {
+	start := time.Now()
+	return func() {
+		d := time.Since(start)
+		logrus.Debugf("%s %s: %v", daemon, call, d)
+
+		ipcStats.Lock()
+		defer ipcStats.Unlock()
+		st, ok := ipcStats.daemons[daemon]
+		if !ok {
+			st = &IpcStat{}
+			ipcStats.daemons[daemon] = st
+		}
+		st.Calls++
+		st.Total += d
+		if d > st.Max {
+			st.Max = d
+		}
+	}
+}
+
+// IpcStats returns the number and latency of the calls made so far to each
+// sysbox daemon.
+func IpcStats() map[string]IpcStat {
+	ipcStats.Lock()
+	defer ipcStats.Unlock()
+	stats := make(map[string]IpcStat, len(ipcStats.daemons))
+	for daemon, st := range ipcStats.daemons {
+		stats[daemon] = *st
+	}
+	return stats
+}
+
+// LogIpcStats logs (at debug level) the number and latency of the calls made
+// so far to each sysbox daemon.
+func LogIpcStats() {
+	if !logrus.IsLevelEnabled(logrus.DebugLevel) {
+		return
+	}
+	stats := IpcStats()
+	daemons := make([]string, 0, len(stats))
+	for daemon := range stats {
+		daemons = append(daemons, daemon)
+	}
+	sort.Strings(daemons)
+	for _, daemon := range daemons {
+		st := stats[daemon]
+		logrus.Debugf("%s: %d calls in %v (max %v)", daemon, st.Calls, st.Total, st.Max)
+	}
+}
+
+// Parallel runs the given functions concurrently, and returns the error of the
+// first of them (in argument order) that failed, if any.
+func Parallel(fns ...func() error) error {
+	errs := make([]error, len(fns))
+	var wg sync.WaitGroup
+	for i, fn := range fns {
+		wg.Add(1)
+		go func(i int, fn func() error) {
+			defer wg.Done()
+			errs[i] = fn()
+		}(i, fn)
+	}
+	wg.Wait()
+	for _, err := range errs {
+		if err != nil {
+			return err
+		}
+	}
+	return nil
+}
@@ -0,0 +1,90 @@
+//
+// Copyright 2019-2020 Nestybox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+package sysbox
+
+import (
+	"errors"
+	"sync"
+	"testing"
+	"time"
+)
+
+func TestParallel(t *testing.T) {
+	errFirst := errors.New("first")
+	errSecond := errors.New("second")
+	errSerial := errors.New("the functions didn't run concurrently")
+
+	// A barrier that none of the functions gets past until all of them have
+	// started, which they can only do if they run concurrently.
+	var started sync.WaitGroup
+	started.Add(3)
+	all := make(chan struct{})
+	go func() { started.Wait(); close(all) }()
+	barrier := func() error {
+		started.Done()
+		select {
+		case <-all:
+			return nil
+		case <-time.After(10 * time.Second):
+			return errSerial
+		}
+	}
+
+	err := Parallel(
+		func() error { return barrier() },
+		func() error {
+			if err := barrier(); err != nil {
+				return err
+			}
+			return errFirst
+		},
+		func() error {
+			if err := barrier(); err != nil {
+				return err
+			}
+			return errSecond
+		},
+	)
+	if err != errFirst {
+		t.Fatalf("expected error %v, got %v", errFirst, err)
+	}
+
+	if err := Parallel(); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func TestIpcStats(t *testing.T) {
+	const daemon = "test-daemon"
+
+	for i := 0; i < 3; i++ {
+		done := ipcCall(daemon, "Call")
+		time.Sleep(time.Millisecond)
+		done()
+	}
+
+	st, ok := IpcStats()[daemon]
+	if !ok {
+		t.Fatal("no stats for the daemon")
+	}
+	if st.Calls != 3 {
+		t.Fatalf("expected 3 calls, got %d", st.Calls)
+	}
+	if st.Max < time.Millisecond || st.Total < 3*time.Millisecond {
+		t.Fatalf("unexpected latencies %+v", st)
+	}
+}
@@ -53,6 +53,7 @@ func (mgr *Mgr) Enabled() bool {
 // Registers the container with sysbox-mgr. If successful, stores the
 // sysbox configuration tokens for sysbox-runc in mgr.Config
 func (mgr *Mgr) Register(spec *specs.Spec) error {
+	defer ipcCall(mgrDaemon, "Register")()
 	var userns string
 	var netns string
 
@@ -92,6 +93,7 @@ func (mgr *Mgr) Register(spec *specs.Spec) error {
 func (mgr *Mgr) Update(userns, netns string,
 	uidMappings, gidMappings []specs.LinuxIDMapping,
 	rootfsUidShiftType sh.IDShiftType) error {
+	defer ipcCall(mgrDaemon, "Update")()
 
 	updateInfo := &ipcLib.UpdateInfo{
 		Id:                 mgr.Id,
@@ -110,6 +112,7 @@ func (mgr *Mgr) Update(userns, netns string,
 
 // Unregisters the container with sysbox-mgr.
 func (mgr *Mgr) Unregister() error {
+	defer ipcCall(mgrDaemon, "Unregister")()
 	if err := sysboxMgrGrpc.Unregister(mgr.Id); err != nil {
 		return fmt.Errorf("failed to unregister with sysbox-mgr: %v", err)
 	}
@@ -118,6 +121,7 @@ func (mgr *Mgr) Unregister() error {
 
 // ReqSubid requests sysbox-mgr to allocate uid & gids for the container user-ns.
 func (mgr *Mgr) ReqSubid(size uint32) (uint32, uint32, error) {
+	defer ipcCall(mgrDaemon, "ReqSubid")()
 	uid, gid, err := sysboxMgrGrpc.SubidAlloc(mgr.Id, uint64(size))
 	if err != nil {
 		return 0, 0, fmt.Errorf("failed to request subid from sysbox-mgr: %v", err)
@@ -127,6 +131,7 @@ func (mgr *Mgr) ReqSubid(size uint32) (uint32, uint32, error) {
 
 // PrepMounts sends a request to sysbox-mgr for prepare the given  container mounts; all paths must be absolute.
 func (mgr *Mgr) PrepMounts(uid, gid uint32, prepList []ipcLib.MountPrepInfo) error {
+	defer ipcCall(mgrDaemon, "PrepMounts")()
 	if err := sysboxMgrGrpc.PrepMounts(mgr.Id, uid, gid, prepList); err != nil {
 		return fmt.Errorf("failed to request mount source preps from sysbox-mgr: %v", err)
 	}
@@ -135,6 +140,7 @@ func (mgr *Mgr) PrepMounts(uid, gid uint32, prepList []ipcLib.MountPrepInfo) err
 
 // ReqMounts sends a request to sysbox-mgr for container mounts; all paths must be absolute.
 func (mgr *Mgr) ReqMounts(rootfsUidShiftType sh.IDShiftType, reqList []ipcLib.MountReqInfo) ([]specs.Mount, error) {
+	defer ipcCall(mgrDaemon, "ReqMounts")()
 	mounts, err := sysboxMgrGrpc.ReqMounts(mgr.Id, rootfsUidShiftType, reqList)
 	if err != nil {
 		return nil, fmt.Errorf("failed to request mounts from sysbox-mgr: %v", err)
@@ -144,6 +150,7 @@ func (mgr *Mgr) ReqMounts(rootfsUidShiftType sh.IDShiftType, reqList []ipcLib.Mo
 
 // ReqShiftfsMark sends a request to sysbox-mgr to mark shiftfs on the given dirs; all paths must be absolute.
 func (mgr *Mgr) ReqShiftfsMark(mounts []shiftfs.MountPoint) ([]shiftfs.MountPoint, error) {
+	defer ipcCall(mgrDaemon, "ReqShiftfsMark")()
 	resp, err := sysboxMgrGrpc.ReqShiftfsMark(mgr.Id, mounts)
 	if err != nil {
 		return nil, fmt.Errorf("failed to request shiftfs marking to sysbox-mgr: %v", err)
@@ -153,6 +160,7 @@ func (mgr *Mgr) ReqShiftfsMark(mounts []shiftfs.MountPoint) ([]shiftfs.MountPoin
 
 // ReqFsState sends a request to sysbox-mgr for container's rootfs state.
 func (mgr *Mgr) ReqFsState(rootfs string) ([]configs.FsEntry, error) {
+	defer ipcCall(mgrDaemon, "ReqFsState")()
 	state, err := sysboxMgrGrpc.ReqFsState(mgr.Id, rootfs)
 	if err != nil {
 		return nil, fmt.Errorf("failed to request fsState from sysbox-mgr: %v", err)
@@ -162,6 +170,7 @@ func (mgr *Mgr) ReqFsState(rootfs string) ([]configs.FsEntry, error) {
 }
 
 func (mgr *Mgr) Pause() error {
+	defer ipcCall(mgrDaemon, "Pause")()
 	if err := sysboxMgrGrpc.Pause(mgr.Id); err != nil {
 		return fmt.Errorf("failed to notify pause to sysbox-mgr: %v", err)
 	}
@@ -169,6 +178,7 @@ func (mgr *Mgr) Pause() error {
 }
 
 func (mgr *Mgr) Resume() error {
+	defer ipcCall(mgrDaemon, "Resume")()
 	if err := sysboxMgrGrpc.Resume(mgr.Id); err != nil {
 		return fmt.Errorf("failed to notify resume to sysbox-mgr: %v", err)
 	}
@@ -178,6 +188,7 @@ func (mgr *Mgr) Resume() error {
 // ClonedRootfs sends a request to sysbox-mgr to setup an alternate rootfs for the container.
 // It returns the path to the new rootfs.
 func (mgr *Mgr) CloneRootfs() (string, error) {
+	defer ipcCall(mgrDaemon, "CloneRootfs")()
 
 	newRootfs, err := sysboxMgrGrpc.ReqCloneRootfs(mgr.Id)
 	if err != nil {
@@ -191,12 +202,14 @@ func (mgr *Mgr) CloneRootfs() (string, error) {
 // Sends a requests to sysbox-mgr to chown a cloned rootfs, using the
 // given uid and gid offsets. Must call after CloneRootfs().
 func (mgr *Mgr) ChownClonedRootfs(uidOffset, gidOffset int32) error {
+	defer ipcCall(mgrDaemon, "ChownClonedRootfs")()
 	return sysboxMgrGrpc.ChownClonedRootfs(mgr.Id, uidOffset, gidOffset)
 }
 
 // Sends a requests to sysbox-mgr to revert the chown of a cloned rootfs.
 // Must call after ChownClonedRootfs().
 func (mgr *Mgr) RevertClonedRootfsChown() error {
+	defer ipcCall(mgrDaemon, "RevertClonedRootfsChown")()
 	return sysboxMgrGrpc.RevertClonedRootfsChown(mgr.Id)
 }
 
@@ -318,6 +318,11 @@ func cfgNamespaces(sysMgr *sysbox.Mgr, spec *specs.Spec) error {
 }
 
 // allocIDMappings performs uid and gid allocation for the system container
+//
+// Note: the subids can't be reserved ahead of time (e.g., from a pool kept by
+// sysbox-runc for bursts of creates), as sysbox-mgr allocates them to the
+// container's ID and releases them when the container unregisters; a range
+// reserved before the container exists would be owned by no container.
 func allocIDMappings(sysMgr *sysbox.Mgr, spec *specs.Spec) error {
 	var uid, gid uint32
 	var err error
@@ -5,9 +5,9 @@ package main
 import (
 	"errors"
 	"fmt"
-	"io/ioutil"
 	"os"
 	"path/filepath"
+	"sort"
 	"syscall"
 	"text/tabwriter"
 	"time"
@@ -115,62 +115,121 @@ To list containers created using a non-default value for "--root":
 }
 
 func getContainers(context *cli.Context) ([]containerState, error) {
-	factory, err := loadFactory(context, nil, nil)
-	if err != nil {
-		return nil, err
-	}
 	root := context.GlobalString("root")
 	absRoot, err := filepath.Abs(root)
 	if err != nil {
 		return nil, err
 	}
-	list, err := ioutil.ReadDir(absRoot)
+	dir, err := os.Open(absRoot)
+	if err != nil {
+		fatal(err)
+	}
+	names, err := dir.Readdirnames(-1)
+	dir.Close()
 	if err != nil {
 		fatal(err)
 	}
+	sort.Strings(names)
 
-	var s []containerState
-	for _, item := range list {
-		if item.IsDir() {
-			// This cast is safe on Linux.
-			stat := item.Sys().(*syscall.Stat_t)
-			owner, err := user.LookupUid(int(stat.Uid))
-			if err != nil {
-				owner.Name = fmt.Sprintf("#%d", stat.Uid)
-			}
+	// sysbox-runc: the containers in the state index are listed from their
+	// entries in it; only the others (e.g., created by an older sysbox-runc)
+	// are loaded from their state.json.
+	index, err := libcontainer.ReadStateIndex(absRoot)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "read state index: %v\n", err)
+		index = nil
+	}
 
-			container, err := factory.Load(item.Name())
-			if err != nil {
-				fmt.Fprintf(os.Stderr, "load container %s: %v\n", item.Name(), err)
-				continue
-			}
-			containerStatus, err := container.Status()
-			if err != nil {
-				fmt.Fprintf(os.Stderr, "status for %s: %v\n", item.Name(), err)
-				continue
-			}
-			state, err := container.State()
-			if err != nil {
-				fmt.Fprintf(os.Stderr, "state for %s: %v\n", item.Name(), err)
-				continue
-			}
-			pid := state.BaseState.InitProcessPid
-			if containerStatus == libcontainer.Stopped {
-				pid = 0
+	var (
+		factory libcontainer.Factory
+		owners  = make(map[int]string)
+		s       []containerState
+	)
+	for _, name := range names {
+		if e, ok := index[name]; ok {
+			s = append(s, indexedContainerState(e, filepath.Join(absRoot, name), owners))
+			continue
+		}
+
+		item, err := os.Lstat(filepath.Join(absRoot, name))
+		if err != nil || !item.IsDir() {
+			continue
+		}
+		if factory == nil {
+			if factory, err = loadFactory(context, nil, nil); err != nil {
+				return nil, err
 			}
-			bundle, annotations := utils.Annotations(state.Config.Labels)
-			s = append(s, containerState{
-				Version:        state.BaseState.Config.Version,
-				ID:             state.BaseState.ID,
-				InitProcessPid: pid,
-				Status:         containerStatus.String(),
-				Bundle:         bundle,
-				Rootfs:         state.BaseState.Config.Rootfs,
-				Created:        state.BaseState.Created,
-				Annotations:    annotations,
-				Owner:          owner.Name,
-			})
 		}
+		// This cast is safe on Linux.
+		stat := item.Sys().(*syscall.Stat_t)
+		owner := ownerName(int(stat.Uid), owners)
+
+		container, err := factory.Load(name)
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "load container %s: %v\n", name, err)
+			continue
+		}
+		containerStatus, err := container.Status()
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "status for %s: %v\n", name, err)
+			continue
+		}
+		state, err := container.State()
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "state for %s: %v\n", name, err)
+			continue
+		}
+		pid := state.BaseState.InitProcessPid
+		if containerStatus == libcontainer.Stopped {
+			pid = 0
+		}
+		bundle, annotations := utils.Annotations(state.Config.Labels)
+		s = append(s, containerState{
+			Version:        state.BaseState.Config.Version,
+			ID:             state.BaseState.ID,
+			InitProcessPid: pid,
+			Status:         containerStatus.String(),
+			Bundle:         bundle,
+			Rootfs:         state.BaseState.Config.Rootfs,
+			Created:        state.BaseState.Created,
+			Annotations:    annotations,
+			Owner:          owner,
+		})
 	}
 	return s, nil
 }
+
+// indexedContainerState returns the state of the container with the given
+// state index entry and root directory.
+func indexedContainerState(e *libcontainer.StateIndexEntry, containerRoot string, owners map[int]string) containerState {
+	status := e.CurrentStatus(containerRoot)
+	pid := e.InitProcessPid
+	if status == libcontainer.Stopped {
+		pid = 0
+	}
+	return containerState{
+		Version:        e.Version,
+		ID:             e.ID,
+		InitProcessPid: pid,
+		Status:         status.String(),
+		Bundle:         e.Bundle,
+		Rootfs:         e.Rootfs,
+		Created:        e.Created,
+		Annotations:    e.Annotations,
+		Owner:          ownerName(e.Owner, owners),
+	}
+}
+
+// ownerName returns the name of the user with the given uid, looked up once
+// per uid (in owners).
+func ownerName(uid int, owners map[int]string) string {
+	if name, ok := owners[uid]; ok {
+		return name
+	}
+	name := fmt.Sprintf("#%d", uid)
+	if owner, err := user.LookupUid(uid); err == nil {
+		name = owner.Name
+	}
+	owners[uid] = name
+	return name
+}
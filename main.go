@@ -6,6 +6,7 @@ import (
 	"os"
 
 	"github.com/opencontainers/runc/libcontainer/logs"
+	"github.com/opencontainers/runc/libcontainer/usdt"
 	"github.com/opencontainers/runtime-spec/specs-go"
 
 	"github.com/sirupsen/logrus"
@@ -104,6 +105,10 @@ func main() {
 			Name:  "systemd-cgroup",
 			Usage: "enable systemd cgroup support, expects cgroupsPath to be of form \"slice:prefix:name\" for e.g. \"system.slice:runc:434234\"",
 		},
+		cli.BoolFlag{
+			Name:  "shared-cloned-binary",
+			Usage: "re-exec container init processes from a single read-only view of the sysbox-runc binary shared by all invocations (published under the root directory), instead of cloning the binary each time",
+		},
 	}
 
 	app.Commands = []cli.Command{
@@ -141,6 +146,7 @@ func main() {
 		if err := reviseRootDir(context); err != nil {
 			return err
 		}
+		usdt.CliStart(context.Args().First())
 		return logs.ConfigureLogging(createLogConfig(context))
 	}
 
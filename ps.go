@@ -62,7 +62,9 @@ var psCommand = cli.Command{
 		//
 		psArgs := context.Args()[1:]
 		if len(psArgs) == 0 {
-			psArgs = []string{"-ef"}
+			// sysbox-runc: without ps options, list the processes like
+			// "ps -ef" does, without running ps.
+			return printPsNative(os.Stdout, pids)
 		}
 
 		cmd := exec.Command("ps", psArgs...)
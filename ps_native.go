@@ -0,0 +1,235 @@
+// +build linux
+
+package main
+
+import (
+	"bufio"
+	"bytes"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"text/tabwriter"
+	"time"
+
+	"github.com/opencontainers/runc/libcontainer/system"
+	"github.com/opencontainers/runc/libcontainer/user"
+)
+
+// sysbox-runc: the native ps lists the processes of a container the way
+// "ps -ef" does (same columns), but reading /proc only for the container's
+// processes, rather than running ps (which reads /proc for every process on
+// the host) and then filtering its output.
+
+// clockTicks is the unit of the times in /proc/<pid>/stat (USER_HZ, which is
+// 100 on all the architectures Linux supports).
+const clockTicks = 100
+
+// procDir is where the native ps reads the processes' information from.
+var procDir = "/proc"
+
+// psProcess is the information of a process shown by the native ps.
+type psProcess struct {
+	pid  int
+	stat system.Stat_t
+	uid  int
+	cmd  string
+}
+
+// readPsProcess reads the information of process pid from /proc.
+func readPsProcess(pid int) (*psProcess, error) {
+	dir := filepath.Join(procDir, strconv.Itoa(pid))
+	data, err := ioutil.ReadFile(filepath.Join(dir, "stat"))
+	if err != nil {
+		return nil, err
+	}
+	stat, err := system.ParseStat(string(data))
+	if err != nil {
+		return nil, err
+	}
+	p := &psProcess{pid: pid, stat: stat}
+
+	if p.uid, err = readEffectiveUid(filepath.Join(dir, "status")); err != nil {
+		return nil, err
+	}
+
+	cmdline, err := ioutil.ReadFile(filepath.Join(dir, "cmdline"))
+	if err != nil {
+		return nil, err
+	}
+	cmdline = bytes.TrimRight(cmdline, "\x00")
+	if len(cmdline) == 0 {
+		p.cmd = "[" + stat.Name + "]"
+	} else {
+		p.cmd = string(bytes.ReplaceAll(cmdline, []byte{0}, []byte{' '}))
+	}
+	return p, nil
+}
+
+// readEffectiveUid returns the effective uid in the given /proc/<pid>/status
+// file.
+func readEffectiveUid(path string) (int, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return -1, err
+	}
+	defer f.Close()
+	s := bufio.NewScanner(f)
+	for s.Scan() {
+		// Uid:	<real> <effective> <saved> <fs>
+		fields := strings.Fields(s.Text())
+		if len(fields) >= 3 && fields[0] == "Uid:" {
+			return strconv.Atoi(fields[2])
+		}
+	}
+	if err := s.Err(); err != nil {
+		return -1, err
+	}
+	return -1, fmt.Errorf("no Uid in %s", path)
+}
+
+// readPsProcesses reads the information of the given processes, concurrently
+// if there are more than a few. Processes that exit meanwhile are left out.
+func readPsProcesses(pids []int) []*psProcess {
+	procs := make([]*psProcess, len(pids))
+
+	workers := runtime.NumCPU()
+	if workers > len(pids)/8 {
+		workers = len(pids)/8 + 1
+	}
+	next := make(chan int)
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := range next {
+				if p, err := readPsProcess(pids[i]); err == nil {
+					procs[i] = p
+				}
+			}
+		}()
+	}
+	for i := range pids {
+		next <- i
+	}
+	close(next)
+	wg.Wait()
+
+	res := procs[:0]
+	for _, p := range procs {
+		if p != nil {
+			res = append(res, p)
+		}
+	}
+	sort.Slice(res, func(i, j int) bool { return res[i].pid < res[j].pid })
+	return res
+}
+
+// bootTime returns the time the system booted, from /proc/stat.
+func bootTime() (time.Time, error) {
+	f, err := os.Open(filepath.Join(procDir, "stat"))
+	if err != nil {
+		return time.Time{}, err
+	}
+	defer f.Close()
+	s := bufio.NewScanner(f)
+	for s.Scan() {
+		if fields := strings.Fields(s.Text()); len(fields) == 2 && fields[0] == "btime" {
+			secs, err := strconv.ParseInt(fields[1], 10, 64)
+			if err != nil {
+				return time.Time{}, err
+			}
+			return time.Unix(secs, 0), nil
+		}
+	}
+	if err := s.Err(); err != nil {
+		return time.Time{}, err
+	}
+	return time.Time{}, fmt.Errorf("no btime in /proc/stat")
+}
+
+// printPsNative prints the given processes as "ps -ef" does.
+func printPsNative(w io.Writer, pids []int) error {
+	boot, err := bootTime()
+	if err != nil {
+		return err
+	}
+	now := time.Now()
+	users := make(map[int]string)
+
+	tw := tabwriter.NewWriter(w, 5, 1, 1, ' ', 0)
+	fmt.Fprint(tw, "UID\tPID\tPPID\tC\tSTIME\tTTY\tTIME\tCMD\n")
+	for _, p := range readPsProcesses(pids) {
+		name, ok := users[p.uid]
+		if !ok {
+			name = strconv.Itoa(p.uid)
+			if u, err := user.LookupUid(p.uid); err == nil {
+				name = u.Name
+			}
+			users[p.uid] = name
+		}
+
+		start := boot.Add(time.Duration(p.stat.StartTime) * time.Second / clockTicks)
+		cpu := time.Duration(p.stat.UTime+p.stat.STime) * time.Second / clockTicks
+		c := 0
+		if elapsed := now.Sub(start); elapsed > 0 {
+			c = int(cpu * 100 / elapsed)
+		}
+
+		fmt.Fprintf(tw, "%s\t%d\t%d\t%d\t%s\t%s\t%s\t%s\n",
+			name, p.pid, p.stat.PPID, c, psStartTime(start, now), psTTY(p.stat.TTY), psCPUTime(cpu), p.cmd)
+	}
+	return tw.Flush()
+}
+
+// psStartTime formats the start time of a process as ps does: the time of day
+// if it started in the last day, the date if in the last year, the year
+// otherwise.
+func psStartTime(start, now time.Time) string {
+	switch age := now.Sub(start); {
+	case age < 24*time.Hour:
+		return start.Format("15:04")
+	case age < 365*24*time.Hour:
+		return start.Format("Jan02")
+	default:
+		return start.Format("2006")
+	}
+}
+
+// psTTY returns the name of the terminal with the given device number (as
+// /proc/<pid>/stat has it), or "?" if there's none or it's not a pts, console
+// or serial one.
+func psTTY(dev uint64) string {
+	major := (dev >> 8) & 0xfff
+	minor := (dev & 0xff) | ((dev >> 12) & 0xfff00)
+	switch {
+	case dev == 0:
+		return "?"
+	case major >= 136 && major <= 143:
+		return fmt.Sprintf("pts/%d", (major-136)*256+minor)
+	case major == 4 && minor < 64:
+		return fmt.Sprintf("tty%d", minor)
+	case major == 4:
+		return fmt.Sprintf("ttyS%d", minor-64)
+	}
+	return "?"
+}
+
+// psCPUTime formats the cumulative CPU time of a process as ps does:
+// [DD-]HH:MM:SS.
+func psCPUTime(d time.Duration) string {
+	secs := int64(d / time.Second)
+	days, secs := secs/86400, secs%86400
+	s := fmt.Sprintf("%02d:%02d:%02d", secs/3600, secs%3600/60, secs%60)
+	if days > 0 {
+		s = fmt.Sprintf("%d-%s", days, s)
+	}
+	return s
+}
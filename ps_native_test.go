@@ -0,0 +1,182 @@
+// +build linux
+
+package main
+
+import (
+	"fmt"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"strconv"
+	"testing"
+	"time"
+)
+
+func TestPsTTY(t *testing.T) {
+	for _, tc := range []struct {
+		dev  uint64
+		want string
+	}{
+		{0, "?"},
+		{136<<8 | 0, "pts/0"},
+		{136<<8 | 3, "pts/3"},
+		{137<<8 | 1, "pts/257"},
+		// Minors over 255 have their high bits above the major.
+		{0x1000<<12 | 136<<8 | 0x02, "pts/4098"},
+		{4<<8 | 1, "tty1"},
+		{4<<8 | 64, "ttyS0"},
+		{4<<8 | 66, "ttyS2"},
+		// Neither a pts, a console nor a serial one (e.g., /dev/null).
+		{1<<8 | 3, "?"},
+	} {
+		if got := psTTY(tc.dev); got != tc.want {
+			t.Errorf("psTTY(%#x) = %q, want %q", tc.dev, got, tc.want)
+		}
+	}
+}
+
+func TestPsCPUTime(t *testing.T) {
+	for _, tc := range []struct {
+		d    time.Duration
+		want string
+	}{
+		{0, "00:00:00"},
+		{999 * time.Millisecond, "00:00:00"},
+		{61 * time.Second, "00:01:01"},
+		{23*time.Hour + 59*time.Minute + 59*time.Second, "23:59:59"},
+		{24 * time.Hour, "1-00:00:00"},
+		{50*time.Hour + 3*time.Second, "2-02:00:03"},
+	} {
+		if got := psCPUTime(tc.d); got != tc.want {
+			t.Errorf("psCPUTime(%v) = %q, want %q", tc.d, got, tc.want)
+		}
+	}
+}
+
+func TestPsStartTime(t *testing.T) {
+	now := time.Date(2021, time.March, 10, 12, 30, 0, 0, time.Local)
+	for _, tc := range []struct {
+		start time.Time
+		want  string
+	}{
+		{now, "12:30"},
+		{now.Add(-2 * time.Hour), "10:30"},
+		{now.Add(-23 * time.Hour), "13:30"},
+		{now.Add(-24 * time.Hour), "Mar09"},
+		{now.AddDate(0, -2, 0), "Jan10"},
+		{now.AddDate(-1, 0, -1), "2020"},
+	} {
+		if got := psStartTime(tc.start, now); got != tc.want {
+			t.Errorf("psStartTime(%v) = %q, want %q", tc.start, got, tc.want)
+		}
+	}
+}
+
+// writeProc creates the /proc files of a (synthetic) process in dir.
+func writeProc(t *testing.T, dir string, pid, ppid, uid int, comm, cmdline string) {
+	pdir := filepath.Join(dir, strconv.Itoa(pid))
+	if err := os.Mkdir(pdir, 0755); err != nil {
+		t.Fatal(err)
+	}
+	files := map[string]string{
+		"stat": fmt.Sprintf("%d (%s) S %d %d %d 34816 -1 4194560 100 0 0 0 150 50 0 0 20 0 1 0 4200 1000 100 0",
+			pid, comm, ppid, pid, pid),
+		"status":  fmt.Sprintf("Name:\t%s\nUid:\t%d\t%d\t%d\t%d\nGid:\t0\t0\t0\t0\n", comm, uid+1, uid, uid, uid),
+		"cmdline": cmdline,
+	}
+	for name, data := range files {
+		if err := ioutil.WriteFile(filepath.Join(pdir, name), []byte(data), 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+}
+
+func TestReadPsProcesses(t *testing.T) {
+	dir, err := ioutil.TempDir("", "ps-native")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+	defer func(d string) { procDir = d }(procDir)
+	procDir = dir
+
+	writeProc(t, dir, 1, 0, 0, "sh", "sh\x00")
+	writeProc(t, dir, 7, 1, 1000, "sleep) x", "sleep\x00100\x00")
+	writeProc(t, dir, 9, 2, 0, "kworker/0:1", "")
+
+	for _, tc := range []struct {
+		name string
+		pids []int
+		want []psProcess
+	}{
+		{
+			name: "sorted by pid",
+			pids: []int{9, 1, 7},
+			want: []psProcess{
+				{pid: 1, uid: 0, cmd: "sh"},
+				{pid: 7, uid: 1000, cmd: "sleep 100"},
+				{pid: 9, uid: 0, cmd: "[kworker/0:1]"},
+			},
+		},
+		{
+			name: "exited processes are left out",
+			pids: []int{42, 7},
+			want: []psProcess{
+				{pid: 7, uid: 1000, cmd: "sleep 100"},
+			},
+		},
+		{
+			name: "none",
+			pids: nil,
+			want: nil,
+		},
+	} {
+		got := readPsProcesses(tc.pids)
+		if len(got) != len(tc.want) {
+			t.Errorf("%s: got %d processes, want %d", tc.name, len(got), len(tc.want))
+			continue
+		}
+		for i, p := range got {
+			w := tc.want[i]
+			if p.pid != w.pid || p.uid != w.uid || p.cmd != w.cmd {
+				t.Errorf("%s: got process {%d %d %q}, want {%d %d %q}", tc.name, p.pid, p.uid, p.cmd, w.pid, w.uid, w.cmd)
+			}
+			if int(p.stat.PID) != p.pid || p.stat.TTY != 34816 || p.stat.UTime != 150 || p.stat.STime != 50 || p.stat.StartTime != 4200 {
+				t.Errorf("%s: process %d: unexpected stat %+v", tc.name, p.pid, p.stat)
+			}
+		}
+	}
+}
+
+// TestReadPsProcessesMany reads enough processes for the reads to be spread
+// across workers.
+func TestReadPsProcessesMany(t *testing.T) {
+	dir, err := ioutil.TempDir("", "ps-native")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+	defer func(d string) { procDir = d }(procDir)
+	procDir = dir
+
+	var pids []int
+	for pid := 200; pid > 100; pid-- {
+		pids = append(pids, pid)
+		if pid%10 != 0 {
+			writeProc(t, dir, pid, 1, 0, "sleep", "sleep\x00inf\x00")
+		}
+	}
+
+	got := readPsProcesses(pids)
+	if len(got) != 90 {
+		t.Fatalf("got %d processes, want 90", len(got))
+	}
+	for i, p := range got {
+		if i > 0 && p.pid <= got[i-1].pid {
+			t.Fatalf("processes not sorted: %d after %d", p.pid, got[i-1].pid)
+		}
+		if p.pid%10 == 0 {
+			t.Fatalf("got process %d, which doesn't exist", p.pid)
+		}
+	}
+}
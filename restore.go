@@ -4,14 +4,13 @@
 package main
 
 import (
-	"fmt"
+	"errors"
 	"os"
 
 	sh "github.com/nestybox/sysbox-libs/idShiftUtils"
 	"github.com/opencontainers/runc/libcontainer"
 	"github.com/opencontainers/runc/libcontainer/system"
 	"github.com/opencontainers/runc/libsysbox/sysbox"
-	"github.com/opencontainers/runc/libsysbox/syscont"
 	specs "github.com/opencontainers/runtime-spec/specs-go"
 	"github.com/sirupsen/logrus"
 	"github.com/urfave/cli"
@@ -97,6 +96,11 @@ using the sysbox-runc checkpoint command.`,
 			Name:  "lazy-pages",
 			Usage: "use userfaultfd to lazily restore memory pages",
 		},
+		cli.StringFlag{
+			Name:  "page-server",
+			Value: "",
+			Usage: "ADDRESS:PORT of the page server to lazily restore memory pages from (with --lazy-pages)",
+		},
 	},
 	Action: func(context *cli.Context) error {
 		var (
@@ -121,15 +125,26 @@ using the sysbox-runc checkpoint command.`,
 			return err
 		}
 
+		// sysbox-runc: validate the options before registering with
+		// sysbox-mgr and sysbox-fs, which would have to be undone otherwise.
+		options := criuOptions(context)
+		if err = setEmptyNsMask(context, options); err != nil {
+			return err
+		}
+		setPageServer(context, options)
+		if options.PageServer.Address != "" && !options.LazyPages {
+			return errors.New("--page-server requires --lazy-pages")
+		}
+
 		id := context.Args().First()
 		sysMgr := sysbox.NewMgr(id, !context.GlobalBool("no-sysbox-mgr"))
 		sysFs := sysbox.NewFs(id, !context.GlobalBool("no-sysbox-fs"))
 
-		// register with sysMgr (registration with sysFs occurs later (within libcontainer))
+		// register with sysMgr and get sysbox-fs related configs
+		if err = registerSysbox(spec, sysMgr, sysFs); err != nil {
+			return err
+		}
 		if sysMgr.Enabled() {
-			if err = sysMgr.Register(spec); err != nil {
-				return err
-			}
 			defer func() {
 				if err != nil {
 					sysMgr.Unregister()
@@ -137,22 +152,13 @@ using the sysbox-runc checkpoint command.`,
 			}()
 		}
 
-		// Get sysbox-fs related configs
-		if sysFs.Enabled() {
-			if err = sysFs.GetConfig(); err != nil {
-				return err
-			}
-		}
-
-		rootfsUidShiftType, bindMntUidShiftType, rootfsCloned, err = syscont.ConvertSpec(context, sysMgr, sysFs, spec)
+		// convert the spec and pre-register with sysFs (the registration is
+		// done when criu has restored the container's init process)
+		rootfsUidShiftType, bindMntUidShiftType, rootfsCloned, err = convertSpec(context, spec, sysMgr, sysFs)
 		if err != nil {
-			return fmt.Errorf("error in the container spec: %v", err)
-		}
-
-		options := criuOptions(context)
-		if err = setEmptyNsMask(context, options); err != nil {
 			return err
 		}
+
 		status, err = startContainer(context, spec, CT_ACT_RESTORE, options, rootfsUidShiftType, bindMntUidShiftType, rootfsCloned, sysMgr, sysFs)
 		if err != nil {
 			sysFs.Unregister()
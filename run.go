@@ -4,12 +4,10 @@
 package main
 
 import (
-	"fmt"
 	"os"
 
 	sh "github.com/nestybox/sysbox-libs/idShiftUtils"
 	"github.com/opencontainers/runc/libsysbox/sysbox"
-	"github.com/opencontainers/runc/libsysbox/syscont"
 	specs "github.com/opencontainers/runtime-spec/specs-go"
 	"github.com/sirupsen/logrus"
 	"github.com/urfave/cli"
@@ -113,11 +111,11 @@ command(s) that get executed on start, edit the args parameter of the spec. See
 		sysMgr := sysbox.NewMgr(id, !context.GlobalBool("no-sysbox-mgr"))
 		sysFs := sysbox.NewFs(id, !context.GlobalBool("no-sysbox-fs"))
 
-		// register with sysMgr
+		// register with sysMgr and get sysbox-fs related configs
+		if err = registerSysbox(spec, sysMgr, sysFs); err != nil {
+			return err
+		}
 		if sysMgr.Enabled() {
-			if err = sysMgr.Register(spec); err != nil {
-				return err
-			}
 			defer func() {
 				if err != nil {
 					sysMgr.Unregister()
@@ -125,23 +123,12 @@ command(s) that get executed on start, edit the args parameter of the spec. See
 			}()
 		}
 
-		// Get sysbox-fs related configs
-		if sysFs.Enabled() {
-			if err = sysFs.GetConfig(); err != nil {
-				return err
-			}
-		}
-
-		rootfsUidShiftType, bindMntUidShiftType, rootfsCloned, err = syscont.ConvertSpec(context, sysMgr, sysFs, spec)
+		// convert the spec and pre-register with sysFs
+		rootfsUidShiftType, bindMntUidShiftType, rootfsCloned, err = convertSpec(context, spec, sysMgr, sysFs)
 		if err != nil {
-			return fmt.Errorf("error in the container spec: %v", err)
+			return err
 		}
-
-		// pre-register with sysFs
 		if sysFs.Enabled() {
-			if err = sysFs.PreRegister(spec.Linux.Namespaces); err != nil {
-				return err
-			}
 			defer func() {
 				if err != nil {
 					sysFs.Unregister()
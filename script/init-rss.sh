@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+#
+# Measures the per-container memory footprint of the sysbox-runc init, i.e.,
+# of created (but not started) containers, whose init waits on the exec fifo.
+# It does so with the lean Go runtime settings of the init (the default) and
+# with the runtime's own defaults, see docs/init-runtime.md.
+#
+# Usage: init-rss.sh <bundle> [containers] [sysbox-runc flags ...]
+#
+# The bundle's config must not set a terminal; e.g., run the benchmark with
+# the flags: --no-sysbox-mgr --no-sysbox-fs.
+
+set -e
+
+bundle="$1"
+count="${2:-10}"
+shift 2 || shift $#
+
+RUNC="${RUNC:-sysbox-runc}"
+root="$(mktemp -d /tmp/init-rss.XXXXXX)"
+trap 'rm -rf "$root"' EXIT
+
+# Prints the average VmRSS, RssAnon and Threads of the inits of $count
+# containers created with the environment given as arguments.
+measure() {
+	local i pid rss=0 anon=0 threads=0
+
+	for i in $(seq "$count"); do
+		env "$@" "$RUNC" --root "$root" "${flags[@]}" create --bundle "$bundle" "init-rss-$i" </dev/null >/dev/null
+	done
+
+	for i in $(seq "$count"); do
+		pid="$("$RUNC" --root "$root" "${flags[@]}" state "init-rss-$i" | sed -n 's/.*"pid": \([0-9]*\).*/\1/p')"
+		rss=$((rss + $(awk '/^VmRSS/ {print $2}' "/proc/$pid/status")))
+		anon=$((anon + $(awk '/^RssAnon/ {print $2}' "/proc/$pid/status")))
+		threads=$((threads + $(awk '/^Threads/ {print $2}' "/proc/$pid/status")))
+	done
+
+	for i in $(seq "$count"); do
+		"$RUNC" --root "$root" "${flags[@]}" delete --force "init-rss-$i"
+	done
+
+	echo "VmRSS $((rss / count)) kB, RssAnon $((anon / count)) kB, Threads $((threads / count))"
+}
+
+flags=("$@")
+
+echo -n "lean runtime ($count containers):    "
+measure
+echo -n "default runtime ($count containers): "
+measure GOMAXPROCS="$(nproc)" GOGC=100
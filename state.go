@@ -5,6 +5,7 @@ package main
 import (
 	"encoding/json"
 	"os"
+	"path/filepath"
 
 	"github.com/opencontainers/runc/libcontainer"
 	"github.com/opencontainers/runc/libcontainer/utils"
@@ -23,6 +24,14 @@ instance of a container.`,
 		if err := checkArgs(context, 1, exactArgs); err != nil {
 			return err
 		}
+		if cs, ok := indexedState(context); ok {
+			data, err := json.MarshalIndent(cs, "", "  ")
+			if err != nil {
+				return err
+			}
+			os.Stdout.Write(data)
+			return nil
+		}
 		container, err := getContainer(context)
 		if err != nil {
 			return err
@@ -58,3 +67,28 @@ instance of a container.`,
 		return nil
 	},
 }
+
+// sysbox-runc: indexedState returns the state of the container from its entry
+// in the state index, if it has one.
+func indexedState(context *cli.Context) (containerState, bool) {
+	id := context.Args().First()
+	absRoot, err := filepath.Abs(context.GlobalString("root"))
+	if err != nil || id == "" {
+		return containerState{}, false
+	}
+	index, err := libcontainer.ReadStateIndex(absRoot)
+	if err != nil {
+		return containerState{}, false
+	}
+	e, ok := index[id]
+	if !ok {
+		return containerState{}, false
+	}
+	containerRoot := filepath.Join(absRoot, id)
+	if _, err := os.Stat(containerRoot); err != nil {
+		return containerState{}, false
+	}
+	cs := indexedContainerState(e, containerRoot, map[int]string{})
+	cs.Owner = ""
+	return cs, true
+}
@@ -162,6 +162,29 @@ function simple_cr() {
 	check_pipes
 }
 
+@test "checkpoint --pre-dump-iterations and restore" {
+	skip "sysbox-runc unsupported feature"
+
+	setup_pipes
+	runc_run_with_pipes test_busybox
+
+	# checkpoint the running container, after two pre-dumps
+	mkdir image-dir
+	mkdir work-dir
+	runc --criu "$CRIU" checkpoint --pre-dump-iterations 2 --work-path ./work-dir --image-path ./image-dir test_busybox
+	grep -B 5 Error ./work-dir/dump.log || true
+	[ "$status" -eq 0 ]
+
+	[ -e image-dir/pre-dump.1/inventory.img ]
+	[ -e image-dir/pre-dump.2/inventory.img ]
+
+	# after checkpoint busybox is no longer running
+	testcontainer test_busybox checkpointed
+
+	runc_restore_with_pipes ./work-dir test_busybox
+	check_pipes
+}
+
 @test "checkpoint --lazy-pages and restore" {
 	skip "sysbox-runc unsupported feature"
 
@@ -71,6 +71,34 @@ function test_events() {
 	test_events 100ms 0.1
 }
 
+@test "events --notify" {
+	# XXX: currently cgroups require root containers.
+	requires root cgroups_v2
+	init_cgroup_paths
+
+	runc run -d --console-socket "$CONSOLE_SOCKET" test_busybox
+	[ "$status" -eq 0 ]
+
+	(__runc events --notify --interval 1s test_busybox >events.log) &
+	(
+		retry 10 1 eval "grep -q 'test_busybox' events.log"
+		# Use some cpu, for the next stats to change.
+		__runc exec test_busybox true
+		retry 10 1 eval "[ \$(grep -c 'test_busybox' events.log) -ge 2 ]"
+		teardown_running_container test_busybox
+	) &
+	wait # for both subshells to finish
+
+	# The first event has all of the stats, the ones after it the changes only.
+	output=$(head -1 events.log)
+	[[ "$output" == [\{]"\"type\""[:]"\"stats\""[,]"\"id\""[:]"\"test_busybox\""[,]* ]]
+	[[ "$output" == *'"cpu":'* ]]
+	[[ "$output" == *'"memory":'* ]]
+	output=$(sed -n 2p events.log)
+	[[ "$output" == *'"cpu":'* ]]
+	[[ "$output" != *'"intel_rdt":'* ]]
+}
+
 @test "events oom" {
 
 	# XXX: DEBUG
@@ -28,6 +28,26 @@ function teardown() {
 	[[ "${lines[1]}" == *"$UID_MAP"*[0-9]* ]]
 }
 
+@test "ps columns" {
+	# ps is not supported, it requires cgroups
+	requires root
+
+	# start busybox detached
+	runc run -d --console-socket "$CONSOLE_SOCKET" test_busybox
+	[ "$status" -eq 0 ]
+
+	# check state
+	testcontainer test_busybox running
+
+	# Without ps options, the processes are listed natively, with the columns
+	# of "ps -ef": the init is on the container's terminal, and started today.
+	runc ps test_busybox
+	[ "$status" -eq 0 ]
+	[ "${#lines[@]}" -eq 2 ]
+	[[ "${lines[0]}" =~ ^UID\ +PID\ +PPID\ +C\ +STIME\ +TTY\ +TIME\ +CMD$ ]]
+	[[ "${lines[1]}" =~ ^[^\ ]+\ +[0-9]+\ +[0-9]+\ +[0-9]+\ +[0-9]{2}:[0-9]{2}\ +pts/[0-9]+\ +[0-9]{2}:[0-9]{2}:[0-9]{2}\ +sh$ ]]
+}
+
 @test "ps -f json" {
 	# ps is not supported, it requires cgroups
 	requires root
@@ -33,6 +33,73 @@ import (
 
 var errEmptyID = errors.New("container id cannot be empty")
 
+// sysbox-runc: registerSysbox registers the container with sysbox-mgr and gets
+// the sysbox-fs configs. The two don't depend on each other, so the calls are
+// made concurrently. On error, the container is left unregistered.
+func registerSysbox(spec *specs.Spec, sysMgr *sysbox.Mgr, sysFs *sysbox.Fs) error {
+	registered := false
+	err := sysbox.Parallel(
+		func() error {
+			if !sysMgr.Enabled() {
+				return nil
+			}
+			if err := sysMgr.Register(spec); err != nil {
+				return err
+			}
+			registered = true
+			return nil
+		},
+		func() error {
+			if !sysFs.Enabled() {
+				return nil
+			}
+			return sysFs.GetConfig()
+		},
+	)
+	if err != nil && registered {
+		sysMgr.Unregister()
+	}
+	return err
+}
+
+// sysbox-runc: convertSpec converts the container's spec to a system container
+// spec (see syscont.ConvertSpec()) and pre-registers the container with
+// sysbox-fs. The pre-registration only depends on the container's network
+// namespace, which the conversion leaves as is, so it's done concurrently. On
+// error, the container is left not pre-registered.
+func convertSpec(context *cli.Context, spec *specs.Spec, sysMgr *sysbox.Mgr, sysFs *sysbox.Fs) (rootfsUidShiftType, bindMntUidShiftType sh.IDShiftType, rootfsCloned bool, err error) {
+	var namespaces []specs.LinuxNamespace
+	if spec.Linux != nil {
+		namespaces = append(namespaces, spec.Linux.Namespaces...)
+	}
+	preRegistered := false
+
+	err = sysbox.Parallel(
+		func() error {
+			var err error
+			rootfsUidShiftType, bindMntUidShiftType, rootfsCloned, err = syscont.ConvertSpec(context, sysMgr, sysFs, spec)
+			if err != nil {
+				return fmt.Errorf("error in the container spec: %v", err)
+			}
+			return nil
+		},
+		func() error {
+			if !sysFs.Enabled() {
+				return nil
+			}
+			if err := sysFs.PreRegister(namespaces); err != nil {
+				return err
+			}
+			preRegistered = true
+			return nil
+		},
+	)
+	if err != nil && preRegistered {
+		sysFs.Unregister()
+	}
+	return
+}
+
 // loadFactory returns the configured factory instance for execing containers.
 func loadFactory(context *cli.Context, sysMgr *sysbox.Mgr, sysFs *sysbox.Fs) (libcontainer.Factory, error) {
 	root := context.GlobalString("root")
@@ -75,10 +142,18 @@ func loadFactory(context *cli.Context, sysMgr *sysbox.Mgr, sysFs *sysbox.Fs) (li
 		newgidmap = ""
 	}
 
+	// sysbox-runc: optionally share a single read-only bind mount of the binary
+	// among all invocations, published under the root dir.
+	var sharedClonedBinary func(*libcontainer.LinuxFactory) error
+	if context.GlobalBool("shared-cloned-binary") {
+		sharedClonedBinary = libcontainer.SharedClonedBinary(abs)
+	}
+
 	return libcontainer.New(abs, cgroupManager, intelRdtManager,
 		libcontainer.CriuPath(context.GlobalString("criu")),
 		libcontainer.NewuidmapPath(newuidmap),
 		libcontainer.NewgidmapPath(newgidmap),
+		sharedClonedBinary,
 		libcontainer.SysFs(sysFs),
 		libcontainer.SysMgr(sysMgr))
 }
@@ -257,11 +332,16 @@ func setupIO(process *libcontainer.Process, rootuid, rootgid int, createTTY, det
 
 // createPidFile creates a file with the processes pid inside it atomically
 // it creates a temp file with the paths filename + '.' infront of it
-// then renames the file
-func createPidFile(path string, process *libcontainer.Process) error {
-	pid, err := process.Pid()
-	if err != nil {
-		return err
+// then renames the file. With several processes (sysbox-runc: a batch exec),
+// it writes one pid per line.
+func createPidFile(path string, processes ...*libcontainer.Process) error {
+	var pids []string
+	for _, process := range processes {
+		pid, err := process.Pid()
+		if err != nil {
+			return err
+		}
+		pids = append(pids, strconv.Itoa(pid))
 	}
 	var (
 		tmpDir  = filepath.Dir(path)
@@ -271,7 +351,7 @@ func createPidFile(path string, process *libcontainer.Process) error {
 	if err != nil {
 		return err
 	}
-	_, err = f.WriteString(strconv.Itoa(pid))
+	_, err = f.WriteString(strings.Join(pids, "\n"))
 	f.Close()
 	if err != nil {
 		return err
@@ -421,6 +501,7 @@ func (r *runner) run(config *specs.Process) (int, error) {
 	default:
 		panic("Unknown action")
 	}
+	sysbox.LogIpcStats()
 	if err != nil {
 		return -1, err
 	}